@@ -20,6 +20,7 @@ namespace llvm {
 }
 
 namespace klee {
+  class ArrayCache;
   class ExprBuilder;
 
 namespace expr {
@@ -228,8 +229,11 @@ namespace expr {
     /// \arg MB - The input data.
     /// \arg Builder - The expression builder to use for constructing
     /// expressions.
+    /// \arg Arrays - Where to create the arrays, so they can outlive the
+    /// parser. By default the parser owns them.
     static Parser *Create(const std::string Name, const llvm::MemoryBuffer *MB,
-                          ExprBuilder *Builder, bool ClearArrayAfterQuery);
+                          ExprBuilder *Builder, bool ClearArrayAfterQuery,
+                          ArrayCache *Arrays = 0);
   };
 }
 }
@@ -0,0 +1,165 @@
+//===-- CallPrefixTree.h ----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_CALLPREFIXTREE_H
+#define KLEE_CALLPREFIXTREE_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace klee {
+  struct CallInfo;
+  class CallPrefixTree;
+
+  /// The prefix tree of the traced calls of all paths, built while they
+  /// are explored rather than from the finished paths.
+  ///
+  /// Every state holds a CallPrefix, its position in the tree: the node of
+  /// the calls it has returned from. Identical calls are stored once, no
+  /// matter how many nodes they appear in. A subtree is closed once no
+  /// state is in it or above it, as no state can add to it any more. With
+  /// flushing enabled, closed subtrees are handed to flush() and freed,
+  /// so that memory follows the states alive rather than all the paths.
+  class CallPrefixTree {
+    struct Interned;
+
+  public:
+    class Node {
+      friend class CallPrefixTree;
+
+      Node *parent;
+      Interned *call; // null at the root
+      unsigned pathId;
+      /// States at this node, and children with states in their subtree.
+      unsigned states, liveChildren;
+      bool flushed, closing;
+      std::vector<Node *> children;
+      /// Children whose subtree lost its last state, to be flushed once
+      /// no state is left above them.
+      std::vector<Node *> closed;
+
+      Node(Node *_parent, Interned *_call)
+        : parent(_parent), call(_call), pathId(0), states(0),
+          liveChildren(0), flushed(false), closing(false) {}
+
+      bool isLive() const { return states || liveChildren; }
+
+    public:
+      const Node *getParent() const { return parent; }
+      /// The last call of the prefix; not for the root.
+      const CallInfo &getCall() const;
+      /// The first finished path through this node, 0 if there is none.
+      unsigned getPathId() const { return pathId; }
+      const std::vector<Node *> &getChildren() const { return children; }
+    };
+
+  private:
+    class InternTable;
+
+    Node root;
+    InternTable *calls;
+    bool flushing;
+
+    CallPrefixTree(const CallPrefixTree &);
+    void operator=(const CallPrefixTree &);
+
+    Interned *intern(const CallInfo &call);
+    void unintern(Interned *call);
+
+    void flushClosed(Node *n);
+    void flushBelow(Node *n);
+    void flushSubtree(Node *n);
+    void deleteSubtree(Node *n);
+    void writeSubtree(Node *n);
+    void forgetPaths(Node *n);
+
+  protected:
+    /// Called once the children of \a n are final. Children with a zero
+    /// path id were only reached by paths that did not finish.
+    virtual void flush(const Node &n) {}
+
+  public:
+    CallPrefixTree();
+    virtual ~CallPrefixTree();
+
+    Node *getRoot() { return &root; }
+    const Node *getRoot() const { return &root; }
+
+    /// Flush closed subtrees as the run goes. Off by default, in which case
+    /// the whole tree is kept until flushAll().
+    void setFlushing(bool enabled) { flushing = enabled; }
+
+    /// The child of \a n for \a call, created if needed.
+    Node *getChild(Node *n, const CallInfo &call);
+
+    void retain(Node *n);
+    void release(Node *n);
+
+    /// Record that path \a pathId finished at \a n.
+    void finishPath(Node *n, unsigned pathId);
+
+    /// Drop the finished paths, e.g. when a forked process starts a new
+    /// chunk of the exploration; the states keep their positions.
+    void forgetPaths();
+
+    /// Flush what is left of the tree, states or not.
+    void flushAll();
+
+    /// The number of distinct calls stored.
+    size_t getNumCalls() const;
+  };
+
+  /// A position in a CallPrefixTree, as held by a state. Copying a
+  /// position, as forking does, counts as another state at that node.
+  class CallPrefix {
+    CallPrefixTree *tree;
+    CallPrefixTree::Node *node;
+
+  public:
+    CallPrefix() : tree(0), node(0) {}
+    /// The root of \a tree, or nowhere if \a tree is null.
+    explicit CallPrefix(CallPrefixTree *_tree)
+      : tree(_tree), node(_tree ? _tree->getRoot() : 0) {
+      if (tree)
+        tree->retain(node);
+    }
+    CallPrefix(const CallPrefix &other) : tree(other.tree), node(other.node) {
+      if (tree)
+        tree->retain(node);
+    }
+    ~CallPrefix() {
+      if (tree)
+        tree->release(node);
+    }
+
+    CallPrefix &operator=(const CallPrefix &other) {
+      if (other.tree)
+        other.tree->retain(other.node);
+      if (tree)
+        tree->release(node);
+      tree = other.tree;
+      node = other.node;
+      return *this;
+    }
+
+    /// Move past \a call, which has returned.
+    void append(const CallInfo &call) {
+      if (!tree)
+        return;
+      CallPrefixTree::Node *child = tree->getChild(node, call);
+      tree->retain(child);
+      tree->release(node);
+      node = child;
+    }
+
+    CallPrefixTree::Node *getNode() const { return node; }
+  };
+}
+
+#endif
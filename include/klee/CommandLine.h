@@ -49,10 +49,13 @@ enum CoreSolverType {
   METASMT_SOLVER,
   DUMMY_SOLVER,
   Z3_SOLVER,
+  PORTFOLIO_SOLVER,
   NO_SOLVER
 };
 extern llvm::cl::opt<CoreSolverType> CoreSolverToUse;
 
+extern llvm::cl::list<CoreSolverType> PortfolioSolvers;
+
 extern llvm::cl::opt<CoreSolverType> DebugCrossCheckCoreSolverWith;
 
 #ifdef ENABLE_METASMT
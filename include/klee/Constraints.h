@@ -12,12 +12,15 @@
 
 #include "klee/Expr.h"
 
+#include <memory>
+
 // FIXME: Currently we use ConstraintManager for two things: to pass
 // sets of constraints around, and to optimize constraints. We should
 // move the first usage into a separate data structure
 // (ConstraintSet?) which ConstraintManager could embed if it likes.
 namespace klee {
 
+class ConstraintFactors;
 class ExprVisitor;
   
 class ConstraintManager {
@@ -33,7 +36,8 @@ public:
   ConstraintManager(const std::vector< ref<Expr> > &_constraints) :
     constraints(_constraints) {}
 
-  ConstraintManager(const ConstraintManager &cs) : constraints(cs.constraints) {}
+  ConstraintManager(const ConstraintManager &cs)
+    : constraints(cs.constraints), factors(cs.factors) {}
 
   typedef std::vector< ref<Expr> >::const_iterator constraint_iterator;
 
@@ -43,6 +47,7 @@ public:
 
   void clear() {
     constraints.clear();
+    factors.reset();
   }
 
   void dump() const {
@@ -70,6 +75,11 @@ public:
     return constraints.size();
   }
 
+  /// The partition of the constraints into independent factors. It is kept
+  /// from query to query and shared with copies, and only extended by the
+  /// constraints added since, unless existing ones were rewritten.
+  const ConstraintFactors &getFactors() const;
+
   bool operator==(const ConstraintManager &other) const {
     return constraints == other.constraints;
   }
@@ -78,6 +88,9 @@ public:
   
 private:
   std::vector< ref<Expr> > constraints;
+  /// The factors of a prefix of the constraints, built on demand. Copies
+  /// share it until either brings it up to date.
+  mutable std::shared_ptr<ConstraintFactors> factors;
 
   // returns true iff the constraints were modified
   bool rewriteConstraints(ExprVisitor &visitor);
@@ -10,16 +10,19 @@
 #ifndef KLEE_EXECUTIONSTATE_H
 #define KLEE_EXECUTIONSTATE_H
 
+#include "klee/CallPrefixTree.h"
 #include "klee/Constraints.h"
 #include "klee/Expr.h"
 #include "klee/Internal/ADT/TreeStream.h"
 #include "klee/MergeHandler.h"
 #include "klee/Internal/ADT/ImmutableSet.h"
+#include "klee/Internal/ADT/PersistentList.h"
 #include "klee/util/GetExprSymbols.h"
 #include "klee/LoopAnalysis.h"
 
 // FIXME: We do not want to be exposing these? :(
 #include "../../lib/Core/AddressSpace.h"
+#include "klee/Internal/Module/FrameArena.h"
 #include "klee/Internal/Module/KInstIterator.h"
 
 //TODO: generalize for otehr LLVM versions like the above
@@ -28,11 +31,13 @@
 #include <map>
 #include <regex>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 namespace llvm {
   class Function;
   class BasicBlock;
+  class GlobalValue;
 }
 
 namespace klee {
@@ -54,7 +59,9 @@ struct StackFrame {
   CallPathNode *callPathNode;
 
   std::vector<const MemoryObject *> allocas;
-  Cell *locals;
+  /// Shared with the corresponding frame of forked states; write through
+  /// locals.getWriteable(state.frameArena).
+  FrameLocals locals;
 
   /// Minimum distance to an uncovered instruction once the function
   /// returns. This is not a good place for this but is used to
@@ -70,9 +77,7 @@ struct StackFrame {
   // of intrinsic lowering.
   MemoryObject *varargs;
 
-  StackFrame(KInstIterator caller, KFunction *kf);
-  StackFrame(const StackFrame &s);
-  ~StackFrame();
+  StackFrame(KInstIterator caller, KFunction *kf, FrameArena &arena);
 };
 
 struct FunctionAlias {
@@ -82,6 +87,35 @@ struct FunctionAlias {
   std::string alias;
 };
 
+/// @brief The aliases registered with klee_alias_function* together with
+/// the resolution of every callee looked up so far. Shared by forked states
+/// and copied on write.
+class FunctionAliasTable {
+public:
+  unsigned refCount;
+  std::vector<FunctionAlias> aliases;
+  /// Callee -> alias target, or null if the callee is not aliased.
+  std::unordered_map<const llvm::GlobalValue *, llvm::GlobalValue *> resolved;
+
+  FunctionAliasTable() : refCount(0) {}
+  FunctionAliasTable(const FunctionAliasTable &t)
+    : refCount(0), aliases(t.aliases) {}
+};
+
+/// @brief Memory accesses intercepted with klee_intercept_{reads,writes},
+/// keyed by the object base address. Shared by forked states and copied
+/// on write.
+class InterceptTable {
+public:
+  unsigned refCount;
+  std::unordered_map<uint64_t, llvm::Function *> readers;
+  std::unordered_map<uint64_t, llvm::Function *> writers;
+
+  InterceptTable() : refCount(0) {}
+  InterceptTable(const InterceptTable &t)
+    : refCount(0), readers(t.readers), writers(t.writers) {}
+};
+
 struct FieldDescr {
   Expr::Width width;
   std::string type;
@@ -146,6 +180,10 @@ struct CallInfo {
   CallArg* getCallArgPtrp(ref<Expr> ptr);
   bool eq(const CallInfo& other) const;
   bool sameInvocation(const CallInfo* other) const;
+  /// A textual form of the call for when the CallInfo itself is gone, e.g.
+  /// in a merged call tree image: two calls have the same key iff they are
+  /// sameInvocation().
+  std::string getInvocationKey() const;
   SymbolSet computeRetSymbolSet() const;
 };
 
@@ -198,14 +236,14 @@ public:
 class ExecutionState {
 public:
   typedef std::vector<StackFrame> stack_ty;
+  typedef PersistentList<CallInfo> call_path_ty;
 
 private:
   // unsupported, use copy constructor
   ExecutionState &operator=(const ExecutionState &);
 
-  std::vector<FunctionAlias> fnAliases;
-  std::map<uint64_t, std::string> readsIntercepts;
-  std::map<uint64_t, std::string> writesIntercepts;
+  ref<FunctionAliasTable> fnAliases;
+  ref<InterceptTable> intercepts;
 
 public:
   // Execution - Control Flow specific
@@ -220,6 +258,10 @@ public:
   /// @brief Stack representing the current instruction stream
   stack_ty stack;
 
+  /// @brief Backing store for the registers of the frames on the stack
+  /// that are not shared with another state.
+  FrameArena frameArena;
+
   /// @brief Remember from which Basic Block control flow arrived
   /// (i.e. to select the right phi values)
   unsigned incomingBBIndex;
@@ -306,7 +348,12 @@ public:
   /// @brief Set of used array names for this state.  Used to avoid collisions.
   std::set<std::string> arrayNames;
 
-  std::vector<CallInfo> callPath;
+  /// @brief Traced calls, in order. Shared with the states forked from
+  /// this one up to the point of the fork.
+  call_path_ty callPath;
+  /// @brief The node of the returned calls of callPath in the call-prefix
+  /// tree, if one is kept.
+  CallPrefix callPrefix;
   SymbolSet relevantSymbols;
 
   /// @brief: a flag indicating that the state is genuine and not
@@ -318,15 +365,19 @@ public:
   bool condoneUndeclaredHavocs;
 
 
-  std::string getFnAlias(std::string fn);
+  /// @brief Returns the function \p gv is aliased to, or \p gv itself.
+  llvm::GlobalValue *getFnAlias(llvm::GlobalValue *gv);
   void addFnAlias(std::string old_fn, std::string new_fn);
   void addFnRegexAlias(std::string fn_regex, std::string new_fn);
   void removeFnAlias(std::string fn);
 
-  std::string getInterceptReader(uint64_t addr);
-  std::string getInterceptWriter(uint64_t addr);
-  void addReadsIntercept(uint64_t addr, std::string reader);
-  void addWritesIntercept(uint64_t addr, std::string writer);
+  /// @brief Whether any intercept was ever registered; lets the memory
+  /// access path skip the lookups entirely.
+  bool hasIntercepts() const { return !intercepts.isNull(); }
+  llvm::Function *getInterceptReader(uint64_t addr) const;
+  llvm::Function *getInterceptWriter(uint64_t addr) const;
+  void addReadsIntercept(uint64_t addr, llvm::Function *reader);
+  void addWritesIntercept(uint64_t addr, llvm::Function *writer);
 
   // The objects handling the klee_open_merge calls this state ran through
   std::vector<ref<MergeHandler> > openMergeStack;
@@ -337,11 +388,15 @@ public:
 private:
   ExecutionState() : ptreeNode(0) {}
 
+  FunctionAliasTable &getWriteableFnAliases();
+  InterceptTable &getWriteableIntercepts();
+
 
   void loopRepetition(const llvm::Loop *dstLoop,
                       TimingSolver *solver,
                       bool *terminate);
   void loopEnter(const llvm::Loop *dstLoop);
+  void discardLoopEntrySnapshot();
   void loopExit(const llvm::Loop *srcLoop,
                 bool *terminate);
 
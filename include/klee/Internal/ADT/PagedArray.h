@@ -0,0 +1,188 @@
+//===-- PagedArray.h --------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_PAGEDARRAY_H
+#define KLEE_PAGEDARRAY_H
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+#include <stdint.h>
+#include <vector>
+
+namespace klee {
+  /// A fixed-size array kept in reference counted pages of \a PageSize
+  /// elements, shared between copies until one of them writes.
+  ///
+  /// Copying the array only takes a reference on each page, and a write
+  /// clones at most the page it lands in. Pages that were never written
+  /// are not allocated at all and read as the default value.
+  template<class T, unsigned PageSize = 128>
+  class PagedArray {
+    struct Page {
+      unsigned references;
+      unsigned size;
+
+      T *data() { return reinterpret_cast<T *>(this + 1); }
+      const T *data() const { return reinterpret_cast<const T *>(this + 1); }
+    };
+    static_assert(sizeof(Page) % alignof(T) == 0, "misaligned page data");
+
+    unsigned numElements;
+    T defaultValue;
+    std::vector<Page *> pages;
+
+    static Page *allocPage(unsigned size, const T *init, const T &value) {
+      Page *p = new (::operator new(sizeof(Page) + size * sizeof(T))) Page;
+      p->references = 1;
+      p->size = size;
+      for (unsigned i = 0; i < size; ++i)
+        new (&p->data()[i]) T(init ? init[i] : value);
+      return p;
+    }
+
+    static void release(Page *p) {
+      if (p && --p->references == 0) {
+        for (unsigned i = 0; i < p->size; ++i)
+          p->data()[i].~T();
+        p->~Page();
+        ::operator delete(p);
+      }
+    }
+
+    /// The elements of page \a page, which is allocated or unshared first.
+    T *getWriteablePage(unsigned page) {
+      Page *&p = pages[page];
+      if (!p) {
+        p = allocPage(std::min(PageSize, numElements - page * PageSize), 0,
+                      defaultValue);
+      } else if (p->references > 1) {
+        --p->references;
+        p = allocPage(p->size, p->data(), defaultValue);
+      }
+      return p->data();
+    }
+
+  public:
+    explicit PagedArray(unsigned size, const T &_defaultValue = T())
+      : numElements(size), defaultValue(_defaultValue),
+        pages((size + PageSize - 1) / PageSize, (Page *) 0) {}
+
+    PagedArray(const PagedArray &b)
+      : numElements(b.numElements), defaultValue(b.defaultValue),
+        pages(b.pages) {
+      for (typename std::vector<Page *>::iterator it = pages.begin(),
+             ie = pages.end(); it != ie; ++it)
+        if (*it)
+          ++(*it)->references;
+    }
+
+    ~PagedArray() { clear(); }
+
+    PagedArray &operator=(const PagedArray &b) {
+      PagedArray copy(b);
+      std::swap(numElements, copy.numElements);
+      std::swap(defaultValue, copy.defaultValue);
+      pages.swap(copy.pages);
+      return *this;
+    }
+
+    unsigned size() const { return numElements; }
+
+    const T &get(unsigned i) const {
+      assert(i < numElements && "index out of range");
+      const Page *p = pages[i / PageSize];
+      return p ? p->data()[i % PageSize] : defaultValue;
+    }
+
+    void set(unsigned i, const T &value) {
+      assert(i < numElements && "index out of range");
+      getWriteablePage(i / PageSize)[i % PageSize] = value;
+    }
+
+    /// Reset every element to the default value.
+    void clear() {
+      for (typename std::vector<Page *>::iterator it = pages.begin(),
+             ie = pages.end(); it != ie; ++it) {
+        release(*it);
+        *it = 0;
+      }
+    }
+
+    /// Copy the whole array out to \a dst.
+    void copyTo(T *dst) const {
+      for (unsigned page = 0; page < pages.size(); ++page) {
+        unsigned begin = page * PageSize;
+        unsigned end = std::min(begin + PageSize, numElements);
+        if (const Page *p = pages[page])
+          std::copy(p->data(), p->data() + p->size, dst + begin);
+        else
+          std::fill(dst + begin, dst + end, defaultValue);
+      }
+    }
+
+    /// Check whether page \a page holds the same elements as \a src, which
+    /// points at the counterpart of its first element.
+    bool equalsPage(unsigned page, const T *src) const {
+      unsigned begin = page * PageSize;
+      unsigned end = std::min(begin + PageSize, numElements);
+      if (const Page *p = pages[page])
+        return std::equal(p->data(), p->data() + p->size, src);
+      for (unsigned i = begin; i < end; ++i, ++src)
+        if (!(*src == defaultValue))
+          return false;
+      return true;
+    }
+
+    /// Overwrite the whole array with \a src. Pages whose contents do not
+    /// change are left shared.
+    void copyFrom(const T *src) {
+      for (unsigned page = 0; page < pages.size(); ++page) {
+        unsigned begin = page * PageSize;
+        unsigned end = std::min(begin + PageSize, numElements);
+        if (!equalsPage(page, src + begin))
+          std::copy(src + begin, src + end, getWriteablePage(page));
+      }
+    }
+
+    /// Check whether the array holds the same elements as \a src.
+    bool equals(const T *src) const {
+      for (unsigned page = 0; page < pages.size(); ++page)
+        if (!equalsPage(page, src + page * PageSize))
+          return false;
+      return true;
+    }
+  };
+
+  /// A bit array on top of PagedArray. Setting a bit to the value it
+  /// already has never allocates or unshares a page.
+  class PagedBitArray {
+    PagedArray<uint32_t, 32> words;
+
+  public:
+    explicit PagedBitArray(unsigned size, bool value = false)
+      : words((size + 31) / 32, value ? ~0U : 0U) {}
+
+    bool get(unsigned i) const {
+      return words.get(i / 32) & (1U << (i % 32));
+    }
+
+    void set(unsigned i) {
+      if (!get(i))
+        words.set(i / 32, words.get(i / 32) | (1U << (i % 32)));
+    }
+
+    void unset(unsigned i) {
+      if (get(i))
+        words.set(i / 32, words.get(i / 32) & ~(1U << (i % 32)));
+    }
+  };
+}
+
+#endif
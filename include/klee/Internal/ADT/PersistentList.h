@@ -0,0 +1,163 @@
+//===-- PersistentList.h ----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef __UTIL_PERSISTENTLIST_H__
+#define __UTIL_PERSISTENTLIST_H__
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace klee {
+  /// An append-only list whose copies share their common prefix.
+  ///
+  /// Elements are stored in reference counted nodes linked from the last
+  /// element towards the first one, so copying a list is O(1) and a
+  /// push_back only allocates the new node. Only the last element may be
+  /// modified in place; if it is shared with another list it is cloned
+  /// first (copy-on-write), leaving the rest of the prefix shared.
+  template<class T>
+  class PersistentList {
+    class Node {
+    public:
+      unsigned references;
+      Node *parent;
+      size_t depth;
+      T value;
+
+      Node(Node *_parent, const T &_value)
+        : references(1), parent(_parent),
+          depth(_parent ? _parent->depth + 1 : 1), value(_value) {
+        if (parent)
+          ++parent->references;
+      }
+    };
+
+    Node *tail;
+
+    static void release(Node *n) {
+      // Iterative, so that dropping a long unshared chain cannot
+      // overflow the stack.
+      while (n && --n->references == 0) {
+        Node *parent = n->parent;
+        delete n;
+        n = parent;
+      }
+    }
+
+  public:
+    typedef T value_type;
+    class const_iterator;
+    typedef const_iterator iterator;
+
+    PersistentList() : tail(0) {}
+    PersistentList(const PersistentList &b) : tail(b.tail) {
+      if (tail)
+        ++tail->references;
+    }
+    ~PersistentList() { release(tail); }
+
+    PersistentList &operator=(const PersistentList &b) {
+      if (b.tail)
+        ++b.tail->references;
+      release(tail);
+      tail = b.tail;
+      return *this;
+    }
+
+    bool empty() const { return tail == 0; }
+    size_t size() const { return tail ? tail->depth : 0; }
+
+    const T &back() const {
+      assert(tail && "back() on an empty list");
+      return tail->value;
+    }
+
+    /// Mutable access to the last element. Clones the last node if it is
+    /// shared with another list, so only use it to write.
+    T &getWriteableBack() {
+      assert(tail && "getWriteableBack() on an empty list");
+      if (tail->references > 1) {
+        Node *copy = new Node(tail->parent, tail->value);
+        --tail->references;
+        tail = copy;
+      }
+      return tail->value;
+    }
+
+    void push_back(const T &value) {
+      Node *n = new Node(tail, value);
+      release(tail);
+      tail = n;
+    }
+
+    const_iterator begin() const { return const_iterator(tail, 0); }
+    const_iterator end() const { return const_iterator(size()); }
+
+    /// An iterator at element \a first. Only the nodes from there on are
+    /// collected, so iterating over the last few elements of a long list
+    /// costs as many steps as there are elements to visit.
+    const_iterator from(size_t first) const {
+      assert(first <= size() && "position out of range");
+      return const_iterator(tail, first);
+    }
+  };
+
+  /// Forward iterator. The list is linked backwards, so begin() and from()
+  /// collect the node pointers once; this is amortized over the traversal.
+  template<class T>
+  class PersistentList<T>::const_iterator {
+    friend class PersistentList<T>;
+
+    /// The nodes from position \a first on.
+    std::shared_ptr<std::vector<const Node *> > nodes;
+    size_t first;
+    size_t pos;
+
+    const_iterator(const Node *last, size_t _first)
+      : first(_first), pos(_first) {
+      size_t n = last ? last->depth - first : 0;
+      if (n)
+        nodes = std::make_shared<std::vector<const Node *> >(n);
+      for (; n; last = last->parent)
+        (*nodes)[--n] = last;
+    }
+    explicit const_iterator(size_t _pos) : first(0), pos(_pos) {}
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T *pointer;
+    typedef const T &reference;
+
+    const_iterator() : first(0), pos(0) {}
+
+    const T &operator*() const { return (*nodes)[pos - first]->value; }
+    const T *operator->() const { return &(*nodes)[pos - first]->value; }
+
+    const_iterator &operator++() {
+      ++pos;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator it(*this);
+      ++pos;
+      return it;
+    }
+
+    // Iterators are only comparable when obtained from the same list.
+    bool operator==(const const_iterator &b) const { return pos == b.pos; }
+    bool operator!=(const const_iterator &b) const { return pos != b.pos; }
+  };
+}
+
+#endif
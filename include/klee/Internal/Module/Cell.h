@@ -15,8 +15,51 @@
 namespace klee {
   class MemoryObject;
 
+  /// A register. Constants of at most 64 bits are additionally kept
+  /// inline, so the interpreter can compute on them without going through
+  /// the Expr library; the ConstantExpr for such a cell is only built the
+  /// first time someone asks for it. This makes a cell 24 bytes rather than
+  /// the 8 of a bare ref<Expr>, which frames pay for every register.
   struct Cell {
-    ref<Expr> value;
+  private:
+    mutable ref<Expr> value;
+    uint64_t bits;
+    /// Width of the inline constant, or 0 if the cell holds an Expr (or
+    /// nothing at all).
+    Expr::Width width;
+
+  public:
+    Cell() : bits(0), width(0) {}
+
+    const ref<Expr> &getValue() const {
+      if (width && value.isNull())
+        value = ConstantExpr::create(bits, width);
+      return value;
+    }
+
+    void setValue(const ref<Expr> &e) {
+      value = e;
+      width = 0;
+      if (!e.isNull())
+        if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e))
+          if (ce->getWidth() <= 64) {
+            bits = ce->getZExtValue();
+            width = ce->getWidth();
+          }
+    }
+
+    /// Store a constant of the given width without building an Expr. Bits
+    /// above \a w are ignored.
+    void setConstant(uint64_t v, Expr::Width w) {
+      assert(w && w <= 64 && "invalid inline constant width");
+      value = ref<Expr>();
+      bits = w == 64 ? v : v & ((UINT64_C(1) << w) - 1);
+      width = w;
+    }
+
+    bool isInlineConstant() const { return width != 0; }
+    uint64_t getConstantBits() const { return bits; }
+    Expr::Width getConstantWidth() const { return width; }
   };
 }
 
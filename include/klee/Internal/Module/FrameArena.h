@@ -0,0 +1,94 @@
+//===-- FrameArena.h --------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_FRAMEARENA_H
+#define KLEE_FRAMEARENA_H
+
+#include "klee/Internal/Module/Cell.h"
+
+#include <cassert>
+#include <cstddef>
+
+namespace klee {
+  class FrameArena;
+
+  /// The registers of a stack frame.
+  ///
+  /// Copies share the underlying cells, so copying a stack on fork only
+  /// takes a reference per frame. The first write through a shared copy
+  /// clones the cells into the writer's arena.
+  class FrameLocals {
+    friend class FrameArena;
+
+  public:
+    struct Block;
+
+  private:
+    Block *block;
+
+    explicit FrameLocals(Block *_block) : block(_block) {}
+
+  public:
+    FrameLocals() : block(0) {}
+    FrameLocals(const FrameLocals &b);
+    ~FrameLocals();
+
+    FrameLocals &operator=(const FrameLocals &b);
+
+    const Cell &operator[](unsigned i) const {
+      assert(block && i < size() && "register out of range");
+      return cells()[i];
+    }
+
+    unsigned size() const;
+
+    /// Whether another frame (of this or another state) refers to the
+    /// same cells.
+    bool isShared() const;
+
+    /// The cells for writing, after cloning them into \a arena if they
+    /// are shared.
+    Cell *getWriteable(FrameArena &arena);
+
+  private:
+    const Cell *cells() const;
+  };
+
+  /// Bump allocator for the registers of the frames of one state.
+  ///
+  /// Cells are carved out of reference counted chunks, which start at the
+  /// size of the first frame and double from one chunk to the next. Frames
+  /// are mostly released in LIFO order, so freeing the most recent
+  /// allocation of a chunk gives the space back at once. Other frames are
+  /// kept on a free list for reuse while their chunk is the current one.
+  /// Chunks outlive the arena for as long as frames shared with forked
+  /// states live in them.
+  class FrameArena {
+  public:
+    struct Chunk;
+
+  private:
+    Chunk *current;
+
+    // A forked state starts a chunk of its own: its frames initially
+    // share those of its parent, and only new or written frames need
+    // space.
+    FrameArena(const FrameArena &);
+    FrameArena &operator=(const FrameArena &);
+
+  public:
+    FrameArena() : current(0) {}
+    ~FrameArena();
+
+    /// Allocate \a numCells empty registers.
+    FrameLocals allocate(unsigned numCells);
+  };
+}
+
+#endif
@@ -37,10 +37,13 @@ namespace klee {
     /// Value numbers for each operand. -1 is an invalid value,
     /// otherwise negative numbers are indices (negated and offset by
     /// 2) into the module constant table and positive numbers are
-    /// register indices.
+    /// register indices. Owned by the KFunction.
     int *operands;
     /// Destination register index.
     unsigned dest;
+    /// Copy of inst->getOpcode(), so that dispatch does not have to touch
+    /// the LLVM instruction.
+    unsigned opcode;
 
   public:
     virtual ~KInstruction();
@@ -60,10 +60,20 @@ namespace klee {
     /// "coverable" for statistics and search heuristics.
     bool trackCoverage;
 
+    /// Loops whose header calls klee_induce_invariants (or makes an
+    /// indirect call). Only these may start an invariant search, so only
+    /// entering these needs a snapshot of the entry state.
+    std::set<const llvm::Loop*> inductionLoops;
+
   private:
     KFunction(const KFunction&);
     KFunction &operator=(const KFunction&);
 
+    /// Backing store of the KInstructions and their operand arrays, laid
+    /// out in instruction order so that straight-line execution walks
+    /// through memory sequentially.
+    char *instructionArena;
+
     /// Keep track of the loops that were analysed on the subject of
     /// the invariants. Map these loops to the most general (i.e. the smallest)
     /// set of invariants.
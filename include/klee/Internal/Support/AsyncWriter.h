@@ -0,0 +1,50 @@
+//===-- AsyncWriter.h -------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+#ifndef __KLEE_ASYNC_WRITER_H__
+#define __KLEE_ASYNC_WRITER_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace klee {
+
+/// Runs output jobs (typically file writes) on background threads.
+///
+/// Jobs must not touch interpreter data: expressions are reference counted
+/// without synchronisation, so everything a job needs has to be rendered
+/// beforehand. The queue is bounded, submit() blocks while it is full.
+class AsyncWriter {
+  unsigned numThreads;
+  size_t maxPending;
+
+  std::mutex lock;
+  std::condition_variable jobAvailable, spaceAvailable;
+  std::deque<std::function<void()> > jobs;
+  std::vector<std::thread> threads;
+  bool stopping;
+
+  void work();
+
+public:
+  AsyncWriter(unsigned numThreads, size_t maxPending);
+  ~AsyncWriter();
+
+  void submit(const std::function<void()> &job);
+
+  /// Wait until all submitted jobs have run and stop the threads; the next
+  /// submit() starts them again. Must be called before fork().
+  void flush();
+};
+}
+
+#endif
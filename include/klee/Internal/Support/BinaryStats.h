@@ -0,0 +1,116 @@
+//===-- BinaryStats.h -------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_BINARYSTATS_H
+#define KLEE_BINARYSTATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace llvm {
+  class raw_ostream;
+}
+
+namespace klee {
+  /// One line of run.stats: named integer and real columns.
+  class StatsRecord {
+  public:
+    struct Column {
+      const char *name;
+      bool isReal;
+    };
+
+  private:
+    std::vector<Column> columns;
+    /// Integers as such, reals as the bits of a double.
+    std::vector<uint64_t> values;
+
+  public:
+    void addInteger(const char *name, uint64_t value);
+    void addReal(const char *name, double value);
+
+    unsigned size() const { return columns.size(); }
+    const Column &getColumn(unsigned i) const { return columns[i]; }
+    uint64_t getInteger(unsigned i) const { return values[i]; }
+    double getReal(unsigned i) const;
+
+    /// Write the record as a text tuple, as in run.stats.
+    void print(llvm::raw_ostream &os) const;
+    /// Write the column names as a text tuple, as in run.stats.
+    void printHeader(llvm::raw_ostream &os) const;
+  };
+
+  /// The binary form of run.stats, run.stats.bin, is a header holding the
+  /// schema followed by fixed-width records, appended as the run goes:
+  ///
+  ///   u32 magic, u32 version, u32 number of columns,
+  ///   per column: u8 type (0 integer, 1 real), u8 name length, name;
+  ///   per record: one 8 byte value per column.
+  ///
+  /// Values are in host byte order; the magic tells readers on a host of
+  /// the other endianness apart. A record cut short by a crash is ignored.
+  namespace binary_stats {
+    const uint32_t Magic = 0x4b535442;
+    const uint32_t Version = 1;
+
+    void writeHeader(llvm::raw_ostream &os, const StatsRecord &record);
+    void writeRecord(llvm::raw_ostream &os, const StatsRecord &record);
+  }
+
+  /// Memory-maps a run.stats.bin file for random access to its records.
+  class BinaryStatsReader {
+  public:
+    struct Column {
+      std::string name;
+      bool isReal;
+    };
+
+  private:
+    int fd;
+    const char *data;
+    size_t mappedSize;
+    size_t headerSize;
+    size_t numRecords;
+    std::vector<Column> columns;
+
+    BinaryStatsReader(const BinaryStatsReader &);
+    BinaryStatsReader &operator=(const BinaryStatsReader &);
+
+    void unmap();
+    const char *getSlot(size_t record, unsigned column) const {
+      return data + headerSize + (record * columns.size() + column) * 8;
+    }
+
+  public:
+    BinaryStatsReader();
+    ~BinaryStatsReader();
+
+    /// Map \a path. Returns false with a message in \a error if it cannot
+    /// be read or is not a binary stats file.
+    bool open(const std::string &path, std::string &error);
+
+    /// Remap the file to pick up the records appended since it was
+    /// opened, e.g. to follow a run in progress.
+    bool refresh(std::string &error);
+
+    const std::vector<Column> &getColumns() const { return columns; }
+    /// Index of the column called \a name, or -1.
+    int getColumnIndex(const std::string &name) const;
+
+    size_t getNumRecords() const { return numRecords; }
+    uint64_t getInteger(size_t record, unsigned column) const;
+    double getReal(size_t record, unsigned column) const;
+    /// The value of any column, converted to a double.
+    double getValue(size_t record, unsigned column) const;
+  };
+}
+
+#endif
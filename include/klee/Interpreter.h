@@ -27,6 +27,7 @@ class raw_fd_ostream;
 }
 
 namespace klee {
+class CallPrefixTree;
 class ExecutionState;
 class Interpreter;
 class TreeStreamWriter;
@@ -47,6 +48,24 @@ public:
                                const char *err, 
                                const char *suffix) = 0;
   virtual void processCallPath(const ExecutionState &state) = 0;
+  /// The tree to record the call prefixes of the states in as they run,
+  /// or null.
+  virtual CallPrefixTree *getCallPrefixTree() { return 0; }
+
+  /// Block until all outputs have been written. Called before the process
+  /// forks or exits.
+  virtual void flushOutputs() {}
+
+  /// Called in a freshly forked process that explores one chunk of a
+  /// split exploration (see --parallel-workers). Outputs written from now
+  /// on must not clash with those of other chunks.
+  virtual void beginChunk(unsigned chunk, unsigned numChunks) {}
+  /// Called in the coordinating process once all chunks are explored.
+  virtual void mergeChunks(unsigned numChunks) {}
+  /// Called once the execution tree has been split for
+  /// InterpreterOptions::NumPartitions; the paths finished before are
+  /// shared by all partitions.
+  virtual void beginPartition(unsigned partition, unsigned numPartitions) {}
 };
 
 struct HavocedLocation {
@@ -92,9 +111,17 @@ public:
     /// that alter their value during the loop invariant analysis.
     bool CondoneUndeclaredHavocs;
 
+    /// When NumPartitions is non-zero, the execution tree is split as soon
+    /// as it has NumPartitions leaves and only the leaves with index
+    /// Partition (modulo NumPartitions) are explored further.
+    unsigned Partition;
+    unsigned NumPartitions;
+
     InterpreterOptions()
       : MakeConcreteSymbolic(false),
-        CondoneUndeclaredHavocs(false)
+        CondoneUndeclaredHavocs(false),
+        Partition(0),
+        NumPartitions(0)
     {}
   };
 
@@ -19,6 +19,7 @@ namespace klee {
   class ConstraintManager;
   class Expr;
   class SolverImpl;
+  class Statistic;
 
   struct Query {
   public:
@@ -226,6 +227,23 @@ namespace klee {
   /// \param s - The underlying solver to use.
   Solver *createCachingSolver(Solver *s);
 
+  /// createCanonicalizingSolver - Create a solver which will rename the
+  /// symbolic arrays of each query by their order of appearance, so that
+  /// queries equal up to the naming of their arrays reach the underlying
+  /// solver, and the caches in it, as the same query.
+  ///
+  /// \param s - The underlying solver to use.
+  Solver *createCanonicalizingSolver(Solver *s);
+
+  /// createPersistentCachingSolver - Create a solver which will cache the
+  /// results of truth, validity and value queries in a file, shared by all
+  /// the processes using the same path. The file is read on creation and
+  /// written back when the solver is destroyed.
+  ///
+  /// \param s - The underlying solver to use.
+  /// \param path - The cache file, created if it does not exist.
+  Solver *createPersistentCachingSolver(Solver *s, const std::string &path);
+
   /// createCexCachingSolver - Create a counterexample caching solver. This is a
   /// more sophisticated cache which records counterexamples for a constraint
   /// set and uses subset/superset relations among constraints to try and
@@ -263,6 +281,16 @@ namespace klee {
   /// fails.
   Solver *createDummySolver();
 
+  /// createPortfolioSolver - Create a solver which runs all of the given core
+  /// solvers on each query at once, each in a forked process, and answers
+  /// with the first of them to succeed.
+  ///
+  /// \param solvers - The core solvers to race; the portfolio owns them.
+  /// \param wins - For each solver, the statistic counting the queries it
+  /// answered first.
+  Solver *createPortfolioSolver(const std::vector<Solver *> &solvers,
+                                const std::vector<Statistic *> &wins);
+
   // Create a solver based on the supplied ``CoreSolverType``.
   Solver *createCoreSolver(CoreSolverType cst);
 }
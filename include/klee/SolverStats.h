@@ -16,6 +16,11 @@ namespace klee {
 namespace stats {
 
   extern Statistic cexCacheTime;
+  extern Statistic persistentCacheHits;
+  extern Statistic persistentCacheMisses;
+  extern Statistic portfolioWinsMetaSMT;
+  extern Statistic portfolioWinsSTP;
+  extern Statistic portfolioWinsZ3;
   extern Statistic queries;
   extern Statistic queriesInvalid;
   extern Statistic queriesValid;
@@ -26,6 +31,7 @@ namespace stats {
   extern Statistic queryConstructTime;
   extern Statistic queryConstructs;
   extern Statistic queryCounterexamples;
+  extern Statistic queryReusedConstraints;
   extern Statistic queryTime;
   
 #ifdef KLEE_ARRAY_DEBUG
@@ -0,0 +1,81 @@
+//===-- ConstraintFactors.h -------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_CONSTRAINTFACTORS_H
+#define KLEE_CONSTRAINTFACTORS_H
+
+#include "klee/Expr.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace klee {
+  /// The partition of a list of constraints into independent factors: two
+  /// constraints are in the same factor if they read a common byte of a
+  /// symbolic array, directly or through other constraints. A read at a
+  /// symbolic index counts as reading every byte of its array.
+  ///
+  /// Constraints can only be added, each in time proportional to its reads
+  /// (union-find over the constraints, with the last constraint seen
+  /// reading each byte and each array).
+  class ConstraintFactors {
+  public:
+    /// The bytes of symbolic arrays an expression reads.
+    struct Reads {
+      /// Bytes read at constant indices.
+      std::map<const Array *, std::set<unsigned> > bytes;
+      /// Arrays read at a symbolic index.
+      std::set<const Array *> wholeArrays;
+
+      Reads() {}
+      explicit Reads(const ref<Expr> &e);
+    };
+
+  private:
+    struct ArrayReaders {
+      /// A constraint reading the array, if any does.
+      int any;
+      /// Whether the array is read at a symbolic index, in which case all
+      /// of its readers are in one factor.
+      bool whole;
+      /// A constraint reading each byte, until the array is read whole.
+      std::map<unsigned, unsigned> bytes;
+
+      ArrayReaders() : any(-1), whole(false) {}
+    };
+
+    /// The union-find forest over the constraints.
+    mutable std::vector<unsigned> parent;
+    /// The constraints of the factor rooted at each constraint.
+    std::vector<std::vector<unsigned> > members;
+    std::map<const Array *, ArrayReaders> arrays;
+
+    unsigned find(unsigned constraint) const;
+    void merge(unsigned a, unsigned b);
+
+  public:
+    /// Add a constraint, the size()th.
+    void add(const ref<Expr> &constraint);
+
+    /// The number of constraints added.
+    size_t size() const { return parent.size(); }
+
+    /// The factor of a constraint, as the constraint representing it.
+    unsigned getFactor(unsigned constraint) const { return find(constraint); }
+
+    /// The constraints of a factor, in the order they were added.
+    std::vector<unsigned> getMembers(unsigned factor) const;
+
+    /// The factors which share a byte with \a reads.
+    void getFactors(const Reads &reads, std::set<unsigned> &result) const;
+  };
+}
+
+#endif
@@ -170,10 +170,22 @@ CoreSolverToUse("solver-backend", cl::desc("Specifiy the core solver backend to
                 cl::values(clEnumValN(STP_SOLVER, "stp", "stp" STP_IS_DEFAULT_STR),
                            clEnumValN(METASMT_SOLVER, "metasmt", "metaSMT" METASMT_IS_DEFAULT_STR),
                            clEnumValN(DUMMY_SOLVER, "dummy", "Dummy solver"),
-                           clEnumValN(Z3_SOLVER, "z3", "Z3" Z3_IS_DEFAULT_STR)
+                           clEnumValN(Z3_SOLVER, "z3", "Z3" Z3_IS_DEFAULT_STR),
+                           clEnumValN(PORTFOLIO_SOLVER, "portfolio",
+                                      "Race the --portfolio-solvers backends")
                            KLEE_LLVM_CL_VAL_END),
                 cl::init(DEFAULT_CORE_SOLVER));
 
+cl::list<CoreSolverType>
+PortfolioSolvers("portfolio-solvers",
+                 cl::desc("The backends raced by --solver-backend=portfolio "
+                          "(default=every backend compiled in)"),
+                 cl::values(clEnumValN(STP_SOLVER, "stp", "stp"),
+                            clEnumValN(METASMT_SOLVER, "metasmt", "metaSMT"),
+                            clEnumValN(Z3_SOLVER, "z3", "Z3")
+                            KLEE_LLVM_CL_VAL_END),
+                 cl::CommaSeparated);
+
 cl::opt<CoreSolverType>
 DebugCrossCheckCoreSolverWith("debug-crosscheck-core-solver",
                               cl::desc("Specifiy a solver to use for cross checking with the core solver"),
@@ -10,11 +10,14 @@
 #include "AddressSpace.h"
 #include "CoreStats.h"
 #include "Memory.h"
+#include "Profiler.h"
 #include "TimingSolver.h"
 
 #include "klee/Expr.h"
 #include "klee/TimerStatIncrementer.h"
 
+#include <algorithm>
+
 using namespace klee;
 
 ///
@@ -35,6 +38,10 @@ const ObjectState *AddressSpace::findObject(const MemoryObject *mo) const {
   return res ? res->second : 0;
 }
 
+bool AddressSpace::isOwned(const ObjectState *os) const {
+  return os->copyOnWriteOwner == cowKey;
+}
+
 ObjectState *AddressSpace::allowAccess(const MemoryObject *mo,
                                const ObjectState *os) {
   assert(!os->readOnly);
@@ -88,6 +95,165 @@ bool AddressSpace::resolveOne(const ref<ConstantExpr> &addr,
   return false;
 }
 
+/// Conservative unsigned bounds on the value of \a e, derived from its
+/// structure alone. Anything not understood spans the full range of its
+/// width.
+static void getStructuralBounds(const ref<Expr> &e, uint64_t &min,
+                                uint64_t &max, unsigned depth = 0) {
+  Expr::Width width = e->getWidth();
+  uint64_t mask = width >= 64 ? ~UINT64_C(0) : (UINT64_C(1) << width) - 1;
+  min = 0;
+  max = mask;
+  // Deep (and possibly heavily shared) expressions are not worth it.
+  if (width > 64 || depth > 16)
+    return;
+
+  uint64_t kmin, kmax, cmin, cmax;
+  switch (e->getKind()) {
+  case Expr::Constant:
+    min = max = cast<ConstantExpr>(e)->getZExtValue();
+    return;
+
+  case Expr::ZExt:
+    getStructuralBounds(e->getKid(0), min, max, depth + 1);
+    return;
+
+  case Expr::Select:
+    getStructuralBounds(e->getKid(1), min, max, depth + 1);
+    getStructuralBounds(e->getKid(2), kmin, kmax, depth + 1);
+    min = std::min(min, kmin);
+    max = std::max(max, kmax);
+    return;
+
+  case Expr::Add:
+    getStructuralBounds(e->getKid(0), kmin, kmax, depth + 1);
+    getStructuralBounds(e->getKid(1), cmin, cmax, depth + 1);
+    if (kmax <= mask - cmax) {
+      min = kmin + cmin;
+      max = kmax + cmax;
+    }
+    return;
+
+  case Expr::Mul:
+  case Expr::Shl: {
+    ref<Expr> kid = e->getKid(0);
+    const ConstantExpr *ce = dyn_cast<ConstantExpr>(e->getKid(1));
+    if (!ce && e->getKind() == Expr::Mul) {
+      ce = dyn_cast<ConstantExpr>(kid);
+      kid = e->getKid(1);
+    }
+    if (!ce)
+      return;
+    uint64_t factor = ce->getZExtValue();
+    if (e->getKind() == Expr::Shl) {
+      if (factor >= width)
+        return;
+      factor = UINT64_C(1) << factor;
+    }
+    getStructuralBounds(kid, kmin, kmax, depth + 1);
+    if (factor && kmax <= mask / factor) {
+      min = kmin * factor;
+      max = kmax * factor;
+    }
+    return;
+  }
+
+  case Expr::LShr:
+    if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e->getKid(1))) {
+      uint64_t shift = ce->getZExtValue();
+      if (shift < width) {
+        getStructuralBounds(e->getKid(0), kmin, kmax, depth + 1);
+        min = kmin >> shift;
+        max = kmax >> shift;
+      }
+    }
+    return;
+
+  case Expr::And:
+    getStructuralBounds(e->getKid(0), kmin, kmax, depth + 1);
+    getStructuralBounds(e->getKid(1), cmin, cmax, depth + 1);
+    max = std::min(kmax, cmax);
+    return;
+
+  case Expr::URem:
+    if (const ConstantExpr *ce = dyn_cast<ConstantExpr>(e->getKid(1))) {
+      uint64_t divisor = ce->getZExtValue();
+      if (divisor) {
+        getStructuralBounds(e->getKid(0), kmin, kmax, depth + 1);
+        max = std::min(kmax, divisor - 1);
+      }
+    }
+    return;
+
+  default:
+    return;
+  }
+}
+
+void AddressSpace::getCandidates(ref<Expr> p,
+                                 ResolutionList &candidates) const {
+  uint64_t min, max;
+  getStructuralBounds(p, min, max);
+
+  // The object containing min starts at or before it.
+  MemoryObject hackMin(min), hackMax(max);
+  MemoryMap::iterator oi = objects.upper_bound(&hackMin);
+  if (oi != objects.begin())
+    --oi;
+  for (MemoryMap::iterator oe = objects.upper_bound(&hackMax); oi != oe; ++oi)
+    candidates.push_back(*oi);
+}
+
+/// Add to \a rl, in address order, the objects of candidates[lo, hi) that
+/// \a p may point into, until \a maxResolutions (if non-zero) are found.
+///
+/// The candidates are disjoint and sorted by address, so a whole range can
+/// be ruled out with a single query on its hull. The number of queries is
+/// then proportional to the number of feasible objects (times the depth of
+/// the bisection) rather than to the number of candidates.
+///
+/// \return false if a query failed or the timeout expired.
+static bool searchCandidates(ExecutionState &state, TimingSolver *solver,
+                             ref<Expr> p, const ResolutionList &candidates,
+                             unsigned lo, unsigned hi, ResolutionList &rl,
+                             unsigned maxResolutions,
+                             TimerStatIncrementer &timer,
+                             uint64_t timeout_us) {
+  if (lo >= hi || (maxResolutions && rl.size() >= maxResolutions))
+    return true;
+  if (timeout_us && timeout_us < timer.check())
+    return false;
+
+  ref<Expr> inRange;
+  if (hi - lo == 1) {
+    inRange = candidates[lo].first->getBoundsCheckPointer(p);
+  } else {
+    const MemoryObject *first = candidates[lo].first;
+    const MemoryObject *last = candidates[hi - 1].first;
+    uint64_t lastByte = last->address + (last->size ? last->size - 1 : 0);
+    inRange = AndExpr::create(
+        UgeExpr::create(p, first->getBaseExpr()),
+        UleExpr::create(p, ConstantExpr::create(lastByte, p->getWidth())));
+  }
+
+  bool mayBeTrue;
+  if (!solver->mayBeTrue(state, inRange, mayBeTrue))
+    return false;
+  if (!mayBeTrue)
+    return true;
+
+  if (hi - lo == 1) {
+    rl.push_back(candidates[lo]);
+    return true;
+  }
+
+  unsigned mid = lo + (hi - lo) / 2;
+  return searchCandidates(state, solver, p, candidates, lo, mid, rl,
+                          maxResolutions, timer, timeout_us) &&
+         searchCandidates(state, solver, p, candidates, mid, hi, rl,
+                          maxResolutions, timer, timeout_us);
+}
+
 bool AddressSpace::resolveOne(ExecutionState &state,
                               TimingSolver *solver,
                               ref<Expr> address,
@@ -98,82 +264,29 @@ bool AddressSpace::resolveOne(ExecutionState &state,
     return true;
   } else {
     TimerStatIncrementer timer(stats::resolveTime);
+    ProfileScope scope(Profiler::Resolve);
 
     // try cheap search, will succeed for any inbounds pointer
 
     ref<ConstantExpr> cex;
     if (!solver->getValue(state, address, cex))
       return false;
-    uint64_t example = cex->getZExtValue();
-    MemoryObject hack(example);
-    const MemoryMap::value_type *res = objects.lookup_previous(&hack);
-    
-    if (res) {
-      const MemoryObject *mo = res->first;
-      if (example - mo->address < mo->size) {
-        result = *res;
-        success = true;
-        return true;
-      }
+    if (resolveOne(cex, result)) {
+      success = true;
+      return true;
     }
 
     // didn't work, now we have to search
-       
-    MemoryMap::iterator oi = objects.upper_bound(&hack);
-    MemoryMap::iterator begin = objects.begin();
-    MemoryMap::iterator end = objects.end();
-      
-    MemoryMap::iterator start = oi;
-    while (oi!=begin) {
-      --oi;
-      const MemoryObject *mo = oi->first;
-        
-      bool mayBeTrue;
-      if (!solver->mayBeTrue(state, 
-                             mo->getBoundsCheckPointer(address), mayBeTrue))
-        return false;
-      if (mayBeTrue) {
-        result = *oi;
-        success = true;
-        return true;
-      } else {
-        bool mustBeTrue;
-        if (!solver->mustBeTrue(state, 
-                                UgeExpr::create(address, mo->getBaseExpr()),
-                                mustBeTrue))
-          return false;
-        if (mustBeTrue)
-          break;
-      }
-    }
 
-    // search forwards
-    for (oi=start; oi!=end; ++oi) {
-      const MemoryObject *mo = oi->first;
-
-      bool mustBeTrue;
-      if (!solver->mustBeTrue(state, 
-                              UltExpr::create(address, mo->getBaseExpr()),
-                              mustBeTrue))
-        return false;
-      if (mustBeTrue) {
-        break;
-      } else {
-        bool mayBeTrue;
-
-        if (!solver->mayBeTrue(state, 
-                               mo->getBoundsCheckPointer(address),
-                               mayBeTrue))
-          return false;
-        if (mayBeTrue) {
-          result = *oi;
-          success = true;
-          return true;
-        }
-      }
-    }
+    ResolutionList candidates, rl;
+    getCandidates(address, candidates);
+    if (!searchCandidates(state, solver, address, candidates,
+                          0, candidates.size(), rl, 1, timer, 0))
+      return false;
 
-    success = false;
+    success = !rl.empty();
+    if (success)
+      result = rl.front();
     return true;
   }
 }
@@ -191,113 +304,57 @@ bool AddressSpace::resolve(ExecutionState &state,
     return false;
   } else {
     TimerStatIncrementer timer(stats::resolveTime);
+    ProfileScope scope(Profiler::Resolve);
     uint64_t timeout_us = (uint64_t) (timeout*1000000.);
 
-    // XXX in general this isn't exactly what we want... for
-    // a multiple resolution case (or for example, a \in {b,c,0})
-    // we want to find the first object, find a cex assuming
-    // not the first, find a cex assuming not the second...
-    // etc.
-    
-    // XXX how do we smartly amortize the cost of checking to
-    // see if we need to keep searching up/down, in bad cases?
-    // maybe we don't care?
-    
-    // XXX we really just need a smart place to start (although
-    // if its a known solution then the code below is guaranteed
-    // to hit the fast path with exactly 2 queries). we could also
-    // just get this by inspection of the expr.
-    
+    ResolutionList candidates;
+    getCandidates(p, candidates);
+
+    // Start from the object a solution of p lands in, if any: for an
+    // inbounds pointer one more query proves it is the only one.
     ref<ConstantExpr> cex;
     if (!solver->getValue(state, p, cex))
       return true;
     uint64_t example = cex->getZExtValue();
-    MemoryObject hack(example);
-    
-    MemoryMap::iterator oi = objects.upper_bound(&hack);
-    MemoryMap::iterator begin = objects.begin();
-    MemoryMap::iterator end = objects.end();
-      
-    MemoryMap::iterator start = oi;
-      
-    // XXX in the common case we can save one query if we ask
-    // mustBeTrue before mayBeTrue for the first result. easy
-    // to add I just want to have a nice symbolic test case first.
-      
-    // search backwards, start with one minus because this
-    // is the object that p *should* be within, which means we
-    // get write off the end with 4 queries (XXX can be better,
-    // no?)
-    while (oi!=begin) {
-      --oi;
-      const MemoryObject *mo = oi->first;
-      if (timeout_us && timeout_us < timer.check())
-        return true;
 
-      // XXX I think there is some query wasteage here?
-      ref<Expr> inBounds = mo->getBoundsCheckPointer(p);
-      bool mayBeTrue;
-      if (!solver->mayBeTrue(state, inBounds, mayBeTrue))
-        return true;
-      if (mayBeTrue) {
-        rl.push_back(*oi);
-        
-        // fast path check
-        unsigned size = rl.size();
-        if (size==1) {
-          bool mustBeTrue;
-          if (!solver->mustBeTrue(state, inBounds, mustBeTrue))
-            return true;
-          if (mustBeTrue)
-            return false;
-        } else if (size==maxResolutions) {
-          return true;
-        }
-      }
-        
-      bool mustBeTrue;
-      if (!solver->mustBeTrue(state, 
-                              UgeExpr::create(p, mo->getBaseExpr()),
-                              mustBeTrue))
-        return true;
-      if (mustBeTrue)
+    unsigned split = candidates.size();
+    for (unsigned i = 0; i < candidates.size(); ++i) {
+      const MemoryObject *mo = candidates[i].first;
+      if ((mo->size == 0 && example == mo->address) ||
+          example - mo->address < mo->size) {
+        split = i;
         break;
+      }
     }
-    // search forwards
-    for (oi=start; oi!=end; ++oi) {
-      const MemoryObject *mo = oi->first;
-      if (timeout_us && timeout_us < timer.check())
-        return true;
 
+    if (split == candidates.size()) {
+      if (!searchCandidates(state, solver, p, candidates, 0, split, rl,
+                            maxResolutions, timer, timeout_us))
+        return true;
+    } else {
       bool mustBeTrue;
-      if (!solver->mustBeTrue(state, 
-                              UltExpr::create(p, mo->getBaseExpr()),
+      if (!solver->mustBeTrue(state,
+                              candidates[split].first->getBoundsCheckPointer(p),
                               mustBeTrue))
         return true;
-      if (mustBeTrue)
-        break;
-      
-      // XXX I think there is some query wasteage here?
-      ref<Expr> inBounds = mo->getBoundsCheckPointer(p);
-      bool mayBeTrue;
-      if (!solver->mayBeTrue(state, inBounds, mayBeTrue))
-        return true;
-      if (mayBeTrue) {
-        rl.push_back(*oi);
-        
-        // fast path check
-        unsigned size = rl.size();
-        if (size==1) {
-          bool mustBeTrue;
-          if (!solver->mustBeTrue(state, inBounds, mustBeTrue))
-            return true;
-          if (mustBeTrue)
-            return false;
-        } else if (size==maxResolutions) {
-          return true;
-        }
+      if (mustBeTrue) {
+        rl.push_back(candidates[split]);
+        return false;
       }
+
+      if (!searchCandidates(state, solver, p, candidates, 0, split, rl,
+                            maxResolutions, timer, timeout_us))
+        return true;
+      if (!maxResolutions || rl.size() < maxResolutions)
+        rl.push_back(candidates[split]);
+      if (!searchCandidates(state, solver, p, candidates, split + 1,
+                            candidates.size(), rl, maxResolutions, timer,
+                            timeout_us))
+        return true;
     }
+
+    if (maxResolutions && rl.size() >= maxResolutions)
+      return true;
   }
 
   return false;
@@ -319,7 +376,7 @@ void AddressSpace::copyOutConcretes() {
       auto address = reinterpret_cast<std::uint8_t*>(mo->address);
 
       if (!os->readOnly)
-        memcpy(address, os->concreteStore, mo->size);
+        os->concreteStore.copyTo(address);
     }
   }
 }
@@ -343,12 +400,12 @@ bool AddressSpace::copyInConcretes() {
 bool AddressSpace::copyInConcrete(const MemoryObject *mo, const ObjectState *os,
                                   uint64_t src_address) {
   auto address = reinterpret_cast<std::uint8_t*>(src_address);
-  if (memcmp(address, os->concreteStore, mo->size) != 0) {
+  if (!os->concreteStore.equals(address)) {
     if (os->readOnly) {
       return false;
     } else {
       ObjectState *wos = getWriteable(mo, os);
-      memcpy(wos->concreteStore, address, mo->size);
+      wos->concreteStore.copyFrom(address);
     }
   }
   return true;
@@ -40,6 +40,10 @@ namespace klee {
 
     /// Unsupported, use copy constructor
     AddressSpace &operator=(const AddressSpace&); 
+
+    /// Collect, in address order, the objects that could contain \a p
+    /// judging by the constant bounds of its expression.
+    void getCandidates(ref<Expr> p, ResolutionList &candidates) const;
     
   public:
     /// The MemoryObject -> ObjectState map that constitutes the
@@ -100,6 +104,10 @@ namespace klee {
     /// Lookup a binding from a MemoryObject.
     const ObjectState *findObject(const MemoryObject *mo) const;
 
+    /// Check whether \a os is private to this address space, i.e. whether
+    /// it was bound or made writeable since the space was last copied.
+    bool isOwned(const ObjectState *os) const;
+
     /// \brief Obtain an ObjectState suitable for writing.
     ///
     /// This returns a writeable object state, creating a new copy of
@@ -0,0 +1,271 @@
+//===-- CallPrefixTree.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/CallPrefixTree.h"
+
+#include "klee/ExecutionState.h"
+
+#include "llvm/ADT/Hashing.h"
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+#include <vector>
+
+using namespace klee;
+
+struct CallPrefixTree::Interned {
+  CallInfo call;
+  size_t hash;
+  unsigned refs;
+
+  Interned(const CallInfo &_call, size_t _hash)
+    : call(_call), hash(_hash), refs(0) {}
+};
+
+/// Interned calls by hash. The hash agrees with CallInfo::eq(), which
+/// does not compare argument names or call sites, and compares the
+/// contexts as sets.
+class CallPrefixTree::InternTable {
+public:
+  std::unordered_multimap<size_t, Interned *> map;
+};
+
+static size_t hashExpr(const ref<Expr> &e) {
+  return e.isNull() ? 0 : e->hash();
+}
+
+static size_t hashContext(const std::vector<ref<Expr> > &context) {
+  // equalContexts() compares the contexts as sets of the same size, so
+  // neither order nor repetitions may matter.
+  std::vector<unsigned> hashes;
+  hashes.reserve(context.size());
+  for (std::vector<ref<Expr> >::const_iterator it = context.begin(),
+         ie = context.end(); it != ie; ++it)
+    hashes.push_back((*it)->hash());
+  std::sort(hashes.begin(), hashes.end());
+  hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+  return llvm::hash_combine(
+      context.size(), llvm::hash_combine_range(hashes.begin(), hashes.end()));
+}
+
+static size_t hashCall(const CallInfo &call) {
+  size_t hash = llvm::hash_combine(call.f, call.returned, call.args.size(),
+                                   call.extraPtrs.size());
+  for (std::vector<CallArg>::const_iterator it = call.args.begin(),
+         ie = call.args.end(); it != ie; ++it)
+    hash = llvm::hash_combine(hash, hashExpr(it->expr), it->isPtr);
+  for (std::map<size_t, CallExtraPtr>::const_iterator
+         it = call.extraPtrs.begin(), ie = call.extraPtrs.end();
+       it != ie; ++it)
+    hash = llvm::hash_combine(hash, it->first);
+  return llvm::hash_combine(hash, hashExpr(call.ret.expr), call.ret.isPtr,
+                            hashContext(call.callContext),
+                            hashContext(call.returnContext));
+}
+
+const CallInfo &CallPrefixTree::Node::getCall() const {
+  assert(call && "the root has no call");
+  return call->call;
+}
+
+CallPrefixTree::CallPrefixTree()
+  : root(0, 0), calls(new InternTable()), flushing(false) {}
+
+CallPrefixTree::~CallPrefixTree() {
+  for (std::vector<Node *>::iterator it = root.children.begin(),
+         ie = root.children.end(); it != ie; ++it)
+    deleteSubtree(*it);
+  assert(calls->map.empty() && "interned call leaked");
+  delete calls;
+}
+
+CallPrefixTree::Interned *CallPrefixTree::intern(const CallInfo &call) {
+  size_t hash = hashCall(call);
+  typedef std::unordered_multimap<size_t, Interned *>::iterator iterator;
+  std::pair<iterator, iterator> range = calls->map.equal_range(hash);
+  for (iterator it = range.first; it != range.second; ++it) {
+    if (it->second->call.eq(call)) {
+      ++it->second->refs;
+      return it->second;
+    }
+  }
+  Interned *interned = new Interned(call, hash);
+  interned->refs = 1;
+  calls->map.insert(std::make_pair(hash, interned));
+  return interned;
+}
+
+void CallPrefixTree::unintern(Interned *call) {
+  if (--call->refs)
+    return;
+  typedef std::unordered_multimap<size_t, Interned *>::iterator iterator;
+  std::pair<iterator, iterator> range = calls->map.equal_range(call->hash);
+  for (iterator it = range.first; it != range.second; ++it) {
+    if (it->second == call) {
+      calls->map.erase(it);
+      break;
+    }
+  }
+  delete call;
+}
+
+size_t CallPrefixTree::getNumCalls() const {
+  return calls->map.size();
+}
+
+CallPrefixTree::Node *CallPrefixTree::getChild(Node *n,
+                                               const CallInfo &call) {
+  assert(!n->flushed && "extending a closed prefix");
+  // Interned calls are equal iff they are the same object.
+  Interned *interned = intern(call);
+  for (std::vector<Node *>::iterator it = n->children.begin(),
+         ie = n->children.end(); it != ie; ++it) {
+    if ((*it)->call == interned) {
+      unintern(interned);
+      return *it;
+    }
+  }
+  n->children.push_back(new Node(n, interned));
+  return n->children.back();
+}
+
+void CallPrefixTree::retain(Node *n) {
+  bool wasLive = n->isLive();
+  ++n->states;
+  if (wasLive)
+    return;
+  for (Node *m = n; m->parent; m = m->parent) {
+    bool parentWasLive = m->parent->isLive();
+    ++m->parent->liveChildren;
+    if (parentWasLive)
+      break;
+  }
+}
+
+void CallPrefixTree::release(Node *n) {
+  assert(n->states && "releasing a node without states");
+  if (--n->states)
+    return;
+
+  for (Node *m = n; m->parent && !m->isLive(); m = m->parent) {
+    if (!m->closing) {
+      m->closing = true;
+      m->parent->closed.push_back(m);
+    }
+    --m->parent->liveChildren;
+  }
+
+  if (!flushing)
+    return;
+
+  // Flush, from the top, the closed subtrees with no state above them.
+  std::vector<Node *> path;
+  for (Node *m = n; m; m = m->parent)
+    path.push_back(m);
+  for (unsigned i = path.size(); i--;) {
+    if (path[i]->states)
+      return;
+    flushClosed(path[i]);
+    if (i && path[i - 1]->flushed)
+      return;
+  }
+  // The states at n may have been all that held back closed subtrees
+  // further down.
+  flushBelow(n);
+}
+
+void CallPrefixTree::flushClosed(Node *n) {
+  std::vector<Node *> closed;
+  closed.swap(n->closed);
+  for (std::vector<Node *>::iterator it = closed.begin(), ie = closed.end();
+       it != ie; ++it) {
+    (*it)->closing = false;
+    // A state may have entered the subtree again since it was closed.
+    if (!(*it)->isLive() && !(*it)->flushed)
+      flushSubtree(*it);
+  }
+}
+
+void CallPrefixTree::flushBelow(Node *n) {
+  for (std::vector<Node *>::iterator it = n->children.begin(),
+         ie = n->children.end(); it != ie; ++it) {
+    if ((*it)->isLive() && !(*it)->states) {
+      flushClosed(*it);
+      flushBelow(*it);
+    }
+  }
+}
+
+void CallPrefixTree::flushSubtree(Node *n) {
+  assert(!n->isLive() && "flushing a prefix that may still grow");
+  if (n->pathId)
+    flush(*n);
+  for (std::vector<Node *>::iterator it = n->children.begin(),
+         ie = n->children.end(); it != ie; ++it) {
+    if (!(*it)->flushed)
+      flushSubtree(*it);
+    deleteSubtree(*it);
+  }
+  n->children.clear();
+  n->closed.clear();
+  n->flushed = true;
+}
+
+void CallPrefixTree::deleteSubtree(Node *n) {
+  for (std::vector<Node *>::iterator it = n->children.begin(),
+         ie = n->children.end(); it != ie; ++it)
+    deleteSubtree(*it);
+  unintern(n->call);
+  delete n;
+}
+
+void CallPrefixTree::finishPath(Node *n, unsigned pathId) {
+  // The ancestors of a node with a path id have one as well.
+  for (Node *m = n; m && !m->pathId; m = m->parent)
+    m->pathId = pathId;
+}
+
+void CallPrefixTree::forgetPaths() {
+  forgetPaths(&root);
+}
+
+void CallPrefixTree::forgetPaths(Node *n) {
+  n->pathId = 0;
+  n->closed.clear();
+  std::vector<Node *> children;
+  for (std::vector<Node *>::iterator it = n->children.begin(),
+         ie = n->children.end(); it != ie; ++it) {
+    (*it)->closing = false;
+    if ((*it)->isLive()) {
+      forgetPaths(*it);
+      children.push_back(*it);
+    } else {
+      deleteSubtree(*it);
+    }
+  }
+  n->children.swap(children);
+}
+
+void CallPrefixTree::flushAll() {
+  writeSubtree(&root);
+  // Whatever states remain only adjust the counts from now on.
+  flushing = false;
+}
+
+void CallPrefixTree::writeSubtree(Node *n) {
+  if (n->flushed)
+    return;
+  if (n->pathId)
+    flush(*n);
+  for (std::vector<Node *>::iterator it = n->children.begin(),
+         ie = n->children.end(); it != ie; ++it)
+    writeSubtree(*it);
+  n->flushed = true;
+}
@@ -16,9 +16,16 @@ Statistic stats::coveredInstructions("CoveredInstructions", "Icov");
 Statistic stats::falseBranches("FalseBranches", "Bf");
 Statistic stats::forkTime("ForkTime", "Ftime");
 Statistic stats::forks("Forks", "Forks");
+Statistic stats::frameAllocations("FrameAllocations", "Falloc");
+Statistic stats::frameArenaBytes("FrameArenaBytes", "Fbytes");
+Statistic stats::frameArenaChunks("FrameArenaChunks", "Fchunks");
+Statistic stats::frameCopies("FrameCopies", "Fcopies");
 Statistic stats::instructionRealTime("InstructionRealTimes", "Ireal");
 Statistic stats::instructionTime("InstructionTimes", "Itime");
 Statistic stats::instructions("Instructions", "I");
+Statistic stats::loopEntrySnapshots("LoopEntrySnapshots", "LEsnap");
+Statistic stats::loopEntrySnapshotsDiscarded("LoopEntrySnapshotsDiscarded",
+                                             "LEdisc");
 Statistic stats::minDistToReturn("MinDistToReturn", "Rdist");
 Statistic stats::minDistToUncovered("MinDistToUncovered", "UCdist");
 Statistic stats::reachableUncovered("ReachableUncovered", "IuncovReach");
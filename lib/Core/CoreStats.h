@@ -30,6 +30,19 @@ namespace stats {
   /// The number of process forks.
   extern Statistic forks;
 
+  /// The number of loop-entry states stored for a possible
+  /// klee_induce_invariants, and how many of them were never used.
+  extern Statistic loopEntrySnapshots;
+  extern Statistic loopEntrySnapshotsDiscarded;
+
+  /// Register blocks allocated for stack frames, blocks copied because
+  /// a forked state wrote to a shared frame, and arena chunks (and their
+  /// bytes) allocated to hold them.
+  extern Statistic frameAllocations;
+  extern Statistic frameCopies;
+  extern Statistic frameArenaChunks;
+  extern Statistic frameArenaBytes;
+
   /// Number of states, this is a "fake" statistic used by istats, it
   /// isn't normally up-to-date.
   extern Statistic states;
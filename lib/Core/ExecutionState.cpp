@@ -19,6 +19,7 @@
 #include "klee/Internal/Module/InstructionInfoTable.h"
 #include "klee/Internal/Module/KInstruction.h"
 #include "klee/Internal/Module/KModule.h"
+#include "CoreStats.h"
 #include "TimingSolver.h"
 #include "klee/LoopAnalysis.h"
 
@@ -26,6 +27,7 @@
 
 #include "Memory.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
 #include "llvm/DebugInfo.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
@@ -50,27 +52,11 @@ namespace {
 
 /***/
 
-StackFrame::StackFrame(KInstIterator _caller, KFunction *_kf)
+StackFrame::StackFrame(KInstIterator _caller, KFunction *_kf,
+                       FrameArena &arena)
   : caller(_caller), kf(_kf), callPathNode(0),
-    minDistToUncoveredOnReturn(0), varargs(0) {
-  locals = new Cell[kf->numRegisters];
-}
-
-StackFrame::StackFrame(const StackFrame &s) 
-  : caller(s.caller),
-    kf(s.kf),
-    callPathNode(s.callPathNode),
-    allocas(s.allocas),
-    minDistToUncoveredOnReturn(s.minDistToUncoveredOnReturn),
-    varargs(s.varargs) {
-  locals = new Cell[s.kf->numRegisters];
-  for (unsigned i=0; i<s.kf->numRegisters; i++)
-    locals[i] = s.locals[i];
-}
-
-StackFrame::~StackFrame() { 
-  delete[] locals; 
-}
+    locals(arena.allocate(_kf->numRegisters)),
+    minDistToUncoveredOnReturn(0), varargs(0) {}
 
 /***/
 
@@ -127,7 +113,7 @@ ExecutionState::~ExecutionState() {
     if (mo->refCount == 0)
       delete mo;
   }
-  delete executionStateForLoopInProcess;
+  discardLoopEntrySnapshot();
 
   for (auto cur_mergehandler: openMergeStack){
     cur_mergehandler->removeOpenState(this);
@@ -139,8 +125,7 @@ ExecutionState::~ExecutionState() {
 
 ExecutionState::ExecutionState(const ExecutionState& state):
     fnAliases(state.fnAliases),
-    readsIntercepts(state.readsIntercepts),
-    writesIntercepts(state.writesIntercepts),
+    intercepts(state.intercepts),
     pc(state.pc),
     prevPC(state.prevPC),
     stack(state.stack),
@@ -174,6 +159,7 @@ ExecutionState::ExecutionState(const ExecutionState& state):
     openMergeStack(state.openMergeStack),
     steppedInstructions(state.steppedInstructions),
     callPath(state.callPath),
+    callPrefix(state.callPrefix),
     relevantSymbols(state.relevantSymbols),
     doTrace(state.doTrace),
     condoneUndeclaredHavocs(state.condoneUndeclaredHavocs)
@@ -224,7 +210,7 @@ ExecutionState *ExecutionState::branch() {
 }
 
 void ExecutionState::pushFrame(KInstIterator caller, KFunction *kf) {
-  stack.push_back(StackFrame(caller,kf));
+  stack.push_back(StackFrame(caller, kf, frameArena));
 }
 
 void ExecutionState::popFrame() {
@@ -241,18 +227,39 @@ void ExecutionState::addSymbolic(const MemoryObject *mo, const Array *array) {
 }
 ///
 
-std::string ExecutionState::getFnAlias(std::string fn) {
-  for (auto& candidate : fnAliases) {
-    if (candidate.isRegex) {
-      if (std::regex_match(fn, candidate.nameRegex)) {
-        return candidate.alias;
+llvm::GlobalValue *ExecutionState::getFnAlias(llvm::GlobalValue *gv) {
+  if (fnAliases.isNull())
+    return gv;
+
+  auto cached = fnAliases->resolved.find(gv);
+  if (cached != fnAliases->resolved.end())
+    return cached->second ? cached->second : gv;
+
+  llvm::GlobalValue *target = 0;
+  std::string fn = gv->getName().str();
+  for (auto& candidate : fnAliases->aliases) {
+    if (candidate.isRegex ? std::regex_match(fn, candidate.nameRegex)
+                          : fn == candidate.name) {
+      target = gv->getParent()->getNamedValue(candidate.alias);
+      if (!target) {
+        klee_error("Function %s(), alias for %s not found!\n",
+                   candidate.alias.c_str(), fn.c_str());
       }
-    } else if (fn == candidate.name) {
-      return candidate.alias;
+      break;
     }
   }
 
-  return "";
+  fnAliases->resolved[gv] = target;
+  return target ? target : gv;
+}
+
+FunctionAliasTable &ExecutionState::getWriteableFnAliases() {
+  if (fnAliases.isNull())
+    fnAliases = new FunctionAliasTable();
+  else if (fnAliases->refCount > 1)
+    fnAliases = new FunctionAliasTable(*fnAliases);
+  fnAliases->resolved.clear();
+  return *fnAliases;
 }
 
 void ExecutionState::addFnAlias(std::string old_fn, std::string new_fn) {
@@ -264,7 +271,7 @@ void ExecutionState::addFnAlias(std::string old_fn, std::string new_fn) {
     .name = old_fn,
     .alias = new_fn
   };
-  fnAliases.push_back(alias);
+  getWriteableFnAliases().aliases.push_back(alias);
 }
 
 void ExecutionState::addFnRegexAlias(std::string fn_regex, std::string new_fn) {
@@ -276,41 +283,58 @@ void ExecutionState::addFnRegexAlias(std::string fn_regex, std::string new_fn) {
     .name = fn_regex,
     .alias = new_fn
   };
-  fnAliases.push_back(alias);
+  getWriteableFnAliases().aliases.push_back(alias);
 }
 
 void ExecutionState::removeFnAlias(std::string fn) {
-  fnAliases.erase(std::remove_if(fnAliases.begin(), fnAliases.end(),
-                                 [fn](FunctionAlias candidate) {
-                                   return candidate.name == fn;
-                                 }),
-                  fnAliases.end());
+  if (fnAliases.isNull())
+    return;
+  std::vector<FunctionAlias> &aliases = getWriteableFnAliases().aliases;
+  aliases.erase(std::remove_if(aliases.begin(), aliases.end(),
+                               [&fn](const FunctionAlias &candidate) {
+                                 return candidate.name == fn;
+                               }),
+                aliases.end());
 }
 
-std::string ExecutionState::getInterceptReader(uint64_t addr) {
-  auto it = readsIntercepts.find(addr);
-  if (it == readsIntercepts.end()) {
-    return "";
+llvm::Function *ExecutionState::getInterceptReader(uint64_t addr) const {
+  if (intercepts.isNull())
+    return 0;
+
+  auto it = intercepts->readers.find(addr);
+  if (it == intercepts->readers.end()) {
+    return 0;
   }
 
   return it->second;
 }
 
-std::string ExecutionState::getInterceptWriter(uint64_t addr) {
-  auto it = writesIntercepts.find(addr);
-  if (it == writesIntercepts.end()) {
-    return "";
+llvm::Function *ExecutionState::getInterceptWriter(uint64_t addr) const {
+  if (intercepts.isNull())
+    return 0;
+
+  auto it = intercepts->writers.find(addr);
+  if (it == intercepts->writers.end()) {
+    return 0;
   }
 
   return it->second;
 }
 
-void ExecutionState::addReadsIntercept(uint64_t addr, std::string reader) {
-  readsIntercepts[addr] = reader;
+InterceptTable &ExecutionState::getWriteableIntercepts() {
+  if (intercepts.isNull())
+    intercepts = new InterceptTable();
+  else if (intercepts->refCount > 1)
+    intercepts = new InterceptTable(*intercepts);
+  return *intercepts;
+}
+
+void ExecutionState::addReadsIntercept(uint64_t addr, llvm::Function *reader) {
+  getWriteableIntercepts().readers[addr] = reader;
 }
 
-void ExecutionState::addWritesIntercept(uint64_t addr, std::string writer) {
-  writesIntercepts[addr] = writer;
+void ExecutionState::addWritesIntercept(uint64_t addr, llvm::Function *writer) {
+  getWriteableIntercepts().writers[addr] = writer;
 }
 
 /**/
@@ -458,13 +482,14 @@ bool ExecutionState::merge(const ExecutionState &b) {
     StackFrame &af = *itA;
     const StackFrame &bf = *itB;
     for (unsigned i=0; i<af.kf->numRegisters; i++) {
-      ref<Expr> &av = af.locals[i].value;
-      const ref<Expr> &bv = bf.locals[i].value;
+      const ref<Expr> &av = af.locals[i].getValue();
+      const ref<Expr> &bv = bf.locals[i].getValue();
       if (av.isNull() || bv.isNull()) {
         // if one is null then by implication (we are at same pc)
         // we cannot reuse this local, so just ignore
       } else {
-        av = SelectExpr::create(inA, av, bv);
+        af.locals.getWriteable(frameArena)[i].setValue(
+            SelectExpr::create(inA, av, bv));
       }
     }
   }
@@ -523,7 +548,7 @@ void ExecutionState::dumpStack(llvm::raw_ostream &out) const {
 
       out << ai->getName().str();
       // XXX should go through function
-      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].value;
+      ref<Expr> value = sf.locals[sf.kf->getArgRegister(index++)].getValue();
       if (value.get() && isa<ConstantExpr>(value))
         out << "=" << value;
     }
@@ -603,20 +628,21 @@ void ExecutionState::traceRet() {
       relevantSymbols.insert(symbols.begin(), symbols.end());
     }
     callPath.push_back(CallInfo());
-    callPath.back().callPlace = stack.back().caller->inst->getDebugLoc();
-    callPath.back().f = stack.back().kf->function;
-    callPath.back().returned = false;
+    CallInfo &call = callPath.getWriteableBack();
+    call.callPlace = stack.back().caller->inst->getDebugLoc();
+    call.f = stack.back().kf->function;
+    call.returned = false;
     std::vector<ref<Expr> > constrs =
       relevantConstraints(relevantSymbols);
-    callPath.back().callContext.insert(callPath.back().callContext.end(),
-                                       constrs.begin(), constrs.end());
+    call.callContext.insert(call.callContext.end(),
+                            constrs.begin(), constrs.end());
   }
 }
 
 void ExecutionState::traceRetPtr(Expr::Width width,
                                  bool tracePointee) {
   traceRet();
-  RetVal *ret = &callPath.back().ret;
+  RetVal *ret = &callPath.getWriteableBack().ret;
   ret->isPtr = true;
   ret->pointee.doTraceValueIn = tracePointee;
   ret->pointee.doTraceValueOut = tracePointee;
@@ -625,15 +651,16 @@ void ExecutionState::traceRetPtr(Expr::Width width,
 
 void ExecutionState::traceArgValue(ref<Expr> val, std::string name) {
   traceRet();
-  callPath.back().args.push_back(CallArg());
-  CallArg *argInfo = &callPath.back().args.back();
+  callPath.getWriteableBack().args.push_back(CallArg());
+  CallArg *argInfo = &callPath.getWriteableBack().args.back();
   argInfo->expr = val;
   argInfo->isPtr = false;
   argInfo->name = name;
   std::vector<ref<Expr> > constrs =
     relevantConstraints(GetExprSymbols::visit(val));
-  callPath.back().callContext.insert(callPath.back().callContext.end(),
-                                     constrs.begin(), constrs.end());
+  std::vector<ref<Expr> > &context =
+    callPath.getWriteableBack().callContext;
+  context.insert(context.end(), constrs.begin(), constrs.end());
 }
 
 void ExecutionState::traceArgPtr(ref<Expr> arg, Expr::Width width,
@@ -642,7 +669,7 @@ void ExecutionState::traceArgPtr(ref<Expr> arg, Expr::Width width,
                                  bool tracePointeeIn,
                                  bool tracePointeeOut) {
   traceArgValue(arg, name);
-  CallArg *argInfo = &callPath.back().args.back();
+  CallArg *argInfo = &callPath.getWriteableBack().args.back();
   argInfo->isPtr = true;
   argInfo->pointee.width = width;
   argInfo->pointee.type = type;
@@ -657,8 +684,9 @@ void ExecutionState::traceArgPtr(ref<Expr> arg, Expr::Width width,
     symbols.insert(indirectSymbols.begin(), indirectSymbols.end());
   }
   std::vector<ref<Expr> > constrs = relevantConstraints(symbols);
-  callPath.back().callContext.insert(callPath.back().callContext.end(),
-                                     constrs.begin(), constrs.end());
+  std::vector<ref<Expr> > &context =
+    callPath.getWriteableBack().callContext;
+  context.insert(context.end(), constrs.begin(), constrs.end());
 }
 
 void ExecutionState::traceArgArr(ref<Expr> arg, Expr::Width width, size_t count,
@@ -670,7 +698,7 @@ void ExecutionState::traceArgArr(ref<Expr> arg, Expr::Width width, size_t count,
     return traceArgPtr(arg, width, name, type, tracePointeeIn, tracePointeeOut);
   }
   traceArgValue(arg, name);
-  CallArg *argInfo = &callPath.back().args.back();
+  CallArg *argInfo = &callPath.getWriteableBack().args.back();
   argInfo->isPtr = true;
   argInfo->pointee.width = width*count;
   argInfo->pointee.type = type;
@@ -685,8 +713,9 @@ void ExecutionState::traceArgArr(ref<Expr> arg, Expr::Width width, size_t count,
     symbols.insert(indirectSymbols.begin(), indirectSymbols.end());
   }
   std::vector<ref<Expr> > constrs = relevantConstraints(symbols);
-  callPath.back().callContext.insert(callPath.back().callContext.end(),
-                                     constrs.begin(), constrs.end());
+  std::vector<ref<Expr> > &context =
+    callPath.getWriteableBack().callContext;
+  context.insert(context.end(), constrs.begin(), constrs.end());
   for (size_t i = 0; i < count; ++i) {
     //width is given in bits, we need bytes for the offset
     traceArgPtrField(arg, i*width/8, width, std::to_string(i), tracePointeeIn, tracePointeeOut);
@@ -696,7 +725,7 @@ void ExecutionState::traceArgArr(ref<Expr> arg, Expr::Width width, size_t count,
 void ExecutionState::traceArgFunPtr(ref<Expr> arg,
                                     std::string name) {
   traceArgValue(arg, name);
-  CallArg *argInfo = &callPath.back().args.back();
+  CallArg *argInfo = &callPath.getWriteableBack().args.back();
   argInfo->isPtr = true;
   ref<klee::ConstantExpr> address = cast<klee::ConstantExpr>(arg);
   argInfo->funPtr = (Function*)address->getZExtValue();
@@ -711,7 +740,7 @@ void ExecutionState::traceArgPtrField(ref<Expr> arg,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  CallArg *argInfo = callPath.back().getCallArgPtrp(arg);
+  CallArg *argInfo = callPath.getWriteableBack().getCallArgPtrp(arg);
   assert(argInfo != 0 &&
          "Must first trace the pointer arg to trace a particular field.");
   assert(argInfo->pointee.width > 0 && "Cannot fit a field into zero bytes.");
@@ -750,7 +779,7 @@ void ExecutionState::traceArgPtrFieldArr(ref<Expr> arg,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  CallArg *argInfo = callPath.back().getCallArgPtrp(arg);
+  CallArg *argInfo = callPath.getWriteableBack().getCallArgPtrp(arg);
   assert(argInfo != 0 &&
          "Must first trace the pointer arg to trace a particular field.");
   assert(argInfo->pointee.width > 0 && "Cannot fit a field into zero bytes.");
@@ -793,7 +822,7 @@ void ExecutionState::traceArgPtrNestedNestedField(ref<Expr> arg,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  CallArg *argInfo = callPath.back().getCallArgPtrp(arg);
+  CallArg *argInfo = callPath.getWriteableBack().getCallArgPtrp(arg);
   assert(argInfo != 0 &&
          "Must first trace the pointer arg to trace a particular field.");
   assert(argInfo->pointee.width > 0 && "Cannot fit a field into zero bytes.");
@@ -843,7 +872,7 @@ void ExecutionState::traceArgPtrNestedField(ref<Expr> arg,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  CallArg *argInfo = callPath.back().getCallArgPtrp(arg);
+  CallArg *argInfo = callPath.getWriteableBack().getCallArgPtrp(arg);
   assert(argInfo != 0 &&
          "Must first trace the pointer arg to trace a particular field.");
   assert(argInfo->pointee.width > 0 && "Cannot fit a field into zero bytes.");
@@ -887,7 +916,7 @@ void ExecutionState::traceArgPtrNestedFieldArr(ref<Expr> arg,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  CallArg *argInfo = callPath.back().getCallArgPtrp(arg);
+  CallArg *argInfo = callPath.getWriteableBack().getCallArgPtrp(arg);
   assert(argInfo != 0 &&
          "Must first trace the pointer arg to trace a particular field.");
   assert(argInfo->pointee.width > 0 && "Cannot fit a field into zero bytes.");
@@ -932,7 +961,7 @@ void ExecutionState::traceExtraPtrNestedField(size_t ptr,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  CallExtraPtr *extraPtr = &callPath.back().extraPtrs[ptr];
+  CallExtraPtr *extraPtr = &callPath.getWriteableBack().extraPtrs[ptr];
   assert(extraPtr != 0 &&
          "Must first trace the extra pointer to trace a particular field.");
   assert(extraPtr->pointee.width > (unsigned)offset + (unsigned)base_offset &&
@@ -969,7 +998,7 @@ void ExecutionState::traceExtraPtrNestedFieldArr(size_t ptr,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  CallExtraPtr *extraPtr = &callPath.back().extraPtrs[ptr];
+  CallExtraPtr *extraPtr = &callPath.getWriteableBack().extraPtrs[ptr];
   assert(extraPtr != 0 &&
          "Must first trace the extra pointer to trace a particular field.");
   assert(extraPtr->pointee.width > (unsigned)offset + (unsigned)base_offset &&
@@ -1009,7 +1038,7 @@ void ExecutionState::traceExtraPtrNestedNestedField(size_t ptr,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  CallExtraPtr *extraPtr = &callPath.back().extraPtrs[ptr];
+  CallExtraPtr *extraPtr = &callPath.getWriteableBack().extraPtrs[ptr];
   assert(extraPtr != 0 &&
          "Must first trace the extra pointer to trace a particular field.");
   assert(extraPtr->pointee.width >
@@ -1050,9 +1079,9 @@ void ExecutionState::traceExtraPtr(size_t ptr, Expr::Width width,
                                    std::string type,
                                    bool trace_in, bool trace_out) {
   traceRet();
-  callPath.back().extraPtrs.
+  callPath.getWriteableBack().extraPtrs.
     insert(std::pair<const size_t, CallExtraPtr>(ptr, CallExtraPtr()));
-  CallExtraPtr *extraPtr = &callPath.back().extraPtrs[ptr];
+  CallExtraPtr *extraPtr = &callPath.getWriteableBack().extraPtrs[ptr];
   extraPtr->ptr = ptr;
   extraPtr->name = name;
   extraPtr->pointee.width = width;
@@ -1071,8 +1100,9 @@ void ExecutionState::traceExtraPtr(size_t ptr, Expr::Width width,
     indirectSymbols = GetExprSymbols::visit(extraPtr->pointee.inVal);
   }
   std::vector<ref<Expr> > constrs = relevantConstraints(indirectSymbols);
-  callPath.back().callContext.insert(callPath.back().callContext.end(),
-                                     constrs.begin(), constrs.end());
+  std::vector<ref<Expr> > &context =
+    callPath.getWriteableBack().callContext;
+  context.insert(context.end(), constrs.begin(), constrs.end());
 }
 
 void ExecutionState::traceExtraPtrArr(size_t ptr, Expr::Width width, size_t count,
@@ -1083,9 +1113,9 @@ void ExecutionState::traceExtraPtrArr(size_t ptr, Expr::Width width, size_t coun
     return traceExtraPtr(ptr, width, name, type, trace_in, trace_out);
   }
   traceRet();
-  callPath.back().extraPtrs.
+  callPath.getWriteableBack().extraPtrs.
     insert(std::pair<const size_t, CallExtraPtr>(ptr, CallExtraPtr()));
-  CallExtraPtr *extraPtr = &callPath.back().extraPtrs[ptr];
+  CallExtraPtr *extraPtr = &callPath.getWriteableBack().extraPtrs[ptr];
   extraPtr->ptr = ptr;
   extraPtr->name = name;
   extraPtr->pointee.width = width*count;
@@ -1104,8 +1134,9 @@ void ExecutionState::traceExtraPtrArr(size_t ptr, Expr::Width width, size_t coun
     indirectSymbols = GetExprSymbols::visit(extraPtr->pointee.inVal);
   }
   std::vector<ref<Expr> > constrs = relevantConstraints(indirectSymbols);
-  callPath.back().callContext.insert(callPath.back().callContext.end(),
-                                     constrs.begin(), constrs.end());
+  std::vector<ref<Expr> > &context =
+    callPath.getWriteableBack().callContext;
+  context.insert(context.end(), constrs.begin(), constrs.end());
   for (size_t i = 0; i < count; ++i) {
     //width is given in bits, we need bytes for the offset
     traceExtraPtrField(ptr, i*width/8, width, std::to_string(i), trace_in, trace_out);
@@ -1120,7 +1151,7 @@ void ExecutionState::traceExtraPtrField(size_t ptr,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  CallExtraPtr *extraPtr = &callPath.back().extraPtrs[ptr];
+  CallExtraPtr *extraPtr = &callPath.getWriteableBack().extraPtrs[ptr];
   assert(extraPtr->pointee.width > 0 && "Cannot fit a field into zero bytes.");
   assert(extraPtr->pointee.fields.count(offset) == 0 && "Conflicting field.");
   FieldDescr descr;
@@ -1150,7 +1181,7 @@ void ExecutionState::traceExtraPtrFieldArray(size_t ptr,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  CallExtraPtr *extraPtr = &callPath.back().extraPtrs[ptr];
+  CallExtraPtr *extraPtr = &callPath.getWriteableBack().extraPtrs[ptr];
   assert(extraPtr->pointee.width > 0 && "Cannot fit a field into zero bytes.");
   assert(extraPtr->pointee.fields.count(offset) == 0 && "Conflicting field.");
   FieldDescr descr;
@@ -1182,7 +1213,7 @@ void ExecutionState::traceRetPtrField(int offset,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  RetVal *ret = &callPath.back().ret;
+  RetVal *ret = &callPath.getWriteableBack().ret;
   assert(ret->isPtr && "Only a pointer can have fields traced.");
   assert(ret->pointee.width > 0 && "Cannot fit a field in zero sized mem chunk.");
   assert(ret->pointee.doTraceValueIn && "Must trace the whole pointee to trace"
@@ -1204,7 +1235,7 @@ void ExecutionState::traceRetPtrNestedField(int base_offset,
   assert(!callPath.empty() &&
          callPath.back().f == stack.back().kf->function &&
          "Must trace the function first to trace a particular field.");
-  RetVal *ret = &callPath.back().ret;
+  RetVal *ret = &callPath.getWriteableBack().ret;
   assert(ret->isPtr && "Only a pointer can have fields traced.");
   assert(ret->pointee.width > 0 && "Cannot fit a field in zero sized mem chunk.");
   assert(ret->pointee.doTraceValueIn && "Must trace the whole pointee to trace"
@@ -1292,12 +1323,27 @@ void ExecutionState::loopEnter(const llvm::Loop *dstLoop) {
   LOG_LA("Remove the loop from the analyzed set - prepare"
          " to repeat the analysis.");
   analysedLoops = analysedLoops.remove(dstLoop);
+  discardLoopEntrySnapshot();
+  if (!stack.back().kf->inductionLoops.count(dstLoop)) {
+    LOG_LA("No klee_induce_invariants in the loop header,"
+           " no need to store the entering state.");
+    return;
+  }
   /// Remember the initial state for this loop header in
   /// case ther is an klee_induce_invariants call following.
   LOG_LA("store the loop-head entering state,"
          " just in case.");
   executionStateForLoopInProcess = branch();
   executionStateForLoopInProcess->loopInProcess = 0;
+  ++stats::loopEntrySnapshots;
+}
+
+void ExecutionState::discardLoopEntrySnapshot() {
+  if (executionStateForLoopInProcess) {
+    delete executionStateForLoopInProcess;
+    executionStateForLoopInProcess = 0;
+    ++stats::loopEntrySnapshotsDiscarded;
+  }
 }
 
 void ExecutionState::loopExit(const llvm::Loop *srcLoop,
@@ -1418,8 +1464,8 @@ void ExecutionState::induceInvariantsForThisLoop(KInstruction *target) {
   startInvariantSearch();
 
   //The return value of the intrinsic function call.
-  stack.back().locals[target->dest].value =
-    ConstantExpr::create(0xffffffff, Expr::Int32);
+  stack.back().locals.getWriteable(frameArena)[target->dest]
+    .setConstant(0xffffffff, Expr::Int32);
 }
 
 bool FieldDescr::eq(const FieldDescr& other) const {
@@ -1462,6 +1508,7 @@ bool FieldDescr::sameInvocationValue(const FieldDescr& other) const {
       (!other.inVal.isNull()) && 0 == inVal->compare(*other.inVal)));
   if (!self_same) return false;
   if (!doTraceValueIn) return true;
+  if (fields.size() != other.fields.size()) return false;
   std::map<int, FieldDescr>::const_iterator i = fields.begin(),
     e = fields.end();
   for (; i != e; ++i) {
@@ -1564,7 +1611,7 @@ bool equalContexts(const std::vector<ref<Expr> >& a,
   for (unsigned i = 0; i < b.size(); ++i) {
     bool notFound = true;
     for (unsigned j = 0; j < a.size(); ++j) {
-      if ((*a[i]).compare(*b[j]) == 0) {
+      if ((*b[i]).compare(*a[j]) == 0) {
         notFound = false;
         break;
       }
@@ -1615,6 +1662,62 @@ bool CallInfo::sameInvocation(const CallInfo* other) const {
   return equalContexts(callContext, other->callContext);
 }
 
+static void writeExprKey(const ref<Expr> &e, llvm::raw_ostream &key) {
+  if (e.isNull())
+    key << "()";
+  else
+    key << *e;
+}
+
+static void writeInvocationKey(const FieldDescr &descr,
+                               llvm::raw_ostream &key) {
+  key << "(" << descr.width << " " << descr.name << " " << descr.type << " "
+      << descr.doTraceValueIn;
+  if (descr.doTraceValueIn) {
+    key << " ";
+    writeExprKey(descr.inVal, key);
+    std::map<int, FieldDescr>::const_iterator i = descr.fields.begin(),
+      e = descr.fields.end();
+    for (; i != e; ++i) {
+      key << " " << i->first << ":";
+      writeInvocationKey(i->second, key);
+    }
+  }
+  key << ")";
+}
+
+// Must compare exactly what sameInvocation() compares; CallInfoTest checks
+// that the two agree.
+std::string CallInfo::getInvocationKey() const {
+  std::string str;
+  llvm::raw_string_ostream key(str);
+  if (f)
+    key << f->getName();
+  key << "\n";
+  for (std::vector<CallArg>::const_iterator i = args.begin(),
+         e = args.end(); i != e; ++i) {
+    writeExprKey(i->expr, key);
+    key << " " << i->isPtr;
+    if (i->isPtr)
+      writeInvocationKey(i->pointee, key);
+    key << "\n";
+  }
+  // equalContexts() compares the contexts as sets of the same size.
+  std::set<std::string> context;
+  for (std::vector<ref<Expr> >::const_iterator i = callContext.begin(),
+         e = callContext.end(); i != e; ++i) {
+    std::string expr;
+    llvm::raw_string_ostream os(expr);
+    os << **i;
+    context.insert(os.str());
+  }
+  key << callContext.size() << "\n";
+  for (std::set<std::string>::iterator i = context.begin(), e = context.end();
+       i != e; ++i)
+    key << *i << "\n";
+  return key.str();
+}
+
 SymbolSet CallInfo::computeRetSymbolSet() const {
   assert(returned && "incomplete");
   SymbolSet symbols;
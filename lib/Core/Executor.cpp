@@ -15,9 +15,11 @@
 #include "Memory.h"
 #include "MemoryManager.h"
 #include "PTree.h"
+#include "Profiler.h"
 #include "Searcher.h"
 #include "SeedInfo.h"
 #include "SpecialFunctionHandler.h"
+#include "StateSpiller.h"
 #include "StatsTracker.h"
 #include "TimingSolver.h"
 #include "UserSearcher.h"
@@ -85,16 +87,21 @@
 
 #include <cassert>
 #include <algorithm>
+#include <atomic>
 #include <iomanip>
 #include <iosfwd>
 #include <fstream>
+#include <new>
 #include <sstream>
 #include <vector>
 #include <string>
 
 #include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <errno.h>
+#include <string.h>
 #include <cxxabi.h>
 
 using namespace llvm;
@@ -312,8 +319,43 @@ namespace {
   MaxMemoryInhibit("max-memory-inhibit",
             cl::desc("Inhibit forking at memory cap (vs. random terminate) (default=on)"),
             cl::init(true));
+
+  cl::opt<bool>
+  SpillStates("spill-states",
+              cl::desc("At memory cap, move the least recently run states to "
+                       "disk instead of terminating them, and reload them "
+                       "when they are scheduled again (default=off)"),
+              cl::init(false));
+
+  cl::opt<unsigned>
+  ParallelChunks("parallel-chunks",
+                 cl::desc("Number of chunks the frontier is split into for "
+                          "--parallel-workers. A chunk is explored by a "
+                          "single worker, so more chunks balance uneven "
+                          "subtrees better (default=0 (4 per worker))"),
+                 cl::init(0));
+
+  cl::opt<bool>
+  Profile("profile",
+          cl::desc("Sample where wall time goes (interpretation, solver, "
+                   "address resolution, forking, special functions, ...) and "
+                   "write the samples to run.folded, in the folded stack "
+                   "format of flamegraph.pl (default=off)"),
+          cl::init(false));
+
+  cl::opt<unsigned>
+  ProfileInterval("profile-interval",
+                  cl::desc("Sampling interval of --profile, in microseconds "
+                           "(default=1000)"),
+                  cl::init(1000));
 }
 
+cl::opt<unsigned>
+ParallelWorkers("parallel-workers",
+                cl::desc("Explore disjoint subtrees of the execution tree in "
+                         "this many worker processes (default=0 (off))"),
+                cl::init(0));
+
 
 namespace klee {
   RNG theRNG;
@@ -341,9 +383,9 @@ Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
     : Interpreter(opts), kmodule(0), interpreterHandler(ih), searcher(0),
       externalDispatcher(new ExternalDispatcher(ctx)), statsTracker(0),
       pathWriter(0), symPathWriter(0), specialFunctionHandler(0),
-      processTree(0), replayKTest(0), replayPath(0), usingSeeds(0),
+      processTree(0), spiller(0), replayKTest(0), replayPath(0), usingSeeds(0),
       atMemoryLimit(false), inhibitForking(false), haltExecution(false),
-      ivcEnabled(false),
+      parallelSplitDone(false), partitionSelected(false), ivcEnabled(false),
       coreSolverTimeout(MaxCoreSolverTime != 0 && MaxInstructionTime != 0
                             ? std::min(MaxCoreSolverTime, MaxInstructionTime)
                             : std::max(MaxCoreSolverTime, MaxInstructionTime)),
@@ -367,6 +409,18 @@ Executor::Executor(LLVMContext &ctx, const InterpreterOptions &opts,
 
   initializeSearchOptions();
 
+  // Every partition explores the tree again up to the split, and has to
+  // reach the same frontier as the others there.
+  if (opts.NumPartitions) {
+    if (coreSolverTimeout)
+      klee_error("--partition cannot be used with --max-solver-time or "
+                 "--max-instruction-time, which depend on timing");
+    if (userSearcherDependsOnTime())
+      klee_error("--partition cannot be used with --use-batching-search, "
+                 "--use-iterative-deepening-time-search or --search=nurs:qc, "
+                 "which depend on timing");
+  }
+
   if (OnlyOutputStatesCoveringNew && !StatsTracker::useIStats())
     klee_error("To use --only-output-states-covering-new, you need to enable --output-istats.");
 
@@ -717,26 +771,19 @@ void Executor::branch(ExecutionState &state,
   // states if necessary due to OnlyReplaySeeds (inefficient but
   // simple).
   
-  std::map< ExecutionState*, std::vector<SeedInfo> >::iterator it = 
-    seedMap.find(&state);
-  if (it != seedMap.end()) {
-    std::vector<SeedInfo> seeds = it->second;
-    seedMap.erase(it);
+  if (seedMap.count(&state)) {
+    std::vector<SeedInfo> seeds;
+    seedMap.take(&state, seeds);
 
     // Assume each seed only satisfies one condition (necessarily true
     // when conditions are mutually exclusive and their conjunction is
     // a tautology).
+    std::vector<std::map<ref<Expr>, ref<ConstantExpr> > > caches(N);
     for (std::vector<SeedInfo>::iterator siit = seeds.begin(), 
            siie = seeds.end(); siit != siie; ++siit) {
       unsigned i;
       for (i=0; i<N; ++i) {
-        ref<ConstantExpr> res;
-        bool success = 
-          solver->getValue(state, siit->assignment.evaluate(conditions[i]), 
-                           res);
-        assert(success && "FIXME: Unhandled solver failure");
-        (void) success;
-        if (res->isTrue())
+        if (getSeedValue(state, *siit, conditions[i], caches[i])->isTrue())
           break;
       }
       
@@ -747,7 +794,7 @@ void Executor::branch(ExecutionState &state,
 
       // Extra check in case we're replaying seeds with a max-fork
       if (result[i])
-        seedMap[result[i]].push_back(*siit);
+        seedMap.addSeed(result[i], *siit);
     }
 
     if (OnlyReplaySeeds) {
@@ -767,10 +814,10 @@ void Executor::branch(ExecutionState &state,
 
 Executor::StatePair 
 Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
+  ProfileScope scope(Profiler::Fork);
   Solver::Validity res;
-  std::map< ExecutionState*, std::vector<SeedInfo> >::iterator it = 
-    seedMap.find(&current);
-  bool isSeeding = it != seedMap.end();
+  std::vector<SeedInfo> *seeds = seedMap.find(&current);
+  bool isSeeding = seeds != 0;
 
   if (!isSeeding && !isa<ConstantExpr>(condition) && 
       (MaxStaticForkPct!=1. || MaxStaticSolvePct != 1. ||
@@ -801,7 +848,7 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
 
   double timeout = coreSolverTimeout;
   if (isSeeding)
-    timeout *= it->second.size();
+    timeout *= seeds->size();
   solver->setTimeout(timeout);
   bool success = solver->evaluate(current, condition, res);
   solver->setTimeout(0);
@@ -867,14 +914,10 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
       res == Solver::Unknown) {
     bool trueSeed=false, falseSeed=false;
     // Is seed extension still ok here?
-    for (std::vector<SeedInfo>::iterator siit = it->second.begin(), 
-           siie = it->second.end(); siit != siie; ++siit) {
-      ref<ConstantExpr> res;
-      bool success = 
-        solver->getValue(current, siit->assignment.evaluate(condition), res);
-      assert(success && "FIXME: Unhandled solver failure");
-      (void) success;
-      if (res->isTrue()) {
+    std::map<ref<Expr>, ref<ConstantExpr> > cache;
+    for (std::vector<SeedInfo>::iterator siit = seeds->begin(), 
+           siie = seeds->end(); siit != siie; ++siit) {
+      if (getSeedValue(current, *siit, condition, cache)->isTrue()) {
         trueSeed = true;
       } else {
         falseSeed = true;
@@ -923,34 +966,21 @@ Executor::fork(ExecutionState &current, ref<Expr> condition, bool isInternal) {
     falseState = trueState->branch();
     addedStates.push_back(falseState);
 
-    if (it != seedMap.end()) {
-      std::vector<SeedInfo> seeds = it->second;
-      it->second.clear();
-      std::vector<SeedInfo> &trueSeeds = seedMap[trueState];
-      std::vector<SeedInfo> &falseSeeds = seedMap[falseState];
-      for (std::vector<SeedInfo>::iterator siit = seeds.begin(), 
-             siie = seeds.end(); siit != siie; ++siit) {
-        ref<ConstantExpr> res;
-        bool success = 
-          solver->getValue(current, siit->assignment.evaluate(condition), res);
-        assert(success && "FIXME: Unhandled solver failure");
-        (void) success;
-        if (res->isTrue()) {
-          trueSeeds.push_back(*siit);
-        } else {
-          falseSeeds.push_back(*siit);
-        }
+    if (isSeeding) {
+      std::vector<SeedInfo> currentSeeds;
+      seedMap.take(&current, currentSeeds);
+      std::map<ref<Expr>, ref<ConstantExpr> > cache;
+      for (std::vector<SeedInfo>::iterator siit = currentSeeds.begin(), 
+             siie = currentSeeds.end(); siit != siie; ++siit) {
+        bool isTrue = getSeedValue(current, *siit, condition, cache)->isTrue();
+        seedMap.addSeed(isTrue ? trueState : falseState, *siit);
       }
-      
+
       bool swapInfo = false;
-      if (trueSeeds.empty()) {
-        if (&current == trueState) swapInfo = true;
-        seedMap.erase(trueState);
-      }
-      if (falseSeeds.empty()) {
-        if (&current == falseState) swapInfo = true;
-        seedMap.erase(falseState);
-      }
+      if (!seedMap.count(trueState) && &current == trueState)
+        swapInfo = true;
+      if (!seedMap.count(falseState) && &current == falseState)
+        swapInfo = true;
       if (swapInfo) {
         std::swap(trueState->coveredNew, falseState->coveredNew);
         std::swap(trueState->coveredLines, falseState->coveredLines);
@@ -1001,19 +1031,23 @@ void Executor::addConstraint(ExecutionState &state, ref<Expr> condition) {
     return;
   }
 
-  // Check to see if this constraint violates seeds.
-  std::map< ExecutionState*, std::vector<SeedInfo> >::iterator it = 
-    seedMap.find(&state);
-  if (it != seedMap.end()) {
+  // Check to see if this constraint violates seeds. Seeds that reduce it
+  // to the same expression share one query.
+  if (std::vector<SeedInfo> *seeds = seedMap.find(&state)) {
     bool warn = false;
-    for (std::vector<SeedInfo>::iterator siit = it->second.begin(), 
-           siie = it->second.end(); siit != siie; ++siit) {
-      bool res;
-      bool success = 
-        solver->mustBeFalse(state, siit->assignment.evaluate(condition), res);
-      assert(success && "FIXME: Unhandled solver failure");
-      (void) success;
-      if (res) {
+    std::map<ref<Expr>, bool> violated;
+    for (std::vector<SeedInfo>::iterator siit = seeds->begin(), 
+           siie = seeds->end(); siit != siie; ++siit) {
+      ref<Expr> residual = siit->assignment.evaluate(condition);
+      std::map<ref<Expr>, bool>::iterator vit = violated.find(residual);
+      if (vit == violated.end()) {
+        bool res;
+        bool success = solver->mustBeFalse(state, residual, res);
+        assert(success && "FIXME: Unhandled solver failure");
+        (void) success;
+        vit = violated.insert(std::make_pair(residual, res)).first;
+      }
+      if (vit->second) {
         siit->patchSeed(state, condition, solver);
         warn = true;
       }
@@ -1028,6 +1062,22 @@ void Executor::addConstraint(ExecutionState &state, ref<Expr> condition) {
                                  ConstantExpr::alloc(1, Expr::Bool));
 }
 
+ref<klee::ConstantExpr>
+Executor::getSeedValue(ExecutionState &state, SeedInfo &seed, ref<Expr> e,
+                       std::map<ref<Expr>, ref<ConstantExpr> > &cache) {
+  ref<Expr> residual = seed.assignment.evaluate(e);
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(residual))
+    return CE;
+
+  ref<ConstantExpr> &value = cache[residual];
+  if (value.isNull()) {
+    bool success = solver->getValue(state, residual, value);
+    assert(success && "FIXME: Unhandled solver failure");
+    (void) success;
+  }
+  return value;
+}
+
 const Cell& Executor::eval(KInstruction *ki, unsigned index, 
                            ExecutionState &state) const {
   assert(index < ki->inst->getNumOperands());
@@ -1049,12 +1099,12 @@ const Cell& Executor::eval(KInstruction *ki, unsigned index,
 
 void Executor::bindLocal(KInstruction *target, ExecutionState &state, 
                          ref<Expr> value) {
-  getDestCell(state, target).value = value;
+  getDestCell(state, target).setValue(value);
 }
 
 void Executor::bindArgument(KFunction *kf, unsigned index, 
                             ExecutionState &state, ref<Expr> value) {
-  getArgumentCell(state, kf, index).value = value;
+  getArgumentCell(state, kf, index).setValue(value);
 }
 
 ref<Expr> Executor::toUnique(const ExecutionState &state, 
@@ -1112,9 +1162,8 @@ void Executor::executeGetValue(ExecutionState &state,
                                ref<Expr> e,
                                KInstruction *target) {
   e = state.constraints.simplifyExpr(e);
-  std::map< ExecutionState*, std::vector<SeedInfo> >::iterator it = 
-    seedMap.find(&state);
-  if (it==seedMap.end() || isa<ConstantExpr>(e)) {
+  std::vector<SeedInfo> *seeds = seedMap.find(&state);
+  if (!seeds || isa<ConstantExpr>(e)) {
     ref<ConstantExpr> value;
     bool success = solver->getValue(state, e, value);
     assert(success && "FIXME: Unhandled solver failure");
@@ -1122,15 +1171,10 @@ void Executor::executeGetValue(ExecutionState &state,
     bindLocal(target, state, value);
   } else {
     std::set< ref<Expr> > values;
-    for (std::vector<SeedInfo>::iterator siit = it->second.begin(), 
-           siie = it->second.end(); siit != siie; ++siit) {
-      ref<ConstantExpr> value;
-      bool success = 
-        solver->getValue(state, siit->assignment.evaluate(e), value);
-      assert(success && "FIXME: Unhandled solver failure");
-      (void) success;
-      values.insert(value);
-    }
+    std::map<ref<Expr>, ref<ConstantExpr> > cache;
+    for (std::vector<SeedInfo>::iterator siit = seeds->begin(), 
+           siie = seeds->end(); siit != siie; ++siit)
+      values.insert(getSeedValue(state, *siit, e, cache));
     
     std::vector< ref<Expr> > conditions;
     for (std::set< ref<Expr> >::iterator vit = values.begin(), 
@@ -1429,7 +1473,7 @@ void Executor::transferToBasicBlock(BasicBlock *dst, BasicBlock *src,
   KFunction *kf = state.stack.back().kf;
   unsigned entry = kf->basicBlockEntry[dst];
   state.pc = &kf->instructions[entry];
-  if (state.pc->inst->getOpcode() == Instruction::PHI) {
+  if (state.pc->opcode == Instruction::PHI) {
     PHINode *first = static_cast<PHINode*>(state.pc->inst);
     state.incomingBBIndex = first->getBasicBlockIndex(src);
   }
@@ -1455,17 +1499,8 @@ Function* Executor::getTargetFunction(Value *calledVal, ExecutionState &state) {
       if (!Visited.insert(gv))
         return 0;
 #endif
-      std::string alias = state.getFnAlias(gv->getName());
-      if (alias != "") {
-        llvm::Module* currModule = kmodule->module;
-        GlobalValue *old_gv = gv;
-        gv = currModule->getNamedValue(alias);
-        if (!gv) {
-          klee_error("Function %s(), alias for %s not found!\n", alias.c_str(),
-                     old_gv->getName().str().c_str());
-        }
-      }
-     
+      gv = state.getFnAlias(gv);
+
       if (Function *f = dyn_cast<Function>(gv))
         return f;
       else if (GlobalAlias *ga = dyn_cast<GlobalAlias>(gv))
@@ -1615,9 +1650,91 @@ void klee::FillCallInfoOutput(Function* f,
   state.recordRetConstraints(info);
 }
 
+/// Fast path for arithmetic, bitwise and compare instructions whose
+/// operands are both inline constants (see Cell). Returns false if the
+/// instruction must go through the general Expr path.
+bool Executor::executeInlineConstantOp(ExecutionState &state,
+                                       KInstruction *ki) {
+  switch (ki->opcode) {
+  case Instruction::Add:
+  case Instruction::Sub:
+  case Instruction::Mul:
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr:
+  case Instruction::ICmp:
+    break;
+  default:
+    return false;
+  }
+
+  const Cell &leftCell = eval(ki, 0, state);
+  const Cell &rightCell = eval(ki, 1, state);
+  if (!leftCell.isInlineConstant() || !rightCell.isInlineConstant())
+    return false;
+
+  Expr::Width width = leftCell.getConstantWidth();
+  uint64_t left = leftCell.getConstantBits();
+  uint64_t right = rightCell.getConstantBits();
+  // Sign extended views, for AShr and the signed predicates.
+  unsigned unused = 64 - width;
+  int64_t sleft = (int64_t) (left << unused) >> unused;
+  int64_t sright = (int64_t) (right << unused) >> unused;
+  uint64_t result;
+
+  switch (ki->opcode) {
+  case Instruction::Add: result = left + right; break;
+  case Instruction::Sub: result = left - right; break;
+  case Instruction::Mul: result = left * right; break;
+  case Instruction::And: result = left & right; break;
+  case Instruction::Or: result = left | right; break;
+  case Instruction::Xor: result = left ^ right; break;
+  case Instruction::Shl:
+  case Instruction::LShr:
+  case Instruction::AShr:
+    // Leave oversized shifts to the Expr library.
+    if (right >= width)
+      return false;
+    if (ki->opcode == Instruction::Shl)
+      result = left << right;
+    else if (ki->opcode == Instruction::LShr)
+      result = left >> right;
+    else
+      result = (uint64_t) (sleft >> right);
+    break;
+  default: {
+    switch (cast<ICmpInst>(ki->inst)->getPredicate()) {
+    case ICmpInst::ICMP_EQ: result = left == right; break;
+    case ICmpInst::ICMP_NE: result = left != right; break;
+    case ICmpInst::ICMP_UGT: result = left > right; break;
+    case ICmpInst::ICMP_UGE: result = left >= right; break;
+    case ICmpInst::ICMP_ULT: result = left < right; break;
+    case ICmpInst::ICMP_ULE: result = left <= right; break;
+    case ICmpInst::ICMP_SGT: result = sleft > sright; break;
+    case ICmpInst::ICMP_SGE: result = sleft >= sright; break;
+    case ICmpInst::ICMP_SLT: result = sleft < sright; break;
+    case ICmpInst::ICMP_SLE: result = sleft <= sright; break;
+    default:
+      return false;
+    }
+    width = Expr::Bool;
+    break;
+  }
+  }
+
+  getDestCell(state, ki).setConstant(result, width);
+  return true;
+}
+
 void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
+  if (executeInlineConstantOp(state, ki))
+    return;
+
   Instruction *i = ki->inst;
-  switch (i->getOpcode()) {
+  switch (ki->opcode) {
     // Control flow
   case Instruction::Ret: {
     ReturnInst *ri = cast<ReturnInst>(i);
@@ -1627,13 +1744,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     ref<Expr> result = ConstantExpr::alloc(0, Expr::Bool);
 
     if (!isVoidReturn) {
-      result = eval(ki, 0, state).value;
+      result = eval(ki, 0, state).getValue();
     }
 
     Function* f = ri->getParent()->getParent();
     if (!state.callPath.empty() && f == state.callPath.back().f) {
-      CallInfo *info = &state.callPath.back();
+      CallInfo *info = &state.callPath.getWriteableBack();
       FillCallInfoOutput(f, isVoidReturn, result, state, *this, info);
+      state.callPrefix.append(*info);
     }
     if (state.stack.size() <= 1) {
       assert(!caller && "caller set on initial stack frame");
@@ -1696,7 +1814,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       // FIXME: Find a way that we don't have this hidden dependency.
       assert(bi->getCondition() == bi->getOperand(0) &&
              "Wrong operand index!");
-      ref<Expr> cond = eval(ki, 0, state).value;
+      ref<Expr> cond = eval(ki, 0, state).getValue();
       Executor::StatePair branches = fork(state, cond, false);
 
       // NOTE: There is a hidden dependency here, markBranchVisited
@@ -1718,7 +1836,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::IndirectBr: {
     // implements indirect branch to a label within the current function
     const auto bi = cast<IndirectBrInst>(i);
-    auto address = eval(ki, 0, state).value;
+    auto address = eval(ki, 0, state).getValue();
     address = toUnique(state, address);
 
     // concrete address
@@ -1790,7 +1908,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
   case Instruction::Switch: {
     SwitchInst *si = cast<SwitchInst>(i);
-    ref<Expr> cond = eval(ki, 0, state).value;
+    ref<Expr> cond = eval(ki, 0, state).getValue();
     BasicBlock *bb = si->getParent();
 
     cond = toUnique(state, cond);
@@ -1933,7 +2051,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     arguments.reserve(numArgs);
 
     for (unsigned j=0; j<numArgs; ++j)
-      arguments.push_back(eval(ki, j+1, state).value);
+      arguments.push_back(eval(ki, j+1, state).getValue());
 
     if (f) {
       const FunctionType *fType = 
@@ -1974,7 +2092,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
       executeCall(state, ki, f, arguments);
     } else {
-      ref<Expr> v = eval(ki, 0, state).value;
+      ref<Expr> v = eval(ki, 0, state).getValue();
 
       ExecutionState *free = &state;
       bool hasInvalid = false, first = true;
@@ -2036,9 +2154,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       bindLocal(ki, state, result);
     } else {
 #if LLVM_VERSION_CODE >= LLVM_VERSION(3, 0)
-      ref<Expr> result = eval(ki, state.incomingBBIndex, state).value;
+      ref<Expr> result = eval(ki, state.incomingBBIndex, state).getValue();
 #else
-      ref<Expr> result = eval(ki, state.incomingBBIndex * 2, state).value;
+      ref<Expr> result = eval(ki, state.incomingBBIndex * 2, state).getValue();
 #endif
       bindLocal(ki, state, result);
     }
@@ -2048,9 +2166,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // Special instructions
   case Instruction::Select: {
     // NOTE: It is not required that operands 1 and 2 be of scalar type.
-    ref<Expr> cond = eval(ki, 0, state).value;
-    ref<Expr> tExpr = eval(ki, 1, state).value;
-    ref<Expr> fExpr = eval(ki, 2, state).value;
+    ref<Expr> cond = eval(ki, 0, state).getValue();
+    ref<Expr> tExpr = eval(ki, 1, state).getValue();
+    ref<Expr> fExpr = eval(ki, 2, state).getValue();
     ref<Expr> result = SelectExpr::create(cond, tExpr, fExpr);
     bindLocal(ki, state, result);
     break;
@@ -2063,101 +2181,101 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // Arithmetic / logical
 
   case Instruction::Add: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     bindLocal(ki, state, AddExpr::create(left, right));
     break;
   }
 
   case Instruction::Sub: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     bindLocal(ki, state, SubExpr::create(left, right));
     break;
   }
  
   case Instruction::Mul: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     bindLocal(ki, state, MulExpr::create(left, right));
     break;
   }
 
   case Instruction::UDiv: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = UDivExpr::create(left, right);
     bindLocal(ki, state, result);
     break;
   }
 
   case Instruction::SDiv: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = SDivExpr::create(left, right);
     bindLocal(ki, state, result);
     break;
   }
 
   case Instruction::URem: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = URemExpr::create(left, right);
     bindLocal(ki, state, result);
     break;
   }
 
   case Instruction::SRem: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = SRemExpr::create(left, right);
     bindLocal(ki, state, result);
     break;
   }
 
   case Instruction::And: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = AndExpr::create(left, right);
     bindLocal(ki, state, result);
     break;
   }
 
   case Instruction::Or: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = OrExpr::create(left, right);
     bindLocal(ki, state, result);
     break;
   }
 
   case Instruction::Xor: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = XorExpr::create(left, right);
     bindLocal(ki, state, result);
     break;
   }
 
   case Instruction::Shl: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = ShlExpr::create(left, right);
     bindLocal(ki, state, result);
     break;
   }
 
   case Instruction::LShr: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = LShrExpr::create(left, right);
     bindLocal(ki, state, result);
     break;
   }
 
   case Instruction::AShr: {
-    ref<Expr> left = eval(ki, 0, state).value;
-    ref<Expr> right = eval(ki, 1, state).value;
+    ref<Expr> left = eval(ki, 0, state).getValue();
+    ref<Expr> right = eval(ki, 1, state).getValue();
     ref<Expr> result = AShrExpr::create(left, right);
     bindLocal(ki, state, result);
     break;
@@ -2171,80 +2289,80 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
     switch(ii->getPredicate()) {
     case ICmpInst::ICMP_EQ: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
+      ref<Expr> left = eval(ki, 0, state).getValue();
+      ref<Expr> right = eval(ki, 1, state).getValue();
       ref<Expr> result = EqExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_NE: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
+      ref<Expr> left = eval(ki, 0, state).getValue();
+      ref<Expr> right = eval(ki, 1, state).getValue();
       ref<Expr> result = NeExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_UGT: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
+      ref<Expr> left = eval(ki, 0, state).getValue();
+      ref<Expr> right = eval(ki, 1, state).getValue();
       ref<Expr> result = UgtExpr::create(left, right);
       bindLocal(ki, state,result);
       break;
     }
 
     case ICmpInst::ICMP_UGE: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
+      ref<Expr> left = eval(ki, 0, state).getValue();
+      ref<Expr> right = eval(ki, 1, state).getValue();
       ref<Expr> result = UgeExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_ULT: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
+      ref<Expr> left = eval(ki, 0, state).getValue();
+      ref<Expr> right = eval(ki, 1, state).getValue();
       ref<Expr> result = UltExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_ULE: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
+      ref<Expr> left = eval(ki, 0, state).getValue();
+      ref<Expr> right = eval(ki, 1, state).getValue();
       ref<Expr> result = UleExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_SGT: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
+      ref<Expr> left = eval(ki, 0, state).getValue();
+      ref<Expr> right = eval(ki, 1, state).getValue();
       ref<Expr> result = SgtExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_SGE: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
+      ref<Expr> left = eval(ki, 0, state).getValue();
+      ref<Expr> right = eval(ki, 1, state).getValue();
       ref<Expr> result = SgeExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_SLT: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
+      ref<Expr> left = eval(ki, 0, state).getValue();
+      ref<Expr> right = eval(ki, 1, state).getValue();
       ref<Expr> result = SltExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
     }
 
     case ICmpInst::ICMP_SLE: {
-      ref<Expr> left = eval(ki, 0, state).value;
-      ref<Expr> right = eval(ki, 1, state).value;
+      ref<Expr> left = eval(ki, 0, state).getValue();
+      ref<Expr> right = eval(ki, 1, state).getValue();
       ref<Expr> result = SleExpr::create(left, right);
       bindLocal(ki, state, result);
       break;
@@ -2263,7 +2381,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
       kmodule->targetData->getTypeStoreSize(ai->getAllocatedType());
     ref<Expr> size = Expr::createPointer(elementSize);
     if (ai->isArrayAllocation()) {
-      ref<Expr> count = eval(ki, 0, state).value;
+      ref<Expr> count = eval(ki, 0, state).getValue();
       count = Expr::createZExtToPointerWidth(count);
       size = MulExpr::create(size, count);
     }
@@ -2272,26 +2390,26 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::Load: {
-    ref<Expr> base = eval(ki, 0, state).value;
+    ref<Expr> base = eval(ki, 0, state).getValue();
     executeMemoryOperation(state, false, base, 0, ki);
     break;
   }
   case Instruction::Store: {
-    ref<Expr> base = eval(ki, 1, state).value;
-    ref<Expr> value = eval(ki, 0, state).value;
+    ref<Expr> base = eval(ki, 1, state).getValue();
+    ref<Expr> value = eval(ki, 0, state).getValue();
     executeMemoryOperation(state, true, base, value, ki);
     break;
   }
 
   case Instruction::GetElementPtr: {
     KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(ki);
-    ref<Expr> base = eval(ki, 0, state).value;
+    ref<Expr> base = eval(ki, 0, state).getValue();
 
     for (std::vector< std::pair<unsigned, uint64_t> >::iterator 
            it = kgepi->indices.begin(), ie = kgepi->indices.end(); 
          it != ie; ++it) {
       uint64_t elementSize = it->second;
-      ref<Expr> index = eval(ki, it->first, state).value;
+      ref<Expr> index = eval(ki, it->first, state).getValue();
       base = AddExpr::create(base,
                              MulExpr::create(Expr::createSExtToPointerWidth(index),
                                              Expr::createPointer(elementSize)));
@@ -2306,7 +2424,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // Conversion
   case Instruction::Trunc: {
     CastInst *ci = cast<CastInst>(i);
-    ref<Expr> result = ExtractExpr::create(eval(ki, 0, state).value,
+    ref<Expr> result = ExtractExpr::create(eval(ki, 0, state).getValue(),
                                            0,
                                            getWidthForLLVMType(ci->getType()));
     bindLocal(ki, state, result);
@@ -2314,14 +2432,14 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
   case Instruction::ZExt: {
     CastInst *ci = cast<CastInst>(i);
-    ref<Expr> result = ZExtExpr::create(eval(ki, 0, state).value,
+    ref<Expr> result = ZExtExpr::create(eval(ki, 0, state).getValue(),
                                         getWidthForLLVMType(ci->getType()));
     bindLocal(ki, state, result);
     break;
   }
   case Instruction::SExt: {
     CastInst *ci = cast<CastInst>(i);
-    ref<Expr> result = SExtExpr::create(eval(ki, 0, state).value,
+    ref<Expr> result = SExtExpr::create(eval(ki, 0, state).getValue(),
                                         getWidthForLLVMType(ci->getType()));
     bindLocal(ki, state, result);
     break;
@@ -2330,20 +2448,20 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::IntToPtr: {
     CastInst *ci = cast<CastInst>(i);
     Expr::Width pType = getWidthForLLVMType(ci->getType());
-    ref<Expr> arg = eval(ki, 0, state).value;
+    ref<Expr> arg = eval(ki, 0, state).getValue();
     bindLocal(ki, state, ZExtExpr::create(arg, pType));
     break;
   }
   case Instruction::PtrToInt: {
     CastInst *ci = cast<CastInst>(i);
     Expr::Width iType = getWidthForLLVMType(ci->getType());
-    ref<Expr> arg = eval(ki, 0, state).value;
+    ref<Expr> arg = eval(ki, 0, state).getValue();
     bindLocal(ki, state, ZExtExpr::create(arg, iType));
     break;
   }
 
   case Instruction::BitCast: {
-    ref<Expr> result = eval(ki, 0, state).value;
+    ref<Expr> result = eval(ki, 0, state).getValue();
     bindLocal(ki, state, result);
     break;
   }
@@ -2351,9 +2469,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
     // Floating point instructions
 
   case Instruction::FAdd: {
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2366,9 +2484,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FSub: {
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2380,9 +2498,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FMul: {
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2395,9 +2513,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FDiv: {
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2410,9 +2528,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
 
   case Instruction::FRem: {
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2427,7 +2545,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::FPTrunc: {
     FPTruncInst *fi = cast<FPTruncInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).getValue(),
                                        "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || resultType > arg->getWidth())
       return terminateStateOnExecError(state, "Unsupported FPTrunc operation");
@@ -2444,7 +2562,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::FPExt: {
     FPExtInst *fi = cast<FPExtInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || arg->getWidth() > resultType)
       return terminateStateOnExecError(state, "Unsupported FPExt operation");
@@ -2460,7 +2578,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::FPToUI: {
     FPToUIInst *fi = cast<FPToUIInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).getValue(),
                                        "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || resultType > 64)
       return terminateStateOnExecError(state, "Unsupported FPToUI operation");
@@ -2477,7 +2595,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::FPToSI: {
     FPToSIInst *fi = cast<FPToSIInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).getValue(),
                                        "floating point");
     if (!fpWidthToSemantics(arg->getWidth()) || resultType > 64)
       return terminateStateOnExecError(state, "Unsupported FPToSI operation");
@@ -2494,7 +2612,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::UIToFP: {
     UIToFPInst *fi = cast<UIToFPInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).getValue(),
                                        "floating point");
     const llvm::fltSemantics *semantics = fpWidthToSemantics(resultType);
     if (!semantics)
@@ -2510,7 +2628,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::SIToFP: {
     SIToFPInst *fi = cast<SIToFPInst>(i);
     Expr::Width resultType = getWidthForLLVMType(fi->getType());
-    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> arg = toConstant(state, eval(ki, 0, state).getValue(),
                                        "floating point");
     const llvm::fltSemantics *semantics = fpWidthToSemantics(resultType);
     if (!semantics)
@@ -2525,9 +2643,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
 
   case Instruction::FCmp: {
     FCmpInst *fi = cast<FCmpInst>(i);
-    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).value,
+    ref<ConstantExpr> left = toConstant(state, eval(ki, 0, state).getValue(),
                                         "floating point");
-    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).value,
+    ref<ConstantExpr> right = toConstant(state, eval(ki, 1, state).getValue(),
                                          "floating point");
     if (!fpWidthToSemantics(left->getWidth()) ||
         !fpWidthToSemantics(right->getWidth()))
@@ -2609,8 +2727,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::InsertValue: {
     KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(ki);
 
-    ref<Expr> agg = eval(ki, 0, state).value;
-    ref<Expr> val = eval(ki, 1, state).value;
+    ref<Expr> agg = eval(ki, 0, state).getValue();
+    ref<Expr> val = eval(ki, 1, state).getValue();
 
     ref<Expr> l = NULL, r = NULL;
     unsigned lOffset = kgepi->offset*8, rOffset = kgepi->offset*8 + val->getWidth();
@@ -2636,7 +2754,7 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   case Instruction::ExtractValue: {
     KGEPInstruction *kgepi = static_cast<KGEPInstruction*>(ki);
 
-    ref<Expr> agg = eval(ki, 0, state).value;
+    ref<Expr> agg = eval(ki, 0, state).getValue();
 
     ref<Expr> result = ExtractExpr::create(agg, kgepi->offset*8, getWidthForLLVMType(i->getType()));
 
@@ -2649,9 +2767,9 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
   case Instruction::InsertElement: {
     InsertElementInst *iei = cast<InsertElementInst>(i);
-    ref<Expr> vec = eval(ki, 0, state).value;
-    ref<Expr> newElt = eval(ki, 1, state).value;
-    ref<Expr> idx = eval(ki, 2, state).value;
+    ref<Expr> vec = eval(ki, 0, state).getValue();
+    ref<Expr> newElt = eval(ki, 1, state).getValue();
+    ref<Expr> idx = eval(ki, 2, state).getValue();
 
     ConstantExpr *cIdx = dyn_cast<ConstantExpr>(idx);
     if (cIdx == NULL) {
@@ -2688,8 +2806,8 @@ void Executor::executeInstruction(ExecutionState &state, KInstruction *ki) {
   }
   case Instruction::ExtractElement: {
     ExtractElementInst *eei = cast<ExtractElementInst>(i);
-    ref<Expr> vec = eval(ki, 0, state).value;
-    ref<Expr> idx = eval(ki, 1, state).value;
+    ref<Expr> vec = eval(ki, 0, state).getValue();
+    ref<Expr> idx = eval(ki, 1, state).getValue();
 
     ConstantExpr *cIdx = dyn_cast<ConstantExpr>(idx);
     if (cIdx == NULL) {
@@ -2745,11 +2863,10 @@ void Executor::updateStates(ExecutionState *current) {
     std::set<ExecutionState*>::iterator it2 = states.find(es);
     assert(it2!=states.end());
     states.erase(it2);
-    std::map<ExecutionState*, std::vector<SeedInfo> >::iterator it3 = 
-      seedMap.find(es);
-    if (it3 != seedMap.end())
-      seedMap.erase(it3);
+    seedMap.erase(es);
     processTree->remove(es->ptreeNode);
+    if (spiller)
+      spiller->discard(*es);
     delete es;
   }
   removedStates.clear();
@@ -2813,7 +2930,7 @@ void Executor::bindModuleConstants() {
   kmodule->constantTable = new Cell[kmodule->constants.size()];
   for (unsigned i=0; i<kmodule->constants.size(); ++i) {
     Cell &c = kmodule->constantTable[i];
-    c.value = evalConstant(kmodule->constants[i]);
+    c.setValue(evalConstant(kmodule->constants[i]));
   }
 }
 
@@ -2824,16 +2941,33 @@ void Executor::checkMemoryUsage() {
     // We need to avoid calling GetTotalMallocUsage() often because it
     // is O(elts on freelist). This is really bad since we start
     // to pummel the freelist once we hit the memory cap.
-    unsigned mbs = (util::GetTotalMallocUsage() >> 20) +
-                   (memory->getUsedDeterministicSize() >> 20);
+    auto getUsedMegabytes = [this]() -> unsigned {
+      return (util::GetTotalMallocUsage() >> 20) +
+             (memory->getUsedDeterministicSize() >> 20);
+    };
+    unsigned mbs = getUsedMegabytes();
+
+    if (mbs > MaxMemory && spiller) {
+      // Spilling loses no paths, so try it before the hard limit and before
+      // forking stops, and only fall back to those if it did not free
+      // enough.
+      unsigned numStates = states.size();
+      spillColdStates(std::max(1U, numStates - numStates * MaxMemory / mbs));
+      mbs = getUsedMegabytes();
+    }
 
     if (mbs > MaxMemory) {
       if (mbs > MaxMemory + 100) {
+        // Spilled states are already out of memory.
+        std::vector<ExecutionState *> arr;
+        for (std::set<ExecutionState *>::iterator it = states.begin(),
+               ie = states.end(); it != ie; ++it)
+          if (!spiller || !spiller->isSpilled(*it))
+            arr.push_back(*it);
         // just guess at how many to kill
-        unsigned numStates = states.size();
+        unsigned numStates = arr.size();
         unsigned toKill = std::max(1U, numStates - numStates * MaxMemory / mbs);
         klee_warning("killing %d states (over memory cap)", toKill);
-        std::vector<ExecutionState *> arr(states.begin(), states.end());
         for (unsigned i = 0, N = arr.size(); N && i < toKill; ++i, --N) {
           unsigned idx = rand() % N;
           // Make two pulls to try and not hit a state that
@@ -2852,14 +2986,66 @@ void Executor::checkMemoryUsage() {
   }
 }
 
+bool Executor::canSpillState(ExecutionState &state) const {
+  // States taking part in a merge or in a loop invariant induction round
+  // are used by other states; seeded states are stepped outside of the
+  // searcher.
+  return !spiller->isSpilled(&state) && state.loopInProcess.isNull() &&
+         !inCloseMerge.count(&state) && !seedMap.count(&state) &&
+         std::find(removedStates.begin(), removedStates.end(), &state) ==
+           removedStates.end();
+}
+
+void Executor::spillColdStates(unsigned count) {
+  std::vector<ExecutionState *> candidates;
+  for (std::set<ExecutionState *>::iterator it = states.begin(),
+         ie = states.end(); it != ie; ++it)
+    if (canSpillState(**it))
+      candidates.push_back(*it);
+  spiller->sortByColdness(candidates);
+
+  unsigned spilled = 0;
+  for (unsigned i = 0; i < candidates.size() && spilled < count; ++i)
+    if (spiller->spill(*candidates[i]))
+      ++spilled;
+
+  if (spilled)
+    klee_message("spilled %u states to disk (over memory cap, %u spilled "
+                 "in total)", spilled, spiller->getNumSpilled());
+  else
+    klee_warning_once(0, "over memory cap but no state could be spilled");
+}
+
+bool Executor::restoreState(ExecutionState &state) {
+  if (spiller->restore(state))
+    return true;
+  // Without its memory the state cannot produce anything meaningful, not
+  // even a test case.
+  klee_warning("dropping a spilled state that could not be restored");
+  removedStates.push_back(&state);
+  return false;
+}
+
 void Executor::doDumpStates() {
   if (!DumpStatesOnHalt || states.empty())
     return;
 
   klee_message("halting execution, dumping remaining states");
-  for (const auto &state : states)
-    terminateStateEarly(*state, "Execution halting.");
-  updateStates(nullptr);
+  if (!spiller) {
+    for (const auto &state : states)
+      terminateStateEarly(*state, "Execution halting.");
+    updateStates(nullptr);
+    return;
+  }
+
+  // Bring spilled states back one at a time, and let go of each state
+  // before the next one is loaded.
+  std::vector<ExecutionState *> remaining(states.begin(), states.end());
+  for (const auto &state : remaining) {
+    if (!spiller->isSpilled(state) || restoreState(*state))
+      terminateStateEarly(*state, "Execution halting.");
+    updateStates(nullptr);
+  }
 }
 
 void Executor::run(ExecutionState &initialState) {
@@ -2872,43 +3058,35 @@ void Executor::run(ExecutionState &initialState) {
   states.insert(&initialState);
 
   if (usingSeeds) {
-    std::vector<SeedInfo> &v = seedMap[&initialState];
-    
     for (std::vector<KTest*>::const_iterator it = usingSeeds->begin(), 
            ie = usingSeeds->end(); it != ie; ++it)
-      v.push_back(SeedInfo(*it));
+      seedMap.addSeed(&initialState, SeedInfo(*it));
 
     int lastNumSeeds = usingSeeds->size()+10;
     double lastTime, startTime = lastTime = util::getWallTime();
-    ExecutionState *lastState = 0;
     while (!seedMap.empty()) {
       if (haltExecution) {
         doDumpStates();
         return;
       }
 
-      std::map<ExecutionState*, std::vector<SeedInfo> >::iterator it = 
-        seedMap.upper_bound(lastState);
-      if (it == seedMap.end())
-        it = seedMap.begin();
-      lastState = it->first;
-      unsigned numSeeds = it->second.size();
-      ExecutionState &state = *lastState;
+      ExecutionState &state = *seedMap.selectState();
+      unsigned numSeeds = seedMap.find(&state)->size();
       KInstruction *ki = state.pc;
-      stepInstruction(state);
-
-      executeInstruction(state, ki);
+      {
+        ProfileScope scope(Profiler::Interpret);
+        stepInstruction(state);
+        executeInstruction(state, ki);
+      }
       processTimers(&state, MaxInstructionTime * numSeeds);
-      updateStates(&state);
+      {
+        ProfileScope scope(Profiler::Schedule);
+        updateStates(&state);
+      }
 
       if ((stats::instructions % 1000) == 0) {
-        int numSeeds = 0, numStates = 0;
-        for (std::map<ExecutionState*, std::vector<SeedInfo> >::iterator
-               it = seedMap.begin(), ie = seedMap.end();
-             it != ie; ++it) {
-          numSeeds += it->second.size();
-          numStates++;
-        }
+        int numSeeds = seedMap.getNumSeeds();
+        int numStates = seedMap.getNumStates();
         double time = util::getWallTime();
         if (SeedTime>0. && time > startTime + SeedTime) {
           klee_warning("seed time expired, %d seeds remain over %d states",
@@ -2945,23 +3123,213 @@ void Executor::run(ExecutionState &initialState) {
   std::vector<ExecutionState *> newStates(states.begin(), states.end());
   searcher->update(0, newStates, std::vector<ExecutionState *>());
 
+  if (SpillStates && MaxMemory)
+    spiller = new StateSpiller(interpreterHandler->getOutputFilename("spill"));
+
   while (!states.empty() && !haltExecution) {
-    ExecutionState &state = searcher->selectState();
+    ExecutionState *selected;
+    {
+      ProfileScope scope(Profiler::Schedule);
+      selected = &searcher->selectState();
+    }
+    ExecutionState &state = *selected;
+    if (spiller) {
+      if (spiller->isSpilled(&state) && !restoreState(state)) {
+        updateStates(0);
+        continue;
+      }
+      spiller->touch(&state);
+    }
     KInstruction *ki = state.pc;
-    stepInstruction(state);
-
-    executeInstruction(state, ki);
+    {
+      ProfileScope scope(Profiler::Interpret);
+      stepInstruction(state);
+      executeInstruction(state, ki);
+    }
     processTimers(&state, MaxInstructionTime);
 
     checkMemoryUsage();
 
-    updateStates(&state);
+    {
+      ProfileScope scope(Profiler::Schedule);
+      updateStates(&state);
+    }
+
+    if (interpreterOpts.NumPartitions && !partitionSelected) {
+      if (states.size() >= interpreterOpts.NumPartitions &&
+          canSplitExploration())
+        selectPartition();
+    } else if (ParallelWorkers && !parallelSplitDone &&
+               states.size() >= getNumParallelChunks() &&
+               (stats::instructions % 1000) == 0 && canSplitExploration()) {
+      splitExploration();
+    }
   }
 
   delete searcher;
   searcher = 0;
 
   doDumpStates();
+
+  delete spiller;
+  spiller = 0;
+}
+
+unsigned Executor::getNumParallelChunks() const {
+  return ParallelChunks ? ParallelChunks : 4 * ParallelWorkers;
+}
+
+bool Executor::canSplitExploration() const {
+  // Merges and invariant induction rounds coordinate several states, they
+  // have to finish within one process.
+  if (!mergeGroups.empty() || !inCloseMerge.empty())
+    return false;
+  for (std::set<ExecutionState*>::const_iterator it = states.begin(),
+         ie = states.end(); it != ie; ++it)
+    if (!(*it)->loopInProcess.isNull())
+      return false;
+  return true;
+}
+
+void Executor::getOrderedFrontier(std::vector<ExecutionState *> &frontier) {
+  // The position in the process tree does not depend on the searcher or
+  // on scheduling, unlike the order in which states were created.
+  std::vector<PTreeNode *> stack(1, processTree->root);
+  while (!stack.empty()) {
+    PTreeNode *n = stack.back();
+    stack.pop_back();
+    if (!n->left && !n->right) {
+      frontier.push_back(n->data);
+      continue;
+    }
+    if (n->right)
+      stack.push_back(n->right);
+    if (n->left)
+      stack.push_back(n->left);
+  }
+  assert(frontier.size() == states.size() && "frontier out of sync");
+}
+
+void Executor::selectPartition() {
+  partitionSelected = true;
+  unsigned partition = interpreterOpts.Partition;
+  unsigned numPartitions = interpreterOpts.NumPartitions;
+
+  std::vector<ExecutionState *> frontier;
+  getOrderedFrontier(frontier);
+  for (unsigned i = 0; i < frontier.size(); ++i)
+    if (i % numPartitions != partition)
+      removedStates.push_back(frontier[i]);
+  klee_message("exploring partition %u of %u (%u of %u states)", partition,
+               numPartitions,
+               (unsigned) (frontier.size() - removedStates.size()),
+               (unsigned) frontier.size());
+  updateStates(0);
+
+  interpreterHandler->beginPartition(partition, numPartitions);
+}
+
+void Executor::splitExploration() {
+  parallelSplitDone = true;
+  unsigned numChunks = getNumParallelChunks();
+
+  std::vector<ExecutionState *> frontier;
+  getOrderedFrontier(frontier);
+
+  klee_message("splitting %u states into %u chunks for %u workers",
+               (unsigned) frontier.size(), numChunks,
+               (unsigned) ParallelWorkers);
+
+  // Buffered output would otherwise be written once by every process.
+  interpreterHandler->flushOutputs();
+  if (statsTracker)
+    statsTracker->flushOutputs();
+  interpreterHandler->getInfoStream().flush();
+  llvm::outs().flush();
+  llvm::errs().flush();
+  fflush(0);
+
+  // Workers pull the next unexplored chunk from a shared counter, so a
+  // worker that finishes early takes over chunks the others have not
+  // started yet. A chunk that has started is not split again: once all
+  // chunks are taken, the run lasts as long as the heaviest of them, and
+  // only a larger --parallel-chunks evens that out.
+  void *shared = mmap(0, sizeof(std::atomic<unsigned>),
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                      -1, 0);
+  if (shared == MAP_FAILED) {
+    klee_warning("unable to split exploration: %s", strerror(errno));
+    return;
+  }
+  std::atomic<unsigned> *nextChunk = new (shared) std::atomic<unsigned>(0);
+
+  std::vector<pid_t> workers;
+  for (unsigned i = 0; i < ParallelWorkers; ++i) {
+    pid_t pid = ::fork();
+    if (pid < 0) {
+      klee_warning("unable to fork worker: %s", strerror(errno));
+      break;
+    }
+    if (pid > 0) {
+      workers.push_back(pid);
+      continue;
+    }
+
+    // Worker: the frontier is still intact here, so every chunk is
+    // explored in a fresh copy of this process.
+    for (unsigned chunk; (chunk = nextChunk->fetch_add(1)) < numChunks;) {
+      pid_t chunkPid = ::fork();
+      if (chunkPid == 0) {
+        interpreterHandler->beginChunk(chunk, numChunks);
+        if (statsTracker)
+          statsTracker->reopenOutputs();
+        Profiler::restartAfterFork();
+        for (unsigned j = 0; j < frontier.size(); ++j)
+          if (j % numChunks != chunk)
+            removedStates.push_back(frontier[j]);
+        updateStates(0);
+        return;
+      }
+      int status;
+      if (chunkPid < 0)
+        klee_warning("unable to fork for chunk %u: %s", chunk,
+                     strerror(errno));
+      else
+        while (waitpid(chunkPid, &status, 0) < 0 && errno == EINTR)
+          ;
+    }
+    _exit(0);
+  }
+
+  if (workers.empty()) {
+    munmap(shared, sizeof(std::atomic<unsigned>));
+    klee_warning("no worker could be started, exploring sequentially");
+    return;
+  }
+
+  for (std::vector<pid_t>::iterator it = workers.begin(), ie = workers.end();
+       it != ie; ++it) {
+    int status;
+    while (waitpid(*it, &status, 0) < 0 && errno == EINTR)
+      ;
+  }
+  munmap(shared, sizeof(std::atomic<unsigned>));
+
+  interpreterHandler->mergeChunks(numChunks);
+
+  // Everything below the frontier has been explored by the workers.
+  removedStates.insert(removedStates.end(), frontier.begin(), frontier.end());
+  updateStates(0);
+}
+
+void Executor::writeProfile() {
+  if (!Profiler::isEnabled())
+    return;
+  Profiler::stop();
+  if (llvm::raw_ostream *os = interpreterHandler->openOutputFile("run.folded")) {
+    Profiler::write(*os);
+    delete os;
+  }
 }
 
 std::string Executor::getAddressInfo(ExecutionState &state, 
@@ -3046,6 +3414,7 @@ void Executor::terminateState(ExecutionState &state) {
 
   if (state.loopInProcess.isNull()) {
     if (state.doTrace) {
+      ProfileScope scope(Profiler::TestGeneration);
       interpreterHandler->processCallPath(state);
       interpreterHandler->processTestCase(state,NULL,NULL);
     }
@@ -3065,10 +3434,7 @@ void Executor::terminateState(ExecutionState &state) {
     removedStates.push_back(&state);
   } else {
     // never reached searcher, just delete immediately
-    std::map< ExecutionState*, std::vector<SeedInfo> >::iterator it3 = 
-      seedMap.find(&state);
-    if (it3 != seedMap.end())
-      seedMap.erase(it3);
+    seedMap.erase(&state);
     addedStates.erase(it);
     processTree->remove(state.ptreeNode);
     delete &state;
@@ -3078,9 +3444,11 @@ void Executor::terminateState(ExecutionState &state) {
 void Executor::terminateStateEarly(ExecutionState &state, 
                                    const Twine &message) {
   if (!OnlyOutputStatesCoveringNew || state.coveredNew ||
-      (AlwaysOutputSeeds && seedMap.count(&state)))
+      (AlwaysOutputSeeds && seedMap.count(&state))) {
+    ProfileScope scope(Profiler::TestGeneration);
     interpreterHandler->processTestCase(state, (message + "\n").str().c_str(),
                                         "early");
+  }
   terminateState(state);
 }
 
@@ -3174,6 +3542,7 @@ void Executor::recordState(ExecutionState &state, const llvm::Twine &messaget,
   if (info_str != "")
     msg << "Info: \n" << info_str;
 
+  ProfileScope scope(Profiler::TestGeneration);
   interpreterHandler->processTestCase(state, msg.str().c_str(), suffix);
 }
 
@@ -3219,6 +3588,7 @@ void Executor::terminateStateOnError(ExecutionState &state,
       suffix = suffix_buf.c_str();
     }
 
+    ProfileScope scope(Profiler::TestGeneration);
     interpreterHandler->processTestCase(state, msg.str().c_str(), suffix);
   }
   state.doTrace = false;
@@ -3251,6 +3621,7 @@ void Executor::callExternalFunction(ExecutionState &state,
   }
 
   // normal external function handling path
+  ProfileScope scope(Profiler::ExternalCall);
   // allocate 128 bits for each argument (+return value) to support fp80's;
   // we could iterate through all the arguments first and determine the exact
   // size we need, but this is faster, and the memory usage isn't significant.
@@ -3631,42 +4002,26 @@ void Executor::executeMemoryOperation(ExecutionState &state,
     //}
 
     // check if the operation is intercepted
-    if (isWrite) {
-      std::string interceptWriter = state.getInterceptWriter(mo->address);
-      if (interceptWriter != "") {
-        GlobalValue *gv = kmodule->module->getNamedValue(interceptWriter);
-        if (!gv) {
-          klee_error("Function %s(), interceptor, not found!\n", interceptWriter.c_str());
-        }
-        Function* interceptFunc;
-        if (!(interceptFunc = dyn_cast<Function>(gv))) {
-          klee_error("Interceptor is not a function\n");
+    if (state.hasIntercepts()) {
+      if (isWrite) {
+        if (Function *interceptFunc = state.getInterceptWriter(mo->address)) {
+          std::vector<ref<Expr>> interceptArgs;
+          interceptArgs.push_back(/* address */ ConstantExpr::alloc(mo->address, 64));
+          interceptArgs.push_back(/* offset */ ZExtExpr::create(offset, 32));
+          interceptArgs.push_back(/* size */ ConstantExpr::alloc(bytes, 32));
+          interceptArgs.push_back(/* value */ ZExtExpr::create(value, 64));
+          executeCall(state, target, interceptFunc, interceptArgs);
+          return;
         }
-        std::vector<ref<Expr>> interceptArgs;
-        interceptArgs.push_back(/* address */ ConstantExpr::alloc(mo->address, 64));
-        interceptArgs.push_back(/* offset */ ZExtExpr::create(offset, 32));
-        interceptArgs.push_back(/* size */ ConstantExpr::alloc(bytes, 32));
-        interceptArgs.push_back(/* value */ ZExtExpr::create(value, 64));
-        executeCall(state, target, interceptFunc, interceptArgs);
-        return;
-      }
-    } else {
-      std::string interceptReader = state.getInterceptReader(mo->address);
-      if (interceptReader != "") {
-        GlobalValue *gv = kmodule->module->getNamedValue(interceptReader);
-        if (!gv) {
-          klee_error("Function %s(), interceptor, not found!\n", interceptReader.c_str());
-        }
-        Function* interceptFunc;
-        if (!(interceptFunc = dyn_cast<Function>(gv))) {
-          klee_error("Interceptor is not a function\n");
+      } else {
+        if (Function *interceptFunc = state.getInterceptReader(mo->address)) {
+          std::vector<ref<Expr>> interceptArgs;
+          interceptArgs.push_back(/* address */ ConstantExpr::alloc(mo->address, 64));
+          interceptArgs.push_back(/* offset */ ZExtExpr::create(offset, 32));
+          interceptArgs.push_back(/* size */ ConstantExpr::alloc(bytes, 32));
+          executeCall(state, target, interceptFunc, interceptArgs);
+          return;
         }
-        std::vector<ref<Expr>> interceptArgs;
-        interceptArgs.push_back(/* address */ ConstantExpr::alloc(mo->address, 64));
-        interceptArgs.push_back(/* offset */ ZExtExpr::create(offset, 32));
-        interceptArgs.push_back(/* size */ ConstantExpr::alloc(bytes, 32));
-        executeCall(state, target, interceptFunc, interceptArgs);
-        return;
       }
     }
 
@@ -3780,12 +4135,10 @@ void Executor::executeMakeSymbolic(ExecutionState &state,
     bindObjectInState(state, mo, false, array);
     state.addSymbolic(mo, array);
     
-    std::map< ExecutionState*, std::vector<SeedInfo> >::iterator it = 
-      seedMap.find(&state);
-    if (it!=seedMap.end()) { // In seed mode we need to add this as a
-                             // binding.
-      for (std::vector<SeedInfo>::iterator siit = it->second.begin(), 
-             siie = it->second.end(); siit != siie; ++siit) {
+    std::vector<SeedInfo> *seeds = seedMap.find(&state);
+    if (seeds) { // In seed mode we need to add this as a binding.
+      for (std::vector<SeedInfo>::iterator siit = seeds->begin(), 
+             siie = seeds->end(); siit != siie; ++siit) {
         SeedInfo &si = *siit;
         KTestObject *obj = si.getNextInput(mo, NamedSeedMatching);
 
@@ -3931,6 +4284,7 @@ void Executor::runFunctionAsMain(Function *f,
   ExecutionState *state = new ExecutionState(kmodule->functionMap[f]);
 
   state->condoneUndeclaredHavocs = interpreterOpts.CondoneUndeclaredHavocs;
+  state->callPrefix = CallPrefix(interpreterHandler->getCallPrefixTree());
   if (pathWriter) 
     state->pathOS = pathWriter->open();
   if (symPathWriter) 
@@ -3974,7 +4328,10 @@ void Executor::runFunctionAsMain(Function *f,
 
   processTree = new PTree(state);
   state->ptreeNode = processTree->root;
+  if (Profile)
+    Profiler::start(ProfileInterval);
   run(*state);
+  writeProfile();
   delete processTree;
   processTree = 0;
 
@@ -3988,6 +4345,7 @@ void Executor::runFunctionAsMain(Function *f,
 
   if (statsTracker)
     statsTracker->done();
+  interpreterHandler->flushOutputs();
 }
 
 unsigned Executor::getPathStreamID(const ExecutionState &state) {
@@ -4219,10 +4577,12 @@ size_t Executor::getAllocationAlignment(const llvm::Value *allocSite) const {
 }
 
 void Executor::prepareForEarlyExit() {
+  writeProfile();
   if (statsTracker) {
     // Make sure stats get flushed out
     statsTracker->done();
   }
+  interpreterHandler->flushOutputs();
 }
 
 /// Returns the errno location in memory
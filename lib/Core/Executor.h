@@ -21,6 +21,7 @@
 #include "klee/Internal/Module/KInstruction.h"
 #include "klee/Internal/Module/KModule.h"
 #include "klee/util/ArrayCache.h"
+#include "SeedMap.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include "llvm/ADT/Twine.h"
@@ -66,6 +67,7 @@ namespace klee {
   class SeedInfo;
   class SpecialFunctionHandler;
   struct StackFrame;
+  class StateSpiller;
   class StatsTracker;
   class TimingSolver;
   class TreeStreamWriter;
@@ -135,6 +137,10 @@ private:
   std::vector<TimerInfo*> timers;
   PTree *processTree;
 
+  /// Non-null when over-memory states are moved to disk instead of being
+  /// terminated. \see checkMemoryUsage()
+  StateSpiller *spiller;
+
   /// Keeps track of all currently ongoing merges.
   /// An ongoing merge is a set of states which branched from a single state
   /// which ran into a klee_open_merge(), and not all states in the set have
@@ -170,7 +176,7 @@ private:
   /// satisfies one or more seeds will be added to this map. What
   /// happens with other states (that don't satisfy the seeds) depends
   /// on as-yet-to-be-determined flags.
-  std::map<ExecutionState*, std::vector<SeedInfo> > seedMap;
+  SeedMap seedMap;
   
   /// Map of globals to their representative memory object.
   std::map<const llvm::GlobalValue*, MemoryObject*> globalObjects;
@@ -207,6 +213,14 @@ private:
   /// step.
   bool haltExecution;  
 
+  /// Set once the frontier has been handed out to the parallel workers.
+  /// \see splitExploration()
+  bool parallelSplitDone;
+
+  /// Set once this process has dropped the states of the other
+  /// partitions. \see selectPartition()
+  bool partitionSelected;
+
   /// Whether implied-value concretization is enabled. Currently
   /// false, it is buggy (it needs to validate its writes).
   bool ivcEnabled;
@@ -234,6 +248,7 @@ private:
                                     ExecutionState &state);
   
   void executeInstruction(ExecutionState &state, KInstruction *ki);
+  bool executeInlineConstantOp(ExecutionState &state, KInstruction *ki);
 
   void printFileLine(ExecutionState &state, KInstruction *ki,
                      llvm::raw_ostream &file);
@@ -252,6 +267,21 @@ private:
 
   void stepInstruction(ExecutionState &state);
   void updateStates(ExecutionState *current);
+
+  unsigned getNumParallelChunks() const;
+  bool canSplitExploration() const;
+  /// The leaves of the process tree, false branches first.
+  void getOrderedFrontier(std::vector<ExecutionState *> &frontier);
+  /// Keep only this process' share of the frontier, see
+  /// InterpreterOptions::NumPartitions.
+  void selectPartition();
+  /// Split the current frontier into chunks and explore them in forked
+  /// worker processes (--parallel-workers). The calling process waits for
+  /// the workers, merges their outputs and is left without states; each
+  /// chunk process returns with only its share of the frontier.
+  void splitExploration();
+  /// Stop the --profile sampler and write its samples to run.folded.
+  void writeProfile();
   void handleLoopAnalysis(llvm::BasicBlock *dst,
                           llvm::BasicBlock *src,
                           ExecutionState &state);
@@ -353,6 +383,13 @@ private:
   /// validity checks, and seed patching.
   void addConstraint(ExecutionState &state, ref<Expr> condition);
 
+  /// A value of \p e under \p seed. The seeds of a state often reduce
+  /// \p e to the same expression, which is then only solved once: \p
+  /// cache maps the expressions solved so far to their value.
+  ref<ConstantExpr>
+  getSeedValue(ExecutionState &state, SeedInfo &seed, ref<Expr> e,
+               std::map<ref<Expr>, ref<ConstantExpr> > &cache);
+
   // Called on [for now] concrete reads, replaces constant with a symbolic
   // Used for testing.
   ref<Expr> replaceReadWithSymbolic(ExecutionState &state, ref<Expr> e);
@@ -363,12 +400,14 @@ private:
   Cell& getArgumentCell(ExecutionState &state,
                         KFunction *kf,
                         unsigned index) {
-    return state.stack.back().locals[kf->getArgRegister(index)];
+    return state.stack.back().locals.getWriteable(state.frameArena)
+      [kf->getArgRegister(index)];
   }
 
   Cell& getDestCell(ExecutionState &state,
                     KInstruction *target) {
-    return state.stack.back().locals[target->dest];
+    return state.stack.back().locals.getWriteable(state.frameArena)
+      [target->dest];
   }
 
   void bindLocal(KInstruction *target, 
@@ -476,6 +515,9 @@ private:
   void processTimers(ExecutionState *current,
                      double maxInstTime);
   void checkMemoryUsage();
+  bool canSpillState(ExecutionState &state) const;
+  void spillColdStates(unsigned count);
+  bool restoreState(ExecutionState &state);
   void printDebugInstructions(ExecutionState &state);
   void doDumpStates();
 
@@ -0,0 +1,219 @@
+//===-- FrameArena.cpp ----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/Module/FrameArena.h"
+
+#include "CoreStats.h"
+
+#include <algorithm>
+#include <new>
+
+using namespace klee;
+
+struct FrameArena::Chunk {
+  /// One for each live block, plus one while it is an arena's current
+  /// chunk.
+  unsigned references;
+  size_t capacity;
+  size_t top;
+  /// Released blocks below top, to be reused while this is the current
+  /// chunk.
+  FrameLocals::Block *freeBlocks;
+
+  char *data() { return reinterpret_cast<char *>(this + 1); }
+};
+
+struct FrameLocals::Block {
+  unsigned references;
+  unsigned size;
+  /// The number of cells there is room for, at least size.
+  unsigned capacity;
+  FrameArena::Chunk *chunk;
+  size_t offset;
+  /// The next block of chunk->freeBlocks, once released.
+  Block *nextFree;
+
+  Cell *cells() { return reinterpret_cast<Cell *>(this + 1); }
+  size_t getEnd() const {
+    return offset + sizeof(Block) + capacity * sizeof(Cell);
+  }
+};
+
+static_assert(sizeof(FrameArena::Chunk) % alignof(FrameLocals::Block) == 0,
+              "misaligned frame blocks");
+static_assert(sizeof(FrameLocals::Block) % alignof(Cell) == 0,
+              "misaligned frame cells");
+static_assert(sizeof(Cell) % alignof(FrameLocals::Block) == 0,
+              "misaligned frame blocks");
+
+/// Chunks double in size up to this, room for a few hundred typical
+/// frames. Larger frames get a chunk of their own.
+static const size_t MaxChunkSize = 64 * 1024;
+
+static FrameArena::Chunk *createChunk(size_t capacity) {
+  FrameArena::Chunk *c = new (::operator new(sizeof(FrameArena::Chunk) +
+                                             capacity)) FrameArena::Chunk;
+  c->references = 1;
+  c->capacity = capacity;
+  c->top = 0;
+  c->freeBlocks = 0;
+  ++stats::frameArenaChunks;
+  stats::frameArenaBytes += capacity;
+  return c;
+}
+
+static void releaseChunk(FrameArena::Chunk *c) {
+  if (c && --c->references == 0) {
+    c->~Chunk();
+    ::operator delete(c);
+  }
+}
+
+/// Remove from the free list of \a c the block that ends at \a end, if any.
+static FrameLocals::Block *takeFreeBlockEndingAt(FrameArena::Chunk *c,
+                                                 size_t end) {
+  for (FrameLocals::Block **b = &c->freeBlocks; *b; b = &(*b)->nextFree) {
+    if ((*b)->getEnd() == end) {
+      FrameLocals::Block *found = *b;
+      *b = found->nextFree;
+      return found;
+    }
+  }
+  return 0;
+}
+
+/// Remove from the free list of \a c the smallest block with room for
+/// \a numCells, if any.
+static FrameLocals::Block *takeFreeBlock(FrameArena::Chunk *c,
+                                         unsigned numCells) {
+  FrameLocals::Block **best = 0;
+  for (FrameLocals::Block **b = &c->freeBlocks; *b; b = &(*b)->nextFree)
+    if ((*b)->capacity >= numCells &&
+        (!best || (*b)->capacity < (*best)->capacity))
+      best = b;
+  if (!best)
+    return 0;
+  FrameLocals::Block *found = *best;
+  *best = found->nextFree;
+  return found;
+}
+
+static void releaseBlock(FrameLocals::Block *b) {
+  if (!b || --b->references)
+    return;
+
+  FrameArena::Chunk *c = b->chunk;
+  for (unsigned i = 0; i < b->size; ++i)
+    b->cells()[i].~Cell();
+  if (c->top == b->getEnd()) {
+    // Give back this block, and the released blocks right below it.
+    c->top = b->offset;
+    b->~Block();
+    while (FrameLocals::Block *f = takeFreeBlockEndingAt(c, c->top)) {
+      c->top = f->offset;
+      f->~Block();
+    }
+  } else {
+    b->nextFree = c->freeBlocks;
+    c->freeBlocks = b;
+  }
+  releaseChunk(c);
+}
+
+/***/
+
+FrameLocals::FrameLocals(const FrameLocals &b) : block(b.block) {
+  if (block)
+    ++block->references;
+}
+
+FrameLocals::~FrameLocals() {
+  releaseBlock(block);
+}
+
+FrameLocals &FrameLocals::operator=(const FrameLocals &b) {
+  if (b.block)
+    ++b.block->references;
+  releaseBlock(block);
+  block = b.block;
+  return *this;
+}
+
+unsigned FrameLocals::size() const {
+  return block ? block->size : 0;
+}
+
+bool FrameLocals::isShared() const {
+  return block && block->references > 1;
+}
+
+const Cell *FrameLocals::cells() const {
+  return block->cells();
+}
+
+Cell *FrameLocals::getWriteable(FrameArena &arena) {
+  assert(block && "writing to an unallocated frame");
+  if (block->references > 1) {
+    FrameLocals copy = arena.allocate(block->size);
+    for (unsigned i = 0; i < block->size; ++i)
+      copy.block->cells()[i] = block->cells()[i];
+    *this = copy;
+    ++stats::frameCopies;
+  }
+  return block->cells();
+}
+
+/***/
+
+FrameArena::~FrameArena() {
+  releaseChunk(current);
+}
+
+FrameLocals FrameArena::allocate(unsigned numCells) {
+  size_t bytes = sizeof(FrameLocals::Block) + numCells * sizeof(Cell);
+
+  FrameLocals::Block *b = 0;
+  Chunk *c;
+  if (bytes > MaxChunkSize) {
+    // Too big to share a chunk; give it one of its own that goes away
+    // with it.
+    c = createChunk(bytes);
+  } else {
+    if (current)
+      b = takeFreeBlock(current, numCells);
+    if (!b && (!current || current->capacity - current->top < bytes)) {
+      // The first chunk only holds the first frame: a forked state may
+      // never need more than its copy of the top frame.
+      size_t capacity = current ? std::min(2 * current->capacity, MaxChunkSize)
+                                : 0;
+      releaseChunk(current);
+      current = createChunk(std::max(bytes, capacity));
+    }
+    c = current;
+    ++c->references;
+  }
+
+  if (b) {
+    b->references = 1;
+    b->size = numCells;
+  } else {
+    b = new (c->data() + c->top) FrameLocals::Block;
+    b->references = 1;
+    b->size = numCells;
+    b->capacity = numCells;
+    b->chunk = c;
+    b->offset = c->top;
+    c->top += bytes;
+  }
+  for (unsigned i = 0; i < numCells; ++i)
+    new (&b->cells()[i]) Cell();
+
+  ++stats::frameAllocations;
+  return FrameLocals(b);
+}
@@ -99,10 +99,10 @@ ObjectState::ObjectState(const MemoryObject *mo)
   : copyOnWriteOwner(0),
     refCount(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(mo->size),
     concreteMask(0),
     flushMask(0),
-    knownSymbolics(0),
+    knownSymbolics(mo->size),
     updates(0, 0),
     size(mo->size),
     readOnly(false),
@@ -114,7 +114,6 @@ ObjectState::ObjectState(const MemoryObject *mo)
         getArrayCache()->CreateArray("tmp_arr" + llvm::utostr(++id), size);
     updates = UpdateList(array, 0);
   }
-  memset(concreteStore, 0, size);
 }
 
 
@@ -122,27 +121,26 @@ ObjectState::ObjectState(const MemoryObject *mo, const Array *array)
   : copyOnWriteOwner(0),
     refCount(0),
     object(mo),
-    concreteStore(new uint8_t[mo->size]),
+    concreteStore(mo->size),
     concreteMask(0),
     flushMask(0),
-    knownSymbolics(0),
+    knownSymbolics(mo->size),
     updates(array, 0),
     size(mo->size),
     readOnly(false),
     accessible(true) {
   mo->refCount++;
   makeSymbolic();
-  memset(concreteStore, 0, size);
 }
 
 ObjectState::ObjectState(const ObjectState &os) 
   : copyOnWriteOwner(0),
     refCount(0),
     object(os.object),
-    concreteStore(new uint8_t[os.size]),
-    concreteMask(os.concreteMask ? new BitArray(*os.concreteMask, os.size) : 0),
-    flushMask(os.flushMask ? new BitArray(*os.flushMask, os.size) : 0),
-    knownSymbolics(0),
+    concreteStore(os.concreteStore),
+    concreteMask(os.concreteMask ? new PagedBitArray(*os.concreteMask) : 0),
+    flushMask(os.flushMask ? new PagedBitArray(*os.flushMask) : 0),
+    knownSymbolics(os.knownSymbolics),
     updates(os.updates),
     size(os.size),
     readOnly(false),
@@ -151,22 +149,12 @@ ObjectState::ObjectState(const ObjectState &os)
   assert(!os.readOnly && "no need to copy read only object?");
   if (object)
     object->refCount++;
-
-  if (os.knownSymbolics) {
-    knownSymbolics = new ref<Expr>[size];
-    for (unsigned i=0; i<size; i++)
-      knownSymbolics[i] = os.knownSymbolics[i];
-  }
-
-  memcpy(concreteStore, os.concreteStore, size*sizeof(*concreteStore));
 }
 
 ObjectState::~ObjectState() {
   assert(refCount == 0);
   if (concreteMask) delete concreteMask;
   if (flushMask) delete flushMask;
-  if (knownSymbolics) delete[] knownSymbolics;
-  delete[] concreteStore;
 
   if (object)
   {
@@ -248,7 +236,7 @@ void ObjectState::flushToConcreteStore(TimingSolver *solver,
                      "byte %p+%u will have random value",
                      (void *)object->address, i);
       else
-        ce->toMemory(concreteStore + i);
+        concreteStore.set(i, ce->getZExtValue(8));
     }
   }
 }
@@ -256,10 +244,9 @@ void ObjectState::flushToConcreteStore(TimingSolver *solver,
 void ObjectState::makeConcrete() {
   if (concreteMask) delete concreteMask;
   if (flushMask) delete flushMask;
-  if (knownSymbolics) delete[] knownSymbolics;
   concreteMask = 0;
   flushMask = 0;
-  knownSymbolics = 0;
+  knownSymbolics.clear();
 }
 
 void ObjectState::makeSymbolic() {
@@ -346,7 +333,7 @@ void ObjectState::forbidAccessWithLastMessage() {
 void ObjectState::initializeToZero() {
   assert(accessible);
   makeConcrete();
-  memset(concreteStore, 0, size);
+  concreteStore.clear();
 }
 
 void ObjectState::initializeToRandom() {  
@@ -354,7 +341,7 @@ void ObjectState::initializeToRandom() {
   makeConcrete();
   for (unsigned i=0; i<size; i++) {
     // randomly selected by 256 sided die
-    concreteStore[i] = 0xAB;
+    concreteStore.set(i, 0xAB);
   }
 }
 
@@ -375,17 +362,18 @@ void ObjectState::fastRangeCheckOffset(ref<Expr> offset,
 
 void ObjectState::flushRangeForRead(unsigned rangeBase, 
                                     unsigned rangeSize) const {
-  if (!flushMask) flushMask = new BitArray(size, true);
+  if (!flushMask) flushMask = new PagedBitArray(size, true);
  
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
       if (isByteConcrete(offset)) {
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       ConstantExpr::create(concreteStore[offset], Expr::Int8));
+                       ConstantExpr::create(concreteStore.get(offset),
+                                            Expr::Int8));
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       knownSymbolics.get(offset));
       }
 
       flushMask->unset(offset);
@@ -395,18 +383,19 @@ void ObjectState::flushRangeForRead(unsigned rangeBase,
 
 void ObjectState::flushRangeForWrite(unsigned rangeBase, 
                                      unsigned rangeSize) {
-  if (!flushMask) flushMask = new BitArray(size, true);
+  if (!flushMask) flushMask = new PagedBitArray(size, true);
 
   for (unsigned offset=rangeBase; offset<rangeBase+rangeSize; offset++) {
     if (!isByteFlushed(offset)) {
       if (isByteConcrete(offset)) {
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       ConstantExpr::create(concreteStore[offset], Expr::Int8));
+                       ConstantExpr::create(concreteStore.get(offset),
+                                            Expr::Int8));
         markByteSymbolic(offset);
       } else {
         assert(isByteKnownSymbolic(offset) && "invalid bit set in flushMask");
         updates.extend(ConstantExpr::create(offset, Expr::Int32),
-                       knownSymbolics[offset]);
+                       knownSymbolics.get(offset));
         setKnownSymbolic(offset, 0);
       }
 
@@ -432,7 +421,7 @@ bool ObjectState::isByteFlushed(unsigned offset) const {
 }
 
 bool ObjectState::isByteKnownSymbolic(unsigned offset) const {
-  return knownSymbolics && knownSymbolics[offset].get();
+  return knownSymbolics.get(offset).get();
 }
 
 void ObjectState::markByteConcrete(unsigned offset) {
@@ -442,7 +431,7 @@ void ObjectState::markByteConcrete(unsigned offset) {
 
 void ObjectState::markByteSymbolic(unsigned offset) {
   if (!concreteMask)
-    concreteMask = new BitArray(size, true);
+    concreteMask = new PagedBitArray(size, true);
   concreteMask->unset(offset);
 }
 
@@ -453,7 +442,7 @@ void ObjectState::markByteUnflushed(unsigned offset) {
 
 void ObjectState::markByteFlushed(unsigned offset) {
   if (!flushMask) {
-    flushMask = new BitArray(size, false);
+    flushMask = new PagedBitArray(size, false);
   } else {
     flushMask->unset(offset);
   }
@@ -461,14 +450,10 @@ void ObjectState::markByteFlushed(unsigned offset) {
 
 void ObjectState::setKnownSymbolic(unsigned offset, 
                                    Expr *value /* can be null */) {
-  if (knownSymbolics) {
-    knownSymbolics[offset] = value;
-  } else {
-    if (value) {
-      knownSymbolics = new ref<Expr>[size];
-      knownSymbolics[offset] = value;
-    }
-  }
+  // Clearing a byte that holds nothing must not allocate or unshare its
+  // page.
+  if (value || isByteKnownSymbolic(offset))
+    knownSymbolics.set(offset, value);
 }
 
 /***/
@@ -477,9 +462,9 @@ ref<Expr> ObjectState::read8(unsigned offset,
                              bool circumventInaccessibility) const {
   assert(circumventInaccessibility || accessible);
   if (isByteConcrete(offset)) {
-    return ConstantExpr::create(concreteStore[offset], Expr::Int8);
+    return ConstantExpr::create(concreteStore.get(offset), Expr::Int8);
   } else if (isByteKnownSymbolic(offset)) {
-    return knownSymbolics[offset];
+    return knownSymbolics.get(offset);
   } else {
     assert(isByteFlushed(offset) && "unflushed byte without cache value");
 
@@ -508,7 +493,8 @@ ref<Expr> ObjectState::read8(ref<Expr> offset) const {
 void ObjectState::write8(unsigned offset, uint8_t value) {
   assert(accessible);
   //assert(read_only == false && "writing to read-only object!");
-  concreteStore[offset] = value;
+  if (concreteStore.get(offset) != value)
+    concreteStore.set(offset, value);
   setKnownSymbolic(offset, 0);
 
   markByteConcrete(offset);
@@ -13,6 +13,7 @@
 #include "Context.h"
 #include "TimingSolver.h"
 #include "klee/Expr.h"
+#include "klee/Internal/ADT/PagedArray.h"
 
 #include "llvm/ADT/StringExtras.h"
 
@@ -34,6 +35,7 @@ class MemoryObject {
   friend class STPBuilder;
   friend class ObjectState;
   friend class ExecutionState;
+  friend class StateSpiller;
 
 private:
   static int counter;
@@ -152,17 +154,23 @@ private:
   friend class ObjectHolder;
   unsigned refCount;
 
+  friend class StateSpiller;
+
   const MemoryObject *object;
 
-  uint8_t *concreteStore;
+  // The byte caches below are paged, so that the copy made by the first
+  // write after a fork only duplicates the pages that are written.
+
+  // mutable because flushToConcreteStore() fills it from a const object
+  mutable PagedArray<uint8_t> concreteStore;
 
   // XXX cleanup name of flushMask (its backwards or something)
-  BitArray *concreteMask;
+  PagedBitArray *concreteMask;
 
   // mutable because may need flushed during read of const
-  mutable BitArray *flushMask;
+  mutable PagedBitArray *flushMask;
 
-  ref<Expr> *knownSymbolics;
+  PagedArray<ref<Expr> > knownSymbolics;
 
   // mutable because we may need flush during read of const
   mutable UpdateList updates;
@@ -0,0 +1,151 @@
+//===-- Profiler.cpp ------------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Profiler.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace klee;
+
+bool Profiler::enabled = false;
+std::atomic<uint32_t> Profiler::stack[Profiler::MaxDepth];
+std::atomic<unsigned> Profiler::depth(0);
+
+namespace {
+  const char *phaseNames[Profiler::NumPhases] = {
+    "interpret",
+    "schedule",
+    "solver",
+    "resolve",
+    "fork",
+    "external-call",
+    "special",
+    "test-generation",
+  };
+
+  /// Sampler state. The thread only touches samples (under lock, so
+  /// that write() can run while sampling) and reads the phase stack.
+  struct Sampler {
+    unsigned intervalUs;
+    std::atomic<bool> running;
+    std::thread thread;
+    std::mutex lock;
+    std::map<std::vector<uint32_t>, uint64_t> samples;
+
+    /// Detail names by id; id 0 means no detail.
+    std::vector<std::string> details;
+    std::unordered_map<const void *, unsigned> detailIds;
+
+    Sampler() : intervalUs(1000), running(false), details(1) {}
+    ~Sampler() {
+      // Exiting with a joinable thread would terminate the process.
+      if (thread.joinable()) {
+        running = false;
+        thread.join();
+      }
+    }
+  };
+
+  Sampler &getSampler() {
+    static Sampler sampler;
+    return sampler;
+  }
+}
+
+static void sample(std::atomic<uint32_t> *stack, std::atomic<unsigned> &depth) {
+  Sampler &s = getSampler();
+  std::vector<uint32_t> frames;
+  while (s.running.load()) {
+    std::this_thread::sleep_for(std::chrono::microseconds(s.intervalUs));
+
+    unsigned d = depth.load(std::memory_order_acquire);
+    if (d > Profiler::MaxDepth)
+      d = Profiler::MaxDepth;
+    frames.resize(d);
+    for (unsigned i = 0; i < d; ++i)
+      frames[i] = stack[i].load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> guard(s.lock);
+    ++s.samples[frames];
+  }
+}
+
+unsigned Profiler::getDetail(const void *key, llvm::StringRef name) {
+  Sampler &s = getSampler();
+  std::unordered_map<const void *, unsigned>::iterator it =
+    s.detailIds.find(key);
+  if (it != s.detailIds.end())
+    return it->second;
+
+  unsigned id = s.details.size();
+  s.details.push_back(name.str());
+  s.detailIds[key] = id;
+  return id;
+}
+
+void Profiler::start(unsigned intervalUs) {
+  Sampler &s = getSampler();
+  if (s.running)
+    return;
+  s.intervalUs = intervalUs ? intervalUs : 1;
+  s.running = true;
+  s.thread = std::thread(sample, stack, std::ref(depth));
+  enabled = true;
+}
+
+void Profiler::restartAfterFork() {
+  Sampler &s = getSampler();
+  if (!s.running)
+    return;
+
+  // The sampler thread does not exist in the child, and it may have held
+  // the lock at the time of the fork, possibly halfway through inserting
+  // into the samples. None of these objects can be used or even
+  // destroyed, so they are reinitialized in place. The nodes of the old
+  // samples are leaked; they are the parent's to report.
+  new (&s.lock) std::mutex();
+  new (&s.thread) std::thread();
+  new (&s.samples) std::map<std::vector<uint32_t>, uint64_t>();
+  s.thread = std::thread(sample, stack, std::ref(depth));
+}
+
+void Profiler::stop() {
+  Sampler &s = getSampler();
+  if (!s.running)
+    return;
+  s.running = false;
+  s.thread.join();
+  enabled = false;
+}
+
+void Profiler::write(llvm::raw_ostream &os) {
+  Sampler &s = getSampler();
+  std::lock_guard<std::mutex> guard(s.lock);
+  for (std::map<std::vector<uint32_t>, uint64_t>::iterator
+         it = s.samples.begin(), ie = s.samples.end(); it != ie; ++it) {
+    os << "klee";
+    for (std::vector<uint32_t>::const_iterator fi = it->first.begin(),
+           fe = it->first.end(); fi != fe; ++fi) {
+      unsigned phase = *fi & 0xff, detail = *fi >> 8;
+      os << ";" << (phase < NumPhases ? phaseNames[phase] : "?");
+      if (detail && detail < s.details.size())
+        os << ":" << s.details[detail];
+    }
+    os << " " << it->second << "\n";
+  }
+}
@@ -0,0 +1,104 @@
+//===-- Profiler.h ----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_PROFILER_H
+#define KLEE_PROFILER_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <atomic>
+#include <stdint.h>
+
+namespace llvm {
+  class raw_ostream;
+}
+
+namespace klee {
+  /// Sampling profiler attributing wall time to executor phases.
+  ///
+  /// The interpreter marks the phase it is in with ProfileScope objects,
+  /// which maintain a small stack of phases. A background thread samples
+  /// that stack at a fixed interval and counts how often each stack was
+  /// seen; the counts are written as folded stacks, as consumed by
+  /// flamegraph.pl. While disabled, a scope costs one flag test.
+  class Profiler {
+  public:
+    enum Phase {
+      Interpret,
+      Schedule,
+      Solver,
+      Resolve,
+      Fork,
+      ExternalCall,
+      SpecialFunction,
+      TestGeneration,
+      NumPhases
+    };
+
+    /// Deeper stacks are truncated.
+    static const unsigned MaxDepth = 16;
+
+  private:
+    static bool enabled;
+    static std::atomic<uint32_t> stack[MaxDepth];
+    static std::atomic<unsigned> depth;
+
+  public:
+    static bool isEnabled() { return enabled; }
+
+    /// Enter \a phase. \a detail, if non-zero, is an id obtained from
+    /// getDetail() naming what the phase is working on.
+    static void push(Phase phase, unsigned detail) {
+      unsigned d = depth.load(std::memory_order_relaxed);
+      if (d < MaxDepth)
+        stack[d].store(phase | (detail << 8), std::memory_order_relaxed);
+      depth.store(d + 1, std::memory_order_release);
+    }
+
+    static void pop() {
+      depth.store(depth.load(std::memory_order_relaxed) - 1,
+                  std::memory_order_release);
+    }
+
+    /// An id for \a name, to be passed as a push() detail. \a key
+    /// identifies the name so that it is only copied once.
+    static unsigned getDetail(const void *key, llvm::StringRef name);
+
+    /// Start sampling every \a intervalUs microseconds.
+    static void start(unsigned intervalUs);
+
+    /// Restart sampling in a forked child, which inherits no threads.
+    /// Samples taken before the fork are dropped: they are reported by
+    /// the parent.
+    static void restartAfterFork();
+
+    static void stop();
+
+    /// Write the samples taken so far as folded stacks.
+    static void write(llvm::raw_ostream &os);
+  };
+
+  /// Attributes the time until its destruction to a profiler phase.
+  class ProfileScope {
+    bool active;
+
+  public:
+    explicit ProfileScope(Profiler::Phase phase, unsigned detail = 0)
+      : active(Profiler::isEnabled()) {
+      if (active)
+        Profiler::push(phase, detail);
+    }
+    ~ProfileScope() {
+      if (active)
+        Profiler::pop();
+    }
+  };
+}
+
+#endif
@@ -25,6 +25,7 @@
 #include "klee/Internal/Support/ModuleUtil.h"
 #include "klee/Internal/System/Time.h"
 #include "klee/Internal/Support/ErrorHandling.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
@@ -53,6 +54,27 @@ Searcher::~Searcher() {
 
 ///
 
+void StateList::push_back(ExecutionState *es) {
+  positions[es] = states.insert(states.end(), es);
+}
+
+void StateList::remove(ExecutionState *es) {
+  std::unordered_map<ExecutionState *, list_ty::iterator>::iterator it =
+    positions.find(es);
+  assert(it != positions.end() && "invalid state removed");
+  states.erase(it->second);
+  positions.erase(it);
+}
+
+void StateList::moveToBack(ExecutionState *es) {
+  std::unordered_map<ExecutionState *, list_ty::iterator>::iterator it =
+    positions.find(es);
+  assert(it != positions.end() && "unknown state");
+  states.splice(states.end(), states, it->second);
+}
+
+///
+
 ExecutionState &DFSSearcher::selectState() {
   return *states.back();
 }
@@ -60,31 +82,14 @@ ExecutionState &DFSSearcher::selectState() {
 void DFSSearcher::update(ExecutionState *current,
                          const std::vector<ExecutionState *> &addedStates,
                          const std::vector<ExecutionState *> &removedStates) {
-  states.insert(states.end(),
-                addedStates.begin(),
-                addedStates.end());
+  for (std::vector<ExecutionState *>::const_iterator it = addedStates.begin(),
+                                                     ie = addedStates.end();
+       it != ie; ++it)
+    states.push_back(*it);
   for (std::vector<ExecutionState *>::const_iterator it = removedStates.begin(),
                                                      ie = removedStates.end();
-       it != ie; ++it) {
-    ExecutionState *es = *it;
-    if (es == states.back()) {
-      states.pop_back();
-    } else {
-      bool ok = false;
-
-      for (std::vector<ExecutionState*>::iterator it = states.begin(),
-             ie = states.end(); it != ie; ++it) {
-        if (es==*it) {
-          states.erase(it);
-          ok = true;
-          break;
-        }
-      }
-
-      (void) ok;
-      assert(ok && "invalid state removed");
-    }
-  }
+       it != ie; ++it)
+    states.remove(*it);
 }
 
 ///
@@ -100,38 +105,17 @@ void BFSSearcher::update(ExecutionState *current,
   // constraints were added to the current state, it evolved.
   if (!addedStates.empty() && current &&
       std::find(removedStates.begin(), removedStates.end(), current) ==
-          removedStates.end()) {
-    auto pos = std::find(states.begin(), states.end(), current);
-    assert(pos != states.end());
-    states.erase(pos);
-    states.push_back(current);
-  }
+          removedStates.end())
+    states.moveToBack(current);
 
-  states.insert(states.end(),
-                addedStates.begin(),
-                addedStates.end());
+  for (std::vector<ExecutionState *>::const_iterator it = addedStates.begin(),
+                                                     ie = addedStates.end();
+       it != ie; ++it)
+    states.push_back(*it);
   for (std::vector<ExecutionState *>::const_iterator it = removedStates.begin(),
                                                      ie = removedStates.end();
-       it != ie; ++it) {
-    ExecutionState *es = *it;
-    if (es == states.front()) {
-      states.pop_front();
-    } else {
-      bool ok = false;
-
-      for (std::deque<ExecutionState*>::iterator it = states.begin(),
-             ie = states.end(); it != ie; ++it) {
-        if (es==*it) {
-          states.erase(it);
-          ok = true;
-          break;
-        }
-      }
-
-      (void) ok;
-      assert(ok && "invalid state removed");
-    }
-  }
+       it != ie; ++it)
+    states.remove(*it);
 }
 
 ///
@@ -144,25 +128,24 @@ void
 RandomSearcher::update(ExecutionState *current,
                        const std::vector<ExecutionState *> &addedStates,
                        const std::vector<ExecutionState *> &removedStates) {
-  states.insert(states.end(),
-                addedStates.begin(),
-                addedStates.end());
+  for (std::vector<ExecutionState *>::const_iterator it = addedStates.begin(),
+                                                     ie = addedStates.end();
+       it != ie; ++it) {
+    positions[*it] = states.size();
+    states.push_back(*it);
+  }
   for (std::vector<ExecutionState *>::const_iterator it = removedStates.begin(),
                                                      ie = removedStates.end();
        it != ie; ++it) {
-    ExecutionState *es = *it;
-    bool ok = false;
-
-    for (std::vector<ExecutionState*>::iterator it = states.begin(),
-           ie = states.end(); it != ie; ++it) {
-      if (es==*it) {
-        states.erase(it);
-        ok = true;
-        break;
-      }
-    }
-    
-    assert(ok && "invalid state removed");
+    std::unordered_map<ExecutionState *, size_t>::iterator pos =
+      positions.find(*it);
+    assert(pos != positions.end() && "invalid state removed");
+
+    ExecutionState *last = states.back();
+    states[pos->second] = last;
+    positions[last] = pos->second;
+    states.pop_back();
+    positions.erase(pos);
   }
 }
 
@@ -299,6 +282,116 @@ bool RandomPathSearcher::empty() {
 
 ///
 
+bool CallPathNoveltySearcher::Entry::operator<(const Entry &b) const {
+  // Least seen first, then the state furthest along its call path, then
+  // the most recent one.
+  if (seen != b.seen)
+    return seen < b.seen;
+  if (length != b.length)
+    return length > b.length;
+  return order > b.order;
+}
+
+static uint64_t hashCallShape(const CallInfo &call) {
+  llvm::hash_code h = llvm::hash_combine(call.f, call.args.size());
+  for (std::vector<CallArg>::const_iterator it = call.args.begin(),
+         ie = call.args.end(); it != ie; ++it) {
+    const ref<Expr> &e = it->expr;
+    h = llvm::hash_combine(h, it->isPtr, it->funPtr,
+                           e.isNull() ? 0 : e->getWidth(),
+                           !e.isNull() && isa<klee::ConstantExpr>(e));
+    if (it->isPtr)
+      h = llvm::hash_combine(h, it->pointee.type);
+  }
+  return h;
+}
+
+bool CallPathNoveltySearcher::visit(ExecutionState *es, StateInfo &info) {
+  const ExecutionState::call_path_ty &callPath = es->callPath;
+  size_t length = callPath.size();
+  if (length == info.length && info.entry.es)
+    return false;
+  if (length < info.length) {
+    info.length = 0;
+    info.prefix = 0;
+  }
+
+  if (length) {
+    // Fold in the entries that got completed since the last visit, without
+    // walking the part of the path that is already in the prefix.
+    size_t i = info.length ? info.length - 1 : 0;
+    for (ExecutionState::call_path_ty::const_iterator it = callPath.from(i);
+         i + 1 < length; ++it, ++i)
+      info.prefix = llvm::hash_combine(info.prefix, hashCallShape(*it));
+    info.node = llvm::hash_combine(info.prefix, callPath.back().f);
+  } else {
+    info.node = 0;
+  }
+  info.length = length;
+  ++trie[info.node];
+  return true;
+}
+
+ExecutionState &CallPathNoveltySearcher::selectState() {
+  for (;;) {
+    Entry e = *queue.begin();
+    StateInfo &info = states[e.es];
+    unsigned seen = trie[info.node];
+    if (seen == e.seen)
+      return *e.es;
+
+    // Other states reached this node since it was queued.
+    queue.erase(queue.begin());
+    info.entry.seen = seen;
+    queue.insert(info.entry);
+  }
+}
+
+void CallPathNoveltySearcher::update(
+    ExecutionState *current, const std::vector<ExecutionState *> &addedStates,
+    const std::vector<ExecutionState *> &removedStates) {
+  if (current &&
+      std::find(removedStates.begin(), removedStates.end(), current) ==
+          removedStates.end()) {
+    std::unordered_map<ExecutionState *, StateInfo>::iterator it =
+      states.find(current);
+    if (it != states.end()) {
+      StateInfo &info = it->second;
+      if (visit(current, info)) {
+        queue.erase(info.entry);
+        info.entry.seen = trie[info.node];
+        info.entry.length = info.length;
+        queue.insert(info.entry);
+      }
+    }
+  }
+
+  for (std::vector<ExecutionState *>::const_iterator it = addedStates.begin(),
+         ie = addedStates.end(); it != ie; ++it) {
+    StateInfo &info = states[*it];
+    info.length = 0;
+    info.prefix = 0;
+    info.entry.es = 0;
+    visit(*it, info);
+    info.entry.seen = trie[info.node];
+    info.entry.length = info.length;
+    info.entry.order = nextOrder++;
+    info.entry.es = *it;
+    queue.insert(info.entry);
+  }
+
+  for (std::vector<ExecutionState *>::const_iterator it = removedStates.begin(),
+         ie = removedStates.end(); it != ie; ++it) {
+    std::unordered_map<ExecutionState *, StateInfo>::iterator si =
+      states.find(*it);
+    assert(si != states.end() && "invalid state removed");
+    queue.erase(si->second.entry);
+    states.erase(si);
+  }
+}
+
+///
+
 MergingSearcher::MergingSearcher(Executor &_executor, Searcher *_baseSearcher)
   : executor(_executor),
   baseSearcher(_baseSearcher){}
@@ -11,10 +11,14 @@
 #define KLEE_SEARCHER_H
 
 #include "llvm/Support/raw_ostream.h"
+#include <list>
 #include <vector>
 #include <set>
 #include <map>
 #include <queue>
+#include <unordered_map>
+
+#include <stdint.h>
 
 namespace llvm {
   class BasicBlock;
@@ -76,12 +80,31 @@ namespace klee {
       NURS_Depth,
       NURS_ICnt,
       NURS_CPICnt,
-      NURS_QC
+      NURS_QC,
+      CallPathNovelty
     };
   };
 
+  /// States in insertion order, with constant time insertion, removal
+  /// and lookup of any of them.
+  class StateList {
+    typedef std::list<ExecutionState *> list_ty;
+
+    list_ty states;
+    std::unordered_map<ExecutionState *, list_ty::iterator> positions;
+
+  public:
+    bool empty() const { return states.empty(); }
+    ExecutionState *front() const { return states.front(); }
+    ExecutionState *back() const { return states.back(); }
+
+    void push_back(ExecutionState *es);
+    void remove(ExecutionState *es);
+    void moveToBack(ExecutionState *es);
+  };
+
   class DFSSearcher : public Searcher {
-    std::vector<ExecutionState*> states;
+    StateList states;
 
   public:
     ExecutionState &selectState();
@@ -95,7 +118,7 @@ namespace klee {
   };
 
   class BFSSearcher : public Searcher {
-    std::deque<ExecutionState*> states;
+    StateList states;
 
   public:
     ExecutionState &selectState();
@@ -110,6 +133,9 @@ namespace klee {
 
   class RandomSearcher : public Searcher {
     std::vector<ExecutionState*> states;
+    /// Position of each state in states. Order does not matter here, so
+    /// a removal moves the last state into the hole.
+    std::unordered_map<ExecutionState *, size_t> positions;
 
   public:
     ExecutionState &selectState();
@@ -180,6 +206,59 @@ namespace klee {
     }
   };
 
+  /// Prefers states whose call path (the traced calls made so far, by
+  /// function and argument shape) has reached a prefix few other states
+  /// have reached, so that distinct call sequences are found before
+  /// states that repeat known ones.
+  ///
+  /// Prefixes form a hashed trie: a node is identified by the hash of its
+  /// parent and of the call it appends, and counts the states that got
+  /// there. The arguments of the last call may still be growing, so only
+  /// its function is part of a state's node until the next call starts.
+  class CallPathNoveltySearcher : public Searcher {
+    struct Entry {
+      /// Trie count of the state's node when it was queued.
+      unsigned seen;
+      size_t length;
+      uint64_t order;
+      ExecutionState *es;
+
+      bool operator<(const Entry &b) const;
+    };
+
+    struct StateInfo {
+      /// Number of call path entries accounted for.
+      size_t length;
+      /// Hash of the complete entries, i.e. all but the last one.
+      uint64_t prefix;
+      uint64_t node;
+      Entry entry;
+    };
+
+    std::unordered_map<uint64_t, unsigned> trie;
+    std::unordered_map<ExecutionState *, StateInfo> states;
+    /// Ordered by staleness-tolerant priority; selectState() refreshes
+    /// the counts of entries as they reach the front.
+    std::set<Entry> queue;
+    uint64_t nextOrder;
+
+    /// Move \a es to the trie node of its current call path. Returns
+    /// false if it did not change.
+    bool visit(ExecutionState *es, StateInfo &info);
+
+  public:
+    CallPathNoveltySearcher() : nextOrder(0) {}
+
+    ExecutionState &selectState();
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates);
+    bool empty() { return queue.empty(); }
+    void printName(llvm::raw_ostream &os) {
+      os << "CallPathNoveltySearcher\n";
+    }
+  };
+
   class MergeHandler;
   class MergingSearcher : public Searcher {
     friend class MergeHandler;
@@ -19,6 +19,7 @@ extern "C" {
 
 namespace klee {
   class ExecutionState;
+  class MemoryObject;
   class TimingSolver;
 
   class SeedInfo {
@@ -0,0 +1,62 @@
+//===-- SeedMap.cpp -------------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SeedMap.h"
+
+#include <cassert>
+
+using namespace klee;
+
+std::vector<SeedInfo> *SeedMap::find(ExecutionState *es) {
+  std::unordered_map<ExecutionState *, list_ty::iterator>::iterator it =
+    positions.find(es);
+  return it == positions.end() ? 0 : &it->second->seeds;
+}
+
+void SeedMap::addSeed(ExecutionState *es, const SeedInfo &seed) {
+  std::pair<std::unordered_map<ExecutionState *, list_ty::iterator>::iterator,
+            bool> res = positions.insert(std::make_pair(es, entries.end()));
+  if (res.second) {
+    // New states wait for the states already in this round.
+    entries.push_back(Entry(es));
+    res.first->second = --entries.end();
+  }
+  res.first->second->seeds.push_back(seed);
+  ++numSeeds;
+}
+
+void SeedMap::take(ExecutionState *es, std::vector<SeedInfo> &seeds) {
+  std::unordered_map<ExecutionState *, list_ty::iterator>::iterator it =
+    positions.find(es);
+  assert(it != positions.end() && "state is not seeded");
+  std::vector<SeedInfo> &own = it->second->seeds;
+  numSeeds -= own.size();
+  seeds.clear();
+  seeds.swap(own);
+  erase(es);
+}
+
+void SeedMap::erase(ExecutionState *es) {
+  std::unordered_map<ExecutionState *, list_ty::iterator>::iterator it =
+    positions.find(es);
+  if (it == positions.end())
+    return;
+  if (next == it->second)
+    ++next;
+  numSeeds -= it->second->seeds.size();
+  entries.erase(it->second);
+  positions.erase(it);
+}
+
+ExecutionState *SeedMap::selectState() {
+  assert(!entries.empty() && "no seeded state");
+  if (next == entries.end())
+    next = entries.begin();
+  return (next++)->state;
+}
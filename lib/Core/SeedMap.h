@@ -0,0 +1,69 @@
+//===-- SeedMap.h -----------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_SEEDMAP_H
+#define KLEE_SEEDMAP_H
+
+#include "SeedInfo.h"
+
+#include <list>
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+
+namespace klee {
+  class ExecutionState;
+
+  /// The seeds of the states executed in seed mode. The states are kept
+  /// in a ring, scheduled round-robin, and the total number of seeds is
+  /// kept up to date, so that no operation needs to visit every state.
+  ///
+  /// The seeds of a state may be changed in place through find(), but
+  /// seeds are only added and removed through SeedMap.
+  class SeedMap {
+    struct Entry {
+      ExecutionState *state;
+      std::vector<SeedInfo> seeds;
+
+      explicit Entry(ExecutionState *_state) : state(_state) {}
+    };
+    typedef std::list<Entry> list_ty;
+
+    list_ty entries;
+    std::unordered_map<ExecutionState *, list_ty::iterator> positions;
+    /// The entry selectState() returns next.
+    list_ty::iterator next;
+    size_t numSeeds;
+
+    SeedMap(const SeedMap &);
+    void operator=(const SeedMap &);
+
+  public:
+    SeedMap() : next(entries.end()), numSeeds(0) {}
+
+    bool empty() const { return entries.empty(); }
+    bool count(ExecutionState *es) const { return positions.count(es); }
+    size_t getNumStates() const { return entries.size(); }
+    size_t getNumSeeds() const { return numSeeds; }
+
+    /// The seeds of \a es, null if it is not seeded.
+    std::vector<SeedInfo> *find(ExecutionState *es);
+
+    /// Add a seed to \a es, which becomes seeded if it was not.
+    void addSeed(ExecutionState *es, const SeedInfo &seed);
+    /// Move the seeds of \a es to \a seeds; \a es is no longer seeded.
+    void take(ExecutionState *es, std::vector<SeedInfo> &seeds);
+    void erase(ExecutionState *es);
+
+    /// The next seeded state, round-robin. The map must not be empty.
+    ExecutionState *selectState();
+  };
+}
+
+#endif
@@ -9,6 +9,7 @@
 
 #include <llvm/IR/Instructions.h>
 #include "Memory.h"
+#include "Profiler.h"
 #include "SpecialFunctionHandler.h"
 #include "TimingSolver.h"
 #include "klee/MergeHandler.h"
@@ -273,6 +274,9 @@ bool SpecialFunctionHandler::handle(ExecutionState &state,
       executor.terminateStateOnExecError(state, 
                                          "expected return value from void special function");
     } else {
+      ProfileScope scope(Profiler::SpecialFunction,
+                         Profiler::isEnabled()
+                           ? Profiler::getDetail(f, f->getName()) : 0);
       (this->*h)(state, target, arguments);
     }
     return true;
@@ -812,6 +816,18 @@ void SpecialFunctionHandler::handleGetValue(ExecutionState &state,
   executor.executeGetValue(state, arguments[0], target);
 }
 
+Function *SpecialFunctionHandler::resolveInterceptor(const std::string &name) {
+  GlobalValue *gv = executor.kmodule->module->getNamedValue(name);
+  if (!gv) {
+    klee_error("Function %s(), interceptor, not found!\n", name.c_str());
+  }
+  Function *interceptFunc = dyn_cast<Function>(gv);
+  if (!interceptFunc) {
+    klee_error("Interceptor is not a function\n");
+  }
+  return interceptFunc;
+}
+
 void SpecialFunctionHandler::handleInterceptReads(ExecutionState &state,
                                                   KInstruction *target,
                                                   std::vector<ref<Expr> > &arguments) {
@@ -820,7 +836,7 @@ void SpecialFunctionHandler::handleInterceptReads(ExecutionState &state,
 
   uint64_t addr = cast<ConstantExpr>(arguments[0])->getZExtValue();
   std::string reader = readStringAtAddress(state, arguments[1]);
-  state.addReadsIntercept(addr, reader);
+  state.addReadsIntercept(addr, resolveInterceptor(reader));
 }
 
 void SpecialFunctionHandler::handleInterceptWrites(ExecutionState &state,
@@ -832,7 +848,7 @@ void SpecialFunctionHandler::handleInterceptWrites(ExecutionState &state,
   uint64_t addr = cast<ConstantExpr>(arguments[0])->getZExtValue();
   std::string writer = readStringAtAddress(state, arguments[1]);
 
-  state.addWritesIntercept(addr, writer);
+  state.addWritesIntercept(addr, resolveInterceptor(writer));
 }
 
 void SpecialFunctionHandler::handleDefineFixedObject(ExecutionState &state,
@@ -91,6 +91,7 @@ namespace klee {
     /* Convenience routines */
 
     std::string readStringAtAddress(ExecutionState &state, ref<Expr> address);
+    llvm::Function *resolveInterceptor(const std::string &name);
     
     /* Handlers */
 
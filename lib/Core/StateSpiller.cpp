@@ -0,0 +1,592 @@
+//===-- StateSpiller.cpp --------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "StateSpiller.h"
+
+#include "AddressSpace.h"
+#include "Memory.h"
+
+#include "klee/ExecutionState.h"
+#include "klee/Internal/ADT/PagedArray.h"
+#include "klee/Internal/Module/Cell.h"
+#include "klee/Internal/Module/KModule.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+
+#include "llvm/ADT/StringExtras.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace llvm;
+using namespace klee;
+
+namespace {
+  const uint32_t SpillMagic = 0x4b53504c; // "KSPL"
+
+  enum ExprTag { NullTag, RefTag, DefTag };
+}
+
+/// Writes the binary spill format. Every expression and update node is
+/// written once; later occurrences refer back to it by number, in the
+/// order the definitions were completed.
+class StateSpiller::Writer {
+  FILE *file;
+  std::unordered_map<const Expr *, unsigned> exprIds;
+  std::unordered_map<const UpdateNode *, unsigned> nodeIds;
+
+public:
+  explicit Writer(FILE *_file) : file(_file) {}
+
+  void write(const void *data, size_t size) { fwrite(data, 1, size, file); }
+  void writeU8(uint8_t v) { write(&v, sizeof v); }
+  void writeU32(uint32_t v) { write(&v, sizeof v); }
+  void writeU64(uint64_t v) { write(&v, sizeof v); }
+
+  void writeString(const std::string &s) {
+    writeU32(s.size());
+    write(s.data(), s.size());
+  }
+
+  void writeBits(const PagedBitArray *bits, unsigned size) {
+    std::vector<uint8_t> packed((size + 7) / 8, 0);
+    for (unsigned i = 0; i < size; ++i)
+      if (bits->get(i))
+        packed[i / 8] |= 1 << (i % 8);
+    write(packed.data(), packed.size());
+  }
+
+  void writeExpr(const ref<Expr> &e);
+  void writeUpdates(const UpdateList &updates);
+};
+
+void StateSpiller::Writer::writeExpr(const ref<Expr> &e) {
+  if (e.isNull()) {
+    writeU8(NullTag);
+    return;
+  }
+  std::unordered_map<const Expr *, unsigned>::iterator it =
+    exprIds.find(e.get());
+  if (it != exprIds.end()) {
+    writeU8(RefTag);
+    writeU32(it->second);
+    return;
+  }
+
+  writeU8(DefTag);
+  writeU8(e->getKind());
+  switch (e->getKind()) {
+  case Expr::Constant: {
+    const APInt &v = cast<ConstantExpr>(e)->getAPValue();
+    writeU32(v.getBitWidth());
+    write(v.getRawData(), v.getNumWords() * sizeof(uint64_t));
+    break;
+  }
+  case Expr::Read: {
+    const ReadExpr *re = cast<ReadExpr>(e);
+    writeUpdates(re->updates);
+    writeExpr(re->index);
+    break;
+  }
+  case Expr::Extract: {
+    const ExtractExpr *ee = cast<ExtractExpr>(e);
+    writeU32(ee->offset);
+    writeU32(ee->width);
+    writeExpr(ee->expr);
+    break;
+  }
+  case Expr::ZExt:
+  case Expr::SExt: {
+    const CastExpr *ce = cast<CastExpr>(e);
+    writeU32(ce->width);
+    writeExpr(ce->src);
+    break;
+  }
+  default:
+    writeU8(e->getNumKids());
+    for (unsigned i = 0; i < e->getNumKids(); ++i)
+      writeExpr(e->getKid(i));
+  }
+
+  unsigned id = exprIds.size();
+  exprIds[e.get()] = id;
+}
+
+void StateSpiller::Writer::writeUpdates(const UpdateList &updates) {
+  writeU64(reinterpret_cast<uintptr_t>(updates.root));
+
+  // Collect the nodes not written yet, newest first. The rest of the list
+  // is shared with an update list we already wrote.
+  std::vector<const UpdateNode *> fresh;
+  const UpdateNode *un = updates.head;
+  for (; un && !nodeIds.count(un); un = un->next)
+    fresh.push_back(un);
+  writeU32(un ? nodeIds[un] + 1 : 0);
+
+  writeU32(fresh.size());
+  for (std::vector<const UpdateNode *>::reverse_iterator
+         it = fresh.rbegin(), ie = fresh.rend(); it != ie; ++it) {
+    writeExpr((*it)->index);
+    writeExpr((*it)->value);
+    unsigned id = nodeIds.size();
+    nodeIds[*it] = id;
+  }
+}
+
+/// Reads what Writer wrote. Any inconsistency sets the failed flag, after
+/// which only null expressions are returned.
+class StateSpiller::Reader {
+  FILE *file;
+  bool failed;
+  std::vector<ref<Expr> > exprs;
+  std::vector<UpdateList> nodes;
+
+public:
+  explicit Reader(FILE *_file) : file(_file), failed(false) {}
+
+  bool hasFailed() const { return failed; }
+  void fail() { failed = true; }
+
+  void read(void *data, size_t size) {
+    if (!failed && fread(data, 1, size, file) != size)
+      failed = true;
+  }
+  uint8_t readU8() { uint8_t v = 0; read(&v, sizeof v); return v; }
+  uint32_t readU32() { uint32_t v = 0; read(&v, sizeof v); return v; }
+  uint64_t readU64() { uint64_t v = 0; read(&v, sizeof v); return v; }
+
+  std::string readString() {
+    uint32_t size = readU32();
+    if (failed || size > (1U << 20)) {
+      failed = true;
+      return std::string();
+    }
+    std::string s(size, '\0');
+    read(&s[0], size);
+    return s;
+  }
+
+  PagedBitArray *readBits(unsigned size) {
+    std::vector<uint8_t> packed((size + 7) / 8, 0);
+    read(packed.data(), packed.size());
+    PagedBitArray *bits = new PagedBitArray(size);
+    for (unsigned i = 0; i < size; ++i)
+      if (packed[i / 8] & (1 << (i % 8)))
+        bits->set(i);
+    return bits;
+  }
+
+  ref<Expr> readExpr();
+  UpdateList readUpdates();
+};
+
+ref<Expr> StateSpiller::Reader::readExpr() {
+  uint8_t tag = readU8();
+  if (failed || tag == NullTag)
+    return ref<Expr>();
+  if (tag == RefTag) {
+    uint32_t id = readU32();
+    if (failed || id >= exprs.size()) {
+      failed = true;
+      return ref<Expr>();
+    }
+    return exprs[id];
+  }
+  if (tag != DefTag) {
+    failed = true;
+    return ref<Expr>();
+  }
+
+  Expr::Kind kind = (Expr::Kind) readU8();
+  ref<Expr> e;
+  switch (kind) {
+  case Expr::Constant: {
+    uint32_t width = readU32();
+    if (failed || !width) {
+      failed = true;
+      return ref<Expr>();
+    }
+    std::vector<uint64_t> words((width + 63) / 64);
+    read(words.data(), words.size() * sizeof(uint64_t));
+    e = ConstantExpr::alloc(APInt(width, words));
+    break;
+  }
+  case Expr::Read: {
+    UpdateList updates = readUpdates();
+    ref<Expr> index = readExpr();
+    if (failed)
+      return ref<Expr>();
+    e = ReadExpr::alloc(updates, index);
+    break;
+  }
+  case Expr::Extract: {
+    uint32_t offset = readU32();
+    uint32_t width = readU32();
+    ref<Expr> kid = readExpr();
+    if (failed)
+      return ref<Expr>();
+    e = ExtractExpr::alloc(kid, offset, width);
+    break;
+  }
+  case Expr::ZExt:
+  case Expr::SExt: {
+    uint32_t width = readU32();
+    ref<Expr> kid = readExpr();
+    if (failed)
+      return ref<Expr>();
+    e = kind == Expr::ZExt ? ZExtExpr::alloc(kid, width)
+                           : SExtExpr::alloc(kid, width);
+    break;
+  }
+  default: {
+    unsigned numKids = readU8();
+    ref<Expr> kids[3];
+    if (numKids > 3)
+      failed = true;
+    for (unsigned i = 0; i < numKids && !failed; ++i)
+      kids[i] = readExpr();
+    if (failed)
+      return ref<Expr>();
+
+    switch (kind) {
+    case Expr::NotOptimized: e = NotOptimizedExpr::alloc(kids[0]); break;
+    case Expr::Select: e = SelectExpr::alloc(kids[0], kids[1], kids[2]); break;
+    case Expr::Concat: e = ConcatExpr::alloc(kids[0], kids[1]); break;
+    case Expr::Not: e = NotExpr::alloc(kids[0]); break;
+#define BINARY_EXPR_CASE(T)                                                    \
+    case Expr::T: e = T##Expr::alloc(kids[0], kids[1]); break;
+    BINARY_EXPR_CASE(Add)
+    BINARY_EXPR_CASE(Sub)
+    BINARY_EXPR_CASE(Mul)
+    BINARY_EXPR_CASE(UDiv)
+    BINARY_EXPR_CASE(SDiv)
+    BINARY_EXPR_CASE(URem)
+    BINARY_EXPR_CASE(SRem)
+    BINARY_EXPR_CASE(And)
+    BINARY_EXPR_CASE(Or)
+    BINARY_EXPR_CASE(Xor)
+    BINARY_EXPR_CASE(Shl)
+    BINARY_EXPR_CASE(LShr)
+    BINARY_EXPR_CASE(AShr)
+    BINARY_EXPR_CASE(Eq)
+    BINARY_EXPR_CASE(Ne)
+    BINARY_EXPR_CASE(Ult)
+    BINARY_EXPR_CASE(Ule)
+    BINARY_EXPR_CASE(Ugt)
+    BINARY_EXPR_CASE(Uge)
+    BINARY_EXPR_CASE(Slt)
+    BINARY_EXPR_CASE(Sle)
+    BINARY_EXPR_CASE(Sgt)
+    BINARY_EXPR_CASE(Sge)
+#undef BINARY_EXPR_CASE
+    default:
+      failed = true;
+      return ref<Expr>();
+    }
+  }
+  }
+
+  exprs.push_back(e);
+  return e;
+}
+
+UpdateList StateSpiller::Reader::readUpdates() {
+  const Array *root = reinterpret_cast<const Array *>(readU64());
+  uint32_t tail = readU32();
+  uint32_t count = readU32();
+  if (tail > nodes.size())
+    failed = true;
+
+  UpdateList updates(root, !failed && tail ? nodes[tail - 1].head : 0);
+  for (unsigned i = 0; i < count && !failed; ++i) {
+    ref<Expr> index = readExpr();
+    ref<Expr> value = readExpr();
+    if (failed)
+      break;
+    updates.extend(index, value);
+    nodes.push_back(updates);
+  }
+  return updates;
+}
+
+/***/
+
+StateSpiller::StateSpiller(const std::string &_directory)
+  : directory(_directory), directoryCreated(false), nextId(0),
+    lastTouched(0), clock(0) {}
+
+StateSpiller::~StateSpiller() {
+  for (std::map<const ExecutionState *, Record>::iterator
+         it = records.begin(), ie = records.end(); it != ie; ++it) {
+    if (it->second.owner == getpid())
+      unlink(it->second.path.c_str());
+    release(it->second);
+  }
+  // Fails if another process still has files in there, which is fine.
+  if (directoryCreated)
+    rmdir(directory.c_str());
+}
+
+void StateSpiller::release(Record &record) {
+  for (std::vector<const MemoryObject *>::iterator
+         it = record.objects.begin(), ie = record.objects.end(); it != ie;
+       ++it) {
+    const MemoryObject *mo = *it;
+    assert(mo->refCount > 0);
+    if (--mo->refCount == 0)
+      delete mo;
+  }
+  record.objects.clear();
+}
+
+void StateSpiller::sortByColdness(std::vector<ExecutionState *> &states)
+    const {
+  std::vector<std::pair<uint64_t, ExecutionState *> > order;
+  order.reserve(states.size());
+  for (std::vector<ExecutionState *>::iterator it = states.begin(),
+         ie = states.end(); it != ie; ++it) {
+    std::unordered_map<const ExecutionState *, uint64_t>::const_iterator
+      lr = lastRun.find(*it);
+    order.push_back(std::make_pair(lr == lastRun.end() ? 0 : lr->second,
+                                   *it));
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [](const std::pair<uint64_t, ExecutionState *> &a,
+                      const std::pair<uint64_t, ExecutionState *> &b) {
+                     return a.first < b.first;
+                   });
+  for (unsigned i = 0; i < order.size(); ++i)
+    states[i] = order[i].second;
+}
+
+void StateSpiller::writeObject(Writer &w, const ObjectState *os) {
+  w.writeU32(os->size);
+  w.writeU8(os->readOnly);
+  w.writeU8(os->accessible);
+  w.writeString(os->inaccessible_message);
+  std::vector<uint8_t> store(os->size);
+  os->concreteStore.copyTo(store.data());
+  w.write(store.data(), store.size());
+  w.writeU8(os->concreteMask != 0);
+  if (os->concreteMask)
+    w.writeBits(os->concreteMask, os->size);
+  w.writeU8(os->flushMask != 0);
+  if (os->flushMask)
+    w.writeBits(os->flushMask, os->size);
+  for (unsigned i = 0; i < os->size; ++i)
+    w.writeExpr(os->knownSymbolics.get(i));
+  w.writeUpdates(os->updates);
+}
+
+ObjectState *StateSpiller::readObject(Reader &r, const MemoryObject *mo) {
+  uint32_t size = r.readU32();
+  if (r.hasFailed() || size != mo->size) {
+    r.fail();
+    return 0;
+  }
+
+  ObjectState *os = new ObjectState(mo);
+  os->readOnly = r.readU8();
+  os->accessible = r.readU8();
+  os->inaccessible_message = r.readString();
+  std::vector<uint8_t> store(size);
+  r.read(store.data(), size);
+  os->concreteStore.copyFrom(store.data());
+  if (r.readU8())
+    os->concreteMask = r.readBits(size);
+  if (r.readU8())
+    os->flushMask = r.readBits(size);
+  for (unsigned i = 0; i < size; ++i) {
+    ref<Expr> e = r.readExpr();
+    if (!e.isNull())
+      os->knownSymbolics.set(i, e);
+  }
+  os->updates = r.readUpdates();
+  return os;
+}
+
+bool StateSpiller::spill(ExecutionState &es) {
+  assert(!isSpilled(&es) && "state is already spilled");
+
+  if (!directoryCreated) {
+    if (mkdir(directory.c_str(), 0775) < 0 && errno != EEXIST) {
+      klee_warning("unable to create spill directory %s: %s",
+                   directory.c_str(), strerror(errno));
+      return false;
+    }
+    directoryCreated = true;
+  }
+
+  Record record;
+  record.owner = getpid();
+  record.path = directory + "/" + utostr(record.owner) + "-" +
+                utostr(nextId++) + ".state";
+  FILE *f = fopen(record.path.c_str(), "wb");
+  if (!f) {
+    klee_warning("unable to write spill file %s: %s", record.path.c_str(),
+                 strerror(errno));
+    return false;
+  }
+
+  std::vector<std::pair<const MemoryObject *, const ObjectState *> > owned;
+  for (MemoryMap::iterator it = es.addressSpace.objects.begin(),
+         ie = es.addressSpace.objects.end(); it != ie; ++it)
+    if (es.addressSpace.isOwned(it->second))
+      owned.push_back(std::make_pair(it->first, it->second));
+
+  {
+    Writer w(f);
+    w.writeU32(SpillMagic);
+
+    w.writeU32(es.constraints.size());
+    for (ConstraintManager::constraint_iterator it = es.constraints.begin(),
+           ie = es.constraints.end(); it != ie; ++it)
+      w.writeExpr(*it);
+
+    for (unsigned i = 0; i < es.stack.size(); ++i) {
+      const StackFrame &sf = es.stack[i];
+      // Registers shared with another state stay in memory anyway.
+      if (sf.locals.isShared())
+        continue;
+      for (unsigned reg = 0; reg < sf.kf->numRegisters; ++reg) {
+        const ref<Expr> &value = sf.locals[reg].getValue();
+        if (value.isNull())
+          continue;
+        w.writeU8(1);
+        w.writeU32(i);
+        w.writeU32(reg);
+        w.writeExpr(value);
+      }
+    }
+    w.writeU8(0);
+
+    w.writeU32(owned.size());
+    for (unsigned i = 0; i < owned.size(); ++i)
+      writeObject(w, owned[i].second);
+  }
+
+  bool ok = !ferror(f);
+  if (fclose(f) != 0)
+    ok = false;
+  if (!ok) {
+    klee_warning("unable to write spill file %s", record.path.c_str());
+    unlink(record.path.c_str());
+    return false;
+  }
+
+  es.constraints = ConstraintManager();
+  for (unsigned i = 0; i < es.stack.size(); ++i) {
+    StackFrame &sf = es.stack[i];
+    if (sf.locals.isShared())
+      continue;
+    Cell *cells = sf.locals.getWriteable(es.frameArena);
+    for (unsigned reg = 0; reg < sf.kf->numRegisters; ++reg)
+      cells[reg] = Cell();
+  }
+  for (unsigned i = 0; i < owned.size(); ++i) {
+    const MemoryObject *mo = owned[i].first;
+    ++mo->refCount;
+    record.objects.push_back(mo);
+    es.addressSpace.unbindObject(mo);
+  }
+
+  records[&es] = record;
+  return true;
+}
+
+bool StateSpiller::restore(ExecutionState &es) {
+  std::map<const ExecutionState *, Record>::iterator it = records.find(&es);
+  assert(it != records.end() && "state is not spilled");
+  Record &record = it->second;
+
+  FILE *f = fopen(record.path.c_str(), "rb");
+  if (!f) {
+    klee_warning("unable to read spill file %s: %s", record.path.c_str(),
+                 strerror(errno));
+    return false;
+  }
+
+  // Read everything before touching the state, so that a bad file leaves
+  // it as it was.
+  std::vector<ref<Expr> > constraints;
+  std::vector<std::pair<std::pair<unsigned, unsigned>, ref<Expr> > > locals;
+  std::vector<ObjectState *> objects;
+  bool ok;
+  {
+    Reader r(f);
+    if (r.readU32() != SpillMagic)
+      r.fail();
+
+    uint32_t numConstraints = r.readU32();
+    for (unsigned i = 0; i < numConstraints && !r.hasFailed(); ++i)
+      constraints.push_back(r.readExpr());
+
+    while (!r.hasFailed() && r.readU8()) {
+      uint32_t frame = r.readU32();
+      uint32_t reg = r.readU32();
+      if (frame >= es.stack.size() ||
+          reg >= es.stack[frame].kf->numRegisters) {
+        r.fail();
+        break;
+      }
+      locals.push_back(std::make_pair(std::make_pair(frame, reg),
+                                      r.readExpr()));
+    }
+
+    uint32_t numObjects = r.readU32();
+    if (numObjects != record.objects.size())
+      r.fail();
+    for (unsigned i = 0; i < numObjects && !r.hasFailed(); ++i)
+      if (ObjectState *os = readObject(r, record.objects[i]))
+        objects.push_back(os);
+
+    ok = !r.hasFailed();
+  }
+  fclose(f);
+
+  if (!ok) {
+    klee_warning("corrupt spill file %s", record.path.c_str());
+    for (unsigned i = 0; i < objects.size(); ++i)
+      delete objects[i];
+    return false;
+  }
+
+  // The constraint factors are not written out: they are rebuilt on the
+  // state's next query, in one pass over the reads, rather than kept in
+  // memory for a state that may stay on disk for a long time.
+  es.constraints = ConstraintManager(constraints);
+  for (unsigned i = 0; i < locals.size(); ++i)
+    es.stack[locals[i].first.first].locals.getWriteable(es.frameArena)
+      [locals[i].first.second].setValue(locals[i].second);
+  for (unsigned i = 0; i < objects.size(); ++i)
+    es.addressSpace.bindObject(record.objects[i], objects[i]);
+
+  unlink(record.path.c_str());
+  release(record);
+  records.erase(it);
+  return true;
+}
+
+void StateSpiller::discard(const ExecutionState &es) {
+  lastRun.erase(&es);
+  if (lastTouched == &es)
+    lastTouched = 0;
+
+  std::map<const ExecutionState *, Record>::iterator it = records.find(&es);
+  if (it == records.end())
+    return;
+  if (it->second.owner == getpid())
+    unlink(it->second.path.c_str());
+  release(it->second);
+  records.erase(it);
+}
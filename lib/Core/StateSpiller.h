@@ -0,0 +1,98 @@
+//===-- StateSpiller.h ------------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef KLEE_STATESPILLER_H
+#define KLEE_STATESPILLER_H
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+namespace klee {
+  class ExecutionState;
+  class MemoryObject;
+  class ObjectState;
+
+  /// Moves the bulk of suspended states to disk and back.
+  ///
+  /// A spilled state keeps its identity (searcher, process tree and state
+  /// set entries stay valid) and everything that is cheap or shared with
+  /// other states: the stack frames, the call path, the symbolics. Its
+  /// constraints, register contents and the objects it owns exclusively in
+  /// its address space (those written since it was last forked) are
+  /// written to a file and released. Expressions are written in a form only
+  /// valid in this process: arrays are referenced by address, as they
+  /// outlive every state. The constraint factors are dropped with the
+  /// constraints and rebuilt lazily after a restore.
+  class StateSpiller {
+    class Writer;
+    class Reader;
+
+    struct Record {
+      std::string path;
+      /// Owned objects that were unbound from the address space. We hold a
+      /// reference on each so that they survive until the state is back.
+      std::vector<const MemoryObject *> objects;
+      /// Process that wrote the file. A process forked by
+      /// --parallel-workers inherits the records but must not remove
+      /// files it does not own when it drops the corresponding states.
+      pid_t owner;
+    };
+
+    std::string directory;
+    bool directoryCreated;
+    unsigned nextId;
+    std::map<const ExecutionState *, Record> records;
+
+    std::unordered_map<const ExecutionState *, uint64_t> lastRun;
+    const ExecutionState *lastTouched;
+    uint64_t clock;
+
+    void release(Record &record);
+    void writeObject(Writer &w, const ObjectState *os);
+    ObjectState *readObject(Reader &r, const MemoryObject *mo);
+
+  public:
+    StateSpiller(const std::string &_directory);
+    ~StateSpiller();
+
+    bool isSpilled(const ExecutionState *es) const {
+      return !records.empty() && records.count(es);
+    }
+    unsigned getNumSpilled() const { return records.size(); }
+
+    /// Note that \a es was scheduled, for sortByColdness().
+    void touch(const ExecutionState *es) {
+      if (es != lastTouched) {
+        lastTouched = es;
+        lastRun[es] = ++clock;
+      }
+    }
+
+    /// Sort \a states so that the least recently scheduled come first.
+    void sortByColdness(std::vector<ExecutionState *> &states) const;
+
+    /// Write \a es to disk and drop its spillable parts from memory.
+    /// Returns false (leaving the state untouched) on I/O failure.
+    bool spill(ExecutionState &es);
+
+    /// Bring a spilled state back. Returns false if its file could not be
+    /// read; the state is then still spilled and should be discarded.
+    bool restore(ExecutionState &es);
+
+    /// Forget everything about \a es, which is about to be deleted.
+    void discard(const ExecutionState &es);
+  };
+}
+
+#endif
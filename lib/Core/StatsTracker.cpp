@@ -18,6 +18,7 @@
 #include "klee/Internal/Support/ModuleUtil.h"
 #include "klee/Internal/System/MemoryUsage.h"
 #include "klee/Internal/System/Time.h"
+#include "klee/Internal/Support/BinaryStats.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "klee/SolverStats.h"
 
@@ -66,6 +67,11 @@ namespace {
               cl::init(true),
 	      cl::desc("Write running stats trace file (default=on)"));
 
+  cl::opt<bool>
+  OutputBinaryStats("output-binary-stats",
+                    cl::init(false),
+                    cl::desc("Write the stats trace in binary form, to run.stats.bin instead of run.stats (default=off)"));
+
   cl::opt<bool>
   OutputIStats("output-istats",
 	       cl::init(true),
@@ -243,7 +249,7 @@ StatsTracker::StatsTracker(Executor &_executor, std::string _objectFilename,
   }
 
   if (OutputStats) {
-    statsFile = executor.interpreterHandler->openOutputFile("run.stats");
+    statsFile = executor.interpreterHandler->openOutputFile(getStatsFilename());
     assert(statsFile && "unable to open statistics trace file");
     writeStatsHeader();
     writeStatsLine();
@@ -283,6 +289,29 @@ void StatsTracker::done() {
   }
 }
 
+void StatsTracker::flushOutputs() {
+  if (statsFile)
+    statsFile->flush();
+  if (istatsFile)
+    istatsFile->flush();
+}
+
+void StatsTracker::reopenOutputs() {
+  if (statsFile) {
+    delete statsFile;
+    statsFile = executor.interpreterHandler->openOutputFile(getStatsFilename());
+    assert(statsFile && "unable to open statistics trace file");
+    writeStatsHeader();
+    writeStatsLine();
+  }
+
+  if (istatsFile) {
+    delete istatsFile;
+    istatsFile = executor.interpreterHandler->openOutputFile("run.istats");
+    assert(istatsFile && "unable to open istats file");
+  }
+}
+
 void StatsTracker::stepInstruction(ExecutionState &es) {
   if (OutputIStats) {
     if (TrackInstructionTime) {
@@ -397,31 +426,52 @@ void StatsTracker::markBranchVisited(ExecutionState *visitedTrue,
   }
 }
 
-void StatsTracker::writeStatsHeader() {
-  *statsFile << "('Instructions',"
-             << "'FullBranches',"
-             << "'PartialBranches',"
-             << "'NumBranches',"
-             << "'UserTime',"
-             << "'NumStates',"
-             << "'MallocUsage',"
-             << "'NumQueries',"
-             << "'NumQueryConstructs',"
-             << "'NumObjects',"
-             << "'WallTime',"
-             << "'CoveredInstructions',"
-             << "'UncoveredInstructions',"
-             << "'QueryTime',"
-             << "'SolverTime',"
-             << "'CexCacheTime',"
-             << "'ForkTime',"
-             << "'ResolveTime',"
-             << "'QueryCexCacheMisses',"
-             << "'QueryCexCacheHits',"
+const char *StatsTracker::getStatsFilename() {
+  return OutputBinaryStats ? "run.stats.bin" : "run.stats";
+}
+
+void StatsTracker::getStatsRecord(StatsRecord &record) {
+  record.addInteger("Instructions", stats::instructions);
+  record.addInteger("FullBranches", fullBranches);
+  record.addInteger("PartialBranches", partialBranches);
+  record.addInteger("NumBranches", numBranches);
+  record.addReal("UserTime", util::getUserTime());
+  record.addInteger("NumStates", executor.states.size());
+  record.addInteger("MallocUsage",
+                    util::GetTotalMallocUsage() +
+                      executor.memory->getUsedDeterministicSize());
+  record.addInteger("NumQueries", stats::queries);
+  record.addInteger("NumQueryConstructs", stats::queryConstructs);
+  record.addInteger("NumObjects", 0); // was numObjects
+  record.addReal("WallTime", elapsed());
+  record.addInteger("CoveredInstructions", stats::coveredInstructions);
+  record.addInteger("UncoveredInstructions", stats::uncoveredInstructions);
+  record.addReal("QueryTime", stats::queryTime / 1000000.);
+  record.addReal("SolverTime", stats::solverTime / 1000000.);
+  record.addReal("CexCacheTime", stats::cexCacheTime / 1000000.);
+  record.addReal("ForkTime", stats::forkTime / 1000000.);
+  record.addReal("ResolveTime", stats::resolveTime / 1000000.);
+  record.addInteger("QueryCexCacheMisses", stats::queryCexCacheMisses);
+  record.addInteger("QueryCexCacheHits", stats::queryCexCacheHits);
+  record.addInteger("LoopEntrySnapshots", stats::loopEntrySnapshots);
+  record.addInteger("LoopEntrySnapshotsDiscarded",
+                    stats::loopEntrySnapshotsDiscarded);
+  record.addInteger("FrameAllocations", stats::frameAllocations);
+  record.addInteger("FrameCopies", stats::frameCopies);
+  record.addInteger("FrameArenaChunks", stats::frameArenaChunks);
+  record.addInteger("FrameArenaBytes", stats::frameArenaBytes);
 #ifdef KLEE_ARRAY_DEBUG
-	     << "'ArrayHashTime',"
+  record.addReal("ArrayHashTime", stats::arrayHashTime / 1000000.);
 #endif
-             << ")\n";
+}
+
+void StatsTracker::writeStatsHeader() {
+  StatsRecord record;
+  getStatsRecord(record);
+  if (OutputBinaryStats)
+    binary_stats::writeHeader(*statsFile, record);
+  else
+    record.printHeader(*statsFile);
   statsFile->flush();
 }
 
@@ -430,30 +480,12 @@ double StatsTracker::elapsed() {
 }
 
 void StatsTracker::writeStatsLine() {
-  *statsFile << "(" << stats::instructions
-             << "," << fullBranches
-             << "," << partialBranches
-             << "," << numBranches
-             << "," << util::getUserTime()
-             << "," << executor.states.size()
-             << "," << util::GetTotalMallocUsage() + executor.memory->getUsedDeterministicSize()
-             << "," << stats::queries
-             << "," << stats::queryConstructs
-             << "," << 0 // was numObjects
-             << "," << elapsed()
-             << "," << stats::coveredInstructions
-             << "," << stats::uncoveredInstructions
-             << "," << stats::queryTime / 1000000.
-             << "," << stats::solverTime / 1000000.
-             << "," << stats::cexCacheTime / 1000000.
-             << "," << stats::forkTime / 1000000.
-             << "," << stats::resolveTime / 1000000.
-             << "," << stats::queryCexCacheMisses
-             << "," << stats::queryCexCacheHits
-#ifdef KLEE_ARRAY_DEBUG
-             << "," << stats::arrayHashTime / 1000000.
-#endif
-             << ")\n";
+  StatsRecord record;
+  getStatsRecord(record);
+  if (OutputBinaryStats)
+    binary_stats::writeRecord(*statsFile, record);
+  else
+    record.print(*statsFile);
   statsFile->flush();
 }
 
@@ -28,6 +28,7 @@ namespace klee {
   class InterpreterHandler;
   struct KInstruction;
   struct StackFrame;
+  class StatsRecord;
 
   class StatsTracker {
     friend class WriteStatsTimer;
@@ -52,6 +53,9 @@ namespace klee {
 
   private:
     void updateStateStatistics(uint64_t addend);
+    static const char *getStatsFilename();
+    /// The current values of the run.stats columns.
+    void getStatsRecord(StatsRecord &record);
     void writeStatsHeader();
     void writeStatsLine();
     void writeIStats();
@@ -76,6 +80,15 @@ namespace klee {
     // called when execution is done and stats files should be flushed
     void done();
 
+    // write out buffered stats, so that a process forked afterwards does
+    // not write them again when it closes its copy of the files
+    void flushOutputs();
+
+    // reopen the stats files through the interpreter handler, e.g. after
+    // it switched to another output directory. The inherited files are
+    // closed, so flushOutputs() must have been called before forking.
+    void reopenOutputs();
+
     // process stats for a single instruction step, es is the state
     // about to be stepped
     void stepInstruction(ExecutionState &es);
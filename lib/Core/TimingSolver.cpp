@@ -16,6 +16,7 @@
 #include "klee/TimerStatIncrementer.h"
 
 #include "CoreStats.h"
+#include "Profiler.h"
 
 using namespace klee;
 using namespace llvm;
@@ -31,6 +32,7 @@ bool TimingSolver::evaluate(const ExecutionState& state, ref<Expr> expr,
   }
 
   TimerStatIncrementer timer(stats::solverTime);
+  ProfileScope scope(Profiler::Solver);
 
   if (simplifyExprs)
     expr = state.constraints.simplifyExpr(expr);
@@ -51,6 +53,7 @@ bool TimingSolver::mustBeTrue(const ExecutionState& state, ref<Expr> expr,
   }
 
   TimerStatIncrementer timer(stats::solverTime);
+  ProfileScope scope(Profiler::Solver);
 
   if (simplifyExprs)
     expr = state.constraints.simplifyExpr(expr);
@@ -94,6 +97,7 @@ bool TimingSolver::getValue(const ExecutionState& state, ref<Expr> expr,
   }
   
   TimerStatIncrementer timer(stats::solverTime);
+  ProfileScope scope(Profiler::Solver);
 
   if (simplifyExprs)
     expr = state.constraints.simplifyExpr(expr);
@@ -115,6 +119,7 @@ TimingSolver::getInitialValues(const ExecutionState& state,
     return true;
 
   TimerStatIncrementer timer(stats::solverTime);
+  ProfileScope scope(Profiler::Solver);
 
   bool success = solver->getInitialValues(Query(state.constraints,
                                                 ConstantExpr::alloc(0, Expr::Bool)), 
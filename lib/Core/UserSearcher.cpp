@@ -34,7 +34,8 @@ namespace {
 			clEnumValN(Searcher::NURS_Depth, "nurs:depth", "use NURS with 2^depth"),
 			clEnumValN(Searcher::NURS_ICnt, "nurs:icnt", "use NURS with Instr-Count"),
 			clEnumValN(Searcher::NURS_CPICnt, "nurs:cpicnt", "use NURS with CallPath-Instr-Count"),
-			clEnumValN(Searcher::NURS_QC, "nurs:qc", "use NURS with Query-Cost")
+			clEnumValN(Searcher::NURS_QC, "nurs:qc", "use NURS with Query-Cost"),
+			clEnumValN(Searcher::CallPathNovelty, "call-path-novelty", "prefer states whose sequence of traced calls has been seen least often")
 			KLEE_LLVM_CL_VAL_END));
 
   cl::opt<bool>
@@ -80,6 +81,12 @@ bool klee::userSearcherRequiresMD2U() {
 	  std::find(CoreSearch.begin(), CoreSearch.end(), Searcher::NURS_QC) != CoreSearch.end());
 }
 
+bool klee::userSearcherDependsOnTime() {
+  return UseBatchingSearch || UseIterativeDeepeningTimeSearch ||
+         std::find(CoreSearch.begin(), CoreSearch.end(), Searcher::NURS_QC) !=
+             CoreSearch.end();
+}
+
 
 Searcher *getNewSearcher(Searcher::CoreSearchType type, Executor &executor) {
   Searcher *searcher = NULL;
@@ -94,6 +101,7 @@ Searcher *getNewSearcher(Searcher::CoreSearchType type, Executor &executor) {
   case Searcher::NURS_ICnt: searcher = new WeightedRandomSearcher(WeightedRandomSearcher::InstCount); break;
   case Searcher::NURS_CPICnt: searcher = new WeightedRandomSearcher(WeightedRandomSearcher::CPInstCount); break;
   case Searcher::NURS_QC: searcher = new WeightedRandomSearcher(WeightedRandomSearcher::QueryCost); break;
+  case Searcher::CallPathNovelty: searcher = new CallPathNoveltySearcher(); break;
   }
 
   return searcher;
@@ -17,6 +17,10 @@ namespace klee {
   // XXX gross, should be on demand?
   bool userSearcherRequiresMD2U();
 
+  /// Whether the chosen searchers pick states based on wall time, so that
+  /// two runs of the same program may explore it in different orders.
+  bool userSearcherDependsOnTime();
+
   void initializeSearchOptions();
 
   Searcher *constructUserSearcher(Executor &executor);
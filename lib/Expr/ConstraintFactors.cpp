@@ -0,0 +1,150 @@
+//===-- ConstraintFactors.cpp ---------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/util/ConstraintFactors.h"
+
+#include "klee/util/ExprUtil.h"
+
+#include <algorithm>
+
+using namespace klee;
+
+ConstraintFactors::Reads::Reads(const ref<Expr> &e) {
+  std::vector< ref<ReadExpr> > reads;
+  findReads(e, /* visitUpdates= */ true, reads);
+  for (unsigned i = 0; i != reads.size(); ++i) {
+    ReadExpr *re = reads[i].get();
+    const Array *array = re->updates.root;
+
+    // Reads of a constant array don't alias.
+    if (array->isConstantArray() && !re->updates.head)
+      continue;
+    if (wholeArrays.count(array))
+      continue;
+
+    if (ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index)) {
+      bytes[array].insert((unsigned) CE->getZExtValue(32));
+    } else {
+      bytes.erase(array);
+      wholeArrays.insert(array);
+    }
+  }
+}
+
+unsigned ConstraintFactors::find(unsigned constraint) const {
+  unsigned root = constraint;
+  while (parent[root] != root)
+    root = parent[root];
+  while (parent[constraint] != root) {
+    unsigned next = parent[constraint];
+    parent[constraint] = root;
+    constraint = next;
+  }
+  return root;
+}
+
+void ConstraintFactors::merge(unsigned a, unsigned b) {
+  a = find(a);
+  b = find(b);
+  if (a == b)
+    return;
+  // Move the smaller factor into the larger one.
+  if (members[a].size() < members[b].size())
+    std::swap(a, b);
+  parent[b] = a;
+  members[a].insert(members[a].end(), members[b].begin(), members[b].end());
+  std::vector<unsigned>().swap(members[b]);
+}
+
+void ConstraintFactors::add(const ref<Expr> &constraint) {
+  unsigned c = parent.size();
+  parent.push_back(c);
+  members.push_back(std::vector<unsigned>(1, c));
+
+  Reads reads(constraint);
+  for (std::set<const Array *>::iterator it = reads.wholeArrays.begin(),
+         ie = reads.wholeArrays.end(); it != ie; ++it) {
+    ArrayReaders &readers = arrays[*it];
+    if (!readers.whole) {
+      // From now on, any reader of the array depends on all others.
+      for (std::map<unsigned, unsigned>::iterator
+             bit = readers.bytes.begin(), bie = readers.bytes.end();
+           bit != bie; ++bit)
+        merge(c, bit->second);
+      readers.bytes.clear();
+      readers.whole = true;
+    }
+    if (readers.any >= 0)
+      merge(c, readers.any);
+    readers.any = c;
+  }
+
+  for (std::map<const Array *, std::set<unsigned> >::iterator
+         it = reads.bytes.begin(), ie = reads.bytes.end(); it != ie; ++it) {
+    ArrayReaders &readers = arrays[it->first];
+    if (readers.whole) {
+      merge(c, readers.any);
+    } else {
+      for (std::set<unsigned>::iterator bit = it->second.begin(),
+             bie = it->second.end(); bit != bie; ++bit) {
+        std::pair<std::map<unsigned, unsigned>::iterator, bool> inserted =
+          readers.bytes.insert(std::make_pair(*bit, c));
+        if (!inserted.second) {
+          merge(c, inserted.first->second);
+          inserted.first->second = c;
+        }
+      }
+    }
+    readers.any = c;
+  }
+}
+
+std::vector<unsigned> ConstraintFactors::getMembers(unsigned factor) const {
+  std::vector<unsigned> result = members[find(factor)];
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+void ConstraintFactors::getFactors(const Reads &reads,
+                                   std::set<unsigned> &result) const {
+  for (std::set<const Array *>::const_iterator it = reads.wholeArrays.begin(),
+         ie = reads.wholeArrays.end(); it != ie; ++it) {
+    std::map<const Array *, ArrayReaders>::const_iterator readers =
+      arrays.find(*it);
+    if (readers == arrays.end())
+      continue;
+    if (readers->second.whole) {
+      result.insert(find(readers->second.any));
+      continue;
+    }
+    for (std::map<unsigned, unsigned>::const_iterator
+           bit = readers->second.bytes.begin(),
+           bie = readers->second.bytes.end(); bit != bie; ++bit)
+      result.insert(find(bit->second));
+  }
+
+  for (std::map<const Array *, std::set<unsigned> >::const_iterator
+         it = reads.bytes.begin(), ie = reads.bytes.end(); it != ie; ++it) {
+    std::map<const Array *, ArrayReaders>::const_iterator readers =
+      arrays.find(it->first);
+    if (readers == arrays.end())
+      continue;
+    if (readers->second.whole) {
+      result.insert(find(readers->second.any));
+      continue;
+    }
+    for (std::set<unsigned>::const_iterator bit = it->second.begin(),
+           bie = it->second.end(); bit != bie; ++bit) {
+      std::map<unsigned, unsigned>::const_iterator reader =
+        readers->second.bytes.find(*bit);
+      if (reader != readers->second.bytes.end())
+        result.insert(find(reader->second));
+    }
+  }
+}
@@ -9,6 +9,7 @@
 
 #include "klee/Constraints.h"
 
+#include "klee/util/ConstraintFactors.h"
 #include "klee/util/ExprPPrinter.h"
 #include "klee/util/ExprVisitor.h"
 #include "klee/Internal/Module/KModule.h"
@@ -90,9 +91,22 @@ bool ConstraintManager::rewriteConstraints(ExprVisitor &visitor) {
     }
   }
 
+  // The factors no longer describe a prefix of the constraints.
+  if (changed)
+    factors.reset();
   return changed;
 }
 
+const ConstraintFactors &ConstraintManager::getFactors() const {
+  if (!factors)
+    factors = std::make_shared<ConstraintFactors>();
+  else if (factors->size() < constraints.size() && factors.use_count() > 1)
+    factors = std::make_shared<ConstraintFactors>(*factors);
+  for (size_t i = factors->size(); i < constraints.size(); ++i)
+    factors->add(constraints[i]);
+  return *factors;
+}
+
 void ConstraintManager::simplifyForValidConstraint(ref<Expr> e) {
   // XXX 
 }
@@ -110,7 +110,8 @@ namespace {
     const std::string Filename;
     const MemoryBuffer *TheMemoryBuffer;
     ExprBuilder *Builder;
-    ArrayCache TheArrayCache;
+    ArrayCache OwnArrayCache;
+    ArrayCache &TheArrayCache;
     bool ClearArrayAfterQuery;
 
     Lexer TheLexer;
@@ -324,8 +325,10 @@ namespace {
 
   public:
     ParserImpl(const std::string _Filename, const MemoryBuffer *MB,
-               ExprBuilder *_Builder, bool _ClearArrayAfterQuery)
+               ExprBuilder *_Builder, bool _ClearArrayAfterQuery,
+               ArrayCache *_ArrayCache)
         : Filename(_Filename), TheMemoryBuffer(MB), Builder(_Builder),
+          TheArrayCache(_ArrayCache ? *_ArrayCache : OwnArrayCache),
           ClearArrayAfterQuery(_ClearArrayAfterQuery), TheLexer(MB),
           MaxErrors(~0u), NumErrors(0) {}
 
@@ -1646,8 +1649,10 @@ Parser::~Parser() {
 }
 
 Parser *Parser::Create(const std::string Filename, const MemoryBuffer *MB,
-                       ExprBuilder *Builder, bool ClearArrayAfterQuery) {
-  ParserImpl *P = new ParserImpl(Filename, MB, Builder, ClearArrayAfterQuery);
+                       ExprBuilder *Builder, bool ClearArrayAfterQuery,
+                       ArrayCache *Arrays) {
+  ParserImpl *P =
+      new ParserImpl(Filename, MB, Builder, ClearArrayAfterQuery, Arrays);
   P->Initialize();
   return P;
 }
@@ -16,7 +16,6 @@ using namespace klee;
 /***/
 
 KInstruction::~KInstruction() {
-  delete[] operands;
 }
 
 std::string KInstruction::getSourceLocation() const {
@@ -45,6 +45,7 @@
 
 #include "llvm/Transforms/Utils/Cloning.h"
 
+#include <new>
 #include <sstream>
 
 using namespace llvm;
@@ -375,6 +376,29 @@ static int getOperandNum(Value *v,
   }
 }
 
+/// Whether the Executor treats \a inst as a KGEPInstruction.
+static bool isKGEPInstruction(const Instruction *inst) {
+  switch(inst->getOpcode()) {
+  case Instruction::GetElementPtr:
+  case Instruction::InsertValue:
+  case Instruction::ExtractValue:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static size_t getKInstructionSize(const Instruction *inst) {
+  return isKGEPInstruction(inst) ? sizeof(KGEPInstruction)
+                                 : sizeof(KInstruction);
+}
+
+static unsigned getNumOperandSlots(const Instruction *inst) {
+  if (isa<CallInst>(inst) || isa<InvokeInst>(inst))
+    return CallSite(const_cast<Instruction*>(inst)).arg_size() + 1;
+  return inst->getNumOperands();
+}
+
 KFunction::KFunction(llvm::Function *_function,
                      KModule *km) 
   : function(_function),
@@ -387,6 +411,25 @@ KFunction::KFunction(llvm::Function *_function,
   dt.recalculate(*function);
   loopInfo.Analyze(dt);
 
+  for (llvm::Function::iterator bbit = function->begin(),
+         bbie = function->end(); bbit != bbie; ++bbit) {
+    BasicBlock *bb = &*bbit;
+    if (!loopInfo.isLoopHeader(bb))
+      continue;
+    for (llvm::BasicBlock::iterator it = bb->begin(), ie = bb->end();
+         it != ie; ++it) {
+      if (!isa<CallInst>(it) && !isa<InvokeInst>(it))
+        continue;
+      CallSite cs(&*it);
+      Function *callee =
+        dyn_cast<Function>(cs.getCalledValue()->stripPointerCasts());
+      if (!callee || callee->getName() == "klee_induce_invariants") {
+        inductionLoops.insert(loopInfo.getLoopFor(bb));
+        break;
+      }
+    }
+  }
+
   for (llvm::Function::iterator bbit = function->begin(), 
          bbie = function->end(); bbit != bbie; ++bbit) {
     BasicBlock *bb = &*bbit;
@@ -396,6 +439,21 @@ KFunction::KFunction(llvm::Function *_function,
 
   instructions = new KInstruction*[numInstructions];
 
+  // Size the arena: every instruction followed by its operand numbers.
+  const size_t align = alignof(KGEPInstruction);
+  size_t arenaSize = 0;
+  for (llvm::Function::iterator bbit = function->begin(),
+         bbie = function->end(); bbit != bbie; ++bbit) {
+    for (llvm::BasicBlock::iterator it = bbit->begin(), ie = bbit->end();
+         it != ie; ++it) {
+      arenaSize += getKInstructionSize(&*it) +
+        getNumOperandSlots(&*it) * sizeof(int);
+      arenaSize = (arenaSize + align - 1) / align * align;
+    }
+  }
+  instructionArena = static_cast<char*>(::operator new(arenaSize));
+  char *next = instructionArena;
+
   std::map<Instruction*, unsigned> registerMap;
 
   // The first arg_size() registers are reserved for formals.
@@ -414,24 +472,24 @@ KFunction::KFunction(llvm::Function *_function,
     for (llvm::BasicBlock::iterator it = bbit->begin(), ie = bbit->end();
          it != ie; ++it) {
       KInstruction *ki;
-
-      switch(it->getOpcode()) {
-      case Instruction::GetElementPtr:
-      case Instruction::InsertValue:
-      case Instruction::ExtractValue:
-        ki = new KGEPInstruction(); break;
-      default:
-        ki = new KInstruction(); break;
-      }
-
       Instruction *inst = &*it;
+      if (isKGEPInstruction(inst))
+        ki = new (next) KGEPInstruction();
+      else
+        ki = new (next) KInstruction();
+      next += getKInstructionSize(inst);
+
       ki->inst = inst;
       ki->dest = registerMap[inst];
+      ki->opcode = inst->getOpcode();
+      ki->operands = reinterpret_cast<int*>(next);
+      next += getNumOperandSlots(inst) * sizeof(int);
+      next = instructionArena +
+        (next - instructionArena + align - 1) / align * align;
 
       if (isa<CallInst>(it) || isa<InvokeInst>(it)) {
         CallSite cs(inst);
         unsigned numArgs = cs.arg_size();
-        ki->operands = new int[numArgs+1];
         ki->operands[0] = getOperandNum(cs.getCalledValue(), registerMap, km,
                                         ki);
         for (unsigned j=0; j<numArgs; j++) {
@@ -440,7 +498,6 @@ KFunction::KFunction(llvm::Function *_function,
         }
       } else {
         unsigned numOperands = it->getNumOperands();
-        ki->operands = new int[numOperands];
         for (unsigned j=0; j<numOperands; j++) {
           Value *v = it->getOperand(j);
           ki->operands[j] = getOperandNum(v, registerMap, km, ki);
@@ -454,7 +511,8 @@ KFunction::KFunction(llvm::Function *_function,
 
 KFunction::~KFunction() {
   for (unsigned i=0; i<numInstructions; ++i)
-    delete instructions[i];
+    instructions[i]->~KInstruction();
+  ::operator delete(instructionArena);
   delete[] instructions;
   clearAnalysedLoops();
 
@@ -0,0 +1,232 @@
+//===-- CanonicalizingSolver.cpp ------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/SolverImpl.h"
+#include "klee/util/ArrayCache.h"
+
+#include "llvm/ADT/StringExtras.h"
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+using namespace klee;
+using namespace llvm;
+
+namespace {
+  /// The shape of a symbolic array: its position among the arrays of the
+  /// query, size, domain and range.
+  struct ArrayShape {
+    unsigned ordinal, size;
+    Expr::Width domain, range;
+
+    bool operator<(const ArrayShape &b) const {
+      if (ordinal != b.ordinal)
+        return ordinal < b.ordinal;
+      if (size != b.size)
+        return size < b.size;
+      if (domain != b.domain)
+        return domain < b.domain;
+      return range < b.range;
+    }
+  };
+
+  /// Rewrites one query, replacing its symbolic arrays by canonical ones.
+  /// Shared subexpressions and update nodes are rewritten once.
+  class QueryRenamer {
+    std::map<ArrayShape, const Array *> &canonicalArrays;
+    ArrayCache &arrayCache;
+
+    std::unordered_map<const Array *, const Array *> arrays;
+    std::unordered_map<const Expr *, ref<Expr> > exprs;
+    std::unordered_map<const UpdateNode *, UpdateList> nodes;
+
+    UpdateList renameUpdates(const UpdateList &updates);
+
+  public:
+    QueryRenamer(std::map<ArrayShape, const Array *> &_canonicalArrays,
+                 ArrayCache &_arrayCache)
+      : canonicalArrays(_canonicalArrays), arrayCache(_arrayCache) {}
+
+    const Array *renameArray(const Array *array);
+    ref<Expr> rename(const ref<Expr> &e);
+  };
+}
+
+const Array *QueryRenamer::renameArray(const Array *array) {
+  // Constant arrays are defined by their contents rather than their name,
+  // so they are kept.
+  if (array->isConstantArray())
+    return array;
+
+  std::unordered_map<const Array *, const Array *>::iterator it =
+    arrays.find(array);
+  if (it != arrays.end())
+    return it->second;
+
+  ArrayShape shape = { (unsigned) arrays.size(), array->size, array->domain,
+                       array->range };
+  const Array *&canonical = canonicalArrays[shape];
+  if (!canonical) {
+    // The array cache tells arrays apart by name and size only.
+    std::string name = "arr" + utostr(shape.ordinal);
+    if (shape.domain != Expr::Int32 || shape.range != Expr::Int8)
+      name += "_" + utostr(shape.domain) + "_" + utostr(shape.range);
+    canonical = arrayCache.CreateArray(name, shape.size, 0, 0, shape.domain,
+                                       shape.range);
+  }
+  return arrays[array] = canonical;
+}
+
+UpdateList QueryRenamer::renameUpdates(const UpdateList &updates) {
+  const Array *root = renameArray(updates.root);
+
+  // Rename the nodes not seen yet oldest first, on top of the renamed
+  // rest of the list, so that lists sharing a tail still do.
+  std::vector<const UpdateNode *> fresh;
+  const UpdateNode *un = updates.head;
+  for (; un && !nodes.count(un); un = un->next)
+    fresh.push_back(un);
+
+  UpdateList renamed = un ? nodes.find(un)->second : UpdateList(root, 0);
+  for (std::vector<const UpdateNode *>::reverse_iterator
+         it = fresh.rbegin(), ie = fresh.rend(); it != ie; ++it) {
+    renamed.extend(rename((*it)->index), rename((*it)->value));
+    nodes.insert(std::make_pair(*it, renamed));
+  }
+  return renamed;
+}
+
+ref<Expr> QueryRenamer::rename(const ref<Expr> &e) {
+  if (isa<ConstantExpr>(e))
+    return e;
+
+  std::unordered_map<const Expr *, ref<Expr> >::iterator it =
+    exprs.find(e.get());
+  if (it != exprs.end())
+    return it->second;
+
+  ref<Expr> renamed;
+  if (const ReadExpr *re = dyn_cast<ReadExpr>(e)) {
+    renamed = ReadExpr::create(renameUpdates(re->updates),
+                               rename(re->index));
+  } else {
+    ref<Expr> kids[8];
+    bool changed = false;
+    for (unsigned i = 0; i < e->getNumKids(); ++i) {
+      kids[i] = rename(e->getKid(i));
+      changed |= kids[i] != e->getKid(i);
+    }
+    renamed = changed ? e->rebuild(kids) : e;
+  }
+  return exprs[e.get()] = renamed;
+}
+
+/***/
+
+/// Renames the symbolic arrays of every query by their order of first
+/// appearance, constraints first, before passing it on. Queries that only
+/// differ in the names or identities of their arrays, as when the same
+/// constraints are read from different files, then become equal, and
+/// caching solvers below see them as one.
+///
+/// Canonical arrays are shared by all queries, so the solvers below must
+/// not assume that an array belongs to a single query.
+class CanonicalizingSolver : public SolverImpl {
+  ArrayCache arrayCache;
+  std::map<ArrayShape, const Array *> canonicalArrays;
+  Solver *solver;
+
+  Query canonicalize(const Query &query, QueryRenamer &renamer,
+                     ConstraintManager &constraints);
+
+public:
+  CanonicalizingSolver(Solver *s) : solver(s) {}
+  ~CanonicalizingSolver() { delete solver; }
+
+  bool computeValidity(const Query &, Solver::Validity &result);
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValue(const Query &, ref<Expr> &result);
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(double timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+Query CanonicalizingSolver::canonicalize(const Query &query,
+                                         QueryRenamer &renamer,
+                                         ConstraintManager &constraints) {
+  std::vector<ref<Expr> > renamed;
+  renamed.reserve(query.constraints.size());
+  for (ConstraintManager::const_iterator it = query.constraints.begin(),
+         ie = query.constraints.end(); it != ie; ++it)
+    renamed.push_back(renamer.rename(*it));
+  // The constraints are already simplified against each other.
+  constraints = ConstraintManager(renamed);
+  return Query(constraints, renamer.rename(query.expr));
+}
+
+bool CanonicalizingSolver::computeValidity(const Query &query,
+                                           Solver::Validity &result) {
+  QueryRenamer renamer(canonicalArrays, arrayCache);
+  ConstraintManager constraints;
+  return solver->impl->computeValidity(
+      canonicalize(query, renamer, constraints), result);
+}
+
+bool CanonicalizingSolver::computeTruth(const Query &query, bool &isValid) {
+  QueryRenamer renamer(canonicalArrays, arrayCache);
+  ConstraintManager constraints;
+  return solver->impl->computeTruth(
+      canonicalize(query, renamer, constraints), isValid);
+}
+
+bool CanonicalizingSolver::computeValue(const Query &query,
+                                        ref<Expr> &result) {
+  QueryRenamer renamer(canonicalArrays, arrayCache);
+  ConstraintManager constraints;
+  return solver->impl->computeValue(
+      canonicalize(query, renamer, constraints), result);
+}
+
+bool CanonicalizingSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char> > &values, bool &hasSolution) {
+  QueryRenamer renamer(canonicalArrays, arrayCache);
+  ConstraintManager constraints;
+  Query canonical = canonicalize(query, renamer, constraints);
+  // Objects the query does not mention come after those it does. The
+  // values are returned by position, so they need no renaming back.
+  std::vector<const Array *> renamed;
+  renamed.reserve(objects.size());
+  for (std::vector<const Array *>::const_iterator it = objects.begin(),
+         ie = objects.end(); it != ie; ++it)
+    renamed.push_back(renamer.renameArray(*it));
+  return solver->impl->computeInitialValues(canonical, renamed, values,
+                                            hasSolution);
+}
+
+///
+
+Solver *klee::createCanonicalizingSolver(Solver *s) {
+  return new Solver(new CanonicalizingSolver(s));
+}
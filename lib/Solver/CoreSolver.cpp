@@ -13,12 +13,87 @@
 #include "klee/CommandLine.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "klee/Solver.h"
+#include "klee/SolverStats.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 #include <string>
+#include <vector>
 
 namespace klee {
 
+/// Build a member of a portfolio, or return null if \p cst is not compiled
+/// in. \p name and \p wins are set either way.
+static Solver *createPortfolioMember(CoreSolverType cst, const char *&name,
+                                     Statistic *&wins) {
+  switch (cst) {
+  case STP_SOLVER:
+    name = "STP";
+    wins = &stats::portfolioWinsSTP;
+#ifdef ENABLE_STP
+    // Members have processes of their own, and the portfolio restarts one
+    // that overruns its timeout.
+    return new STPSolver(/*useForkedSTP=*/false, CoreSolverOptimizeDivides);
+#else
+    return NULL;
+#endif
+  case METASMT_SOLVER:
+    name = "MetaSMT";
+    wins = &stats::portfolioWinsMetaSMT;
+#ifdef ENABLE_METASMT
+    return createMetaSMTSolver();
+#else
+    return NULL;
+#endif
+  case Z3_SOLVER:
+    name = "Z3";
+    wins = &stats::portfolioWinsZ3;
+#ifdef ENABLE_Z3
+    return new Z3Solver();
+#else
+    return NULL;
+#endif
+  default:
+    llvm_unreachable("Unsupported portfolio member");
+  }
+}
+
+static Solver *createPortfolio() {
+  // By default, race every backend compiled in.
+  std::vector<CoreSolverType> members(PortfolioSolvers.begin(),
+                                      PortfolioSolvers.end());
+  if (members.empty()) {
+    members.push_back(STP_SOLVER);
+    members.push_back(Z3_SOLVER);
+    members.push_back(METASMT_SOLVER);
+  }
+
+  std::vector<Solver *> solvers;
+  std::vector<Statistic *> wins;
+  std::string names;
+  for (std::vector<CoreSolverType>::iterator it = members.begin(),
+         ie = members.end(); it != ie; ++it) {
+    const char *name;
+    Statistic *memberWins;
+    Solver *solver = createPortfolioMember(*it, name, memberWins);
+    if (!solver) {
+      if (!PortfolioSolvers.empty())
+        klee_warning("Not compiled with %s support, leaving it out of the "
+                     "portfolio", name);
+      continue;
+    }
+    solvers.push_back(solver);
+    wins.push_back(memberWins);
+    names += names.empty() ? name : std::string(", ") + name;
+  }
+
+  if (solvers.empty()) {
+    klee_message("No portfolio solver compiled in");
+    return NULL;
+  }
+  klee_message("Using a portfolio of %s solver backends", names.c_str());
+  return createPortfolioSolver(solvers, wins);
+}
+
 Solver *createCoreSolver(CoreSolverType cst) {
   switch (cst) {
   case STP_SOLVER:
@@ -47,6 +122,8 @@ Solver *createCoreSolver(CoreSolverType cst) {
     klee_message("Not compiled with Z3 support");
     return NULL;
 #endif
+  case PORTFOLIO_SOLVER:
+    return createPortfolio();
   case NO_SOLVER:
     klee_message("Invalid solver");
     return NULL;
@@ -14,11 +14,13 @@
 #include "klee/Constraints.h"
 #include "klee/SolverImpl.h"
 #include "klee/Internal/Support/Debug.h"
+#include "klee/util/ConstraintFactors.h"
 
 #include "klee/util/ExprUtil.h"
 #include "klee/util/Assignment.h"
 
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <ostream>
@@ -113,30 +115,14 @@ public:
     // by adding it to wholeObjects.  Otherwise, creates a mapping of
     // the form Map<array, set<index>> which tracks which parts of the
     // array are being accessed.
-    std::vector< ref<ReadExpr> > reads;
-    findReads(e, /* visitUpdates= */ true, reads);
-    for (unsigned i = 0; i != reads.size(); ++i) {
-      ReadExpr *re = reads[i].get();
-      const Array *array = re->updates.root;
-      
-      // Reads of a constant array don't alias.
-      if (re->updates.root->isConstantArray() &&
-          !re->updates.head)
-        continue;
-
-      if (!wholeObjects.count(array)) {
-        if (ConstantExpr *CE = dyn_cast<ConstantExpr>(re->index)) {
-          // if index constant, then add to set of constraints operating
-          // on that array (actually, don't add constraint, just set index)
-          ::DenseSet<unsigned> &dis = elements[array];
-          dis.add((unsigned) CE->getZExtValue(32));
-        } else {
-          elements_ty::iterator it2 = elements.find(array);
-          if (it2!=elements.end())
-            elements.erase(it2);
-          wholeObjects.insert(array);
-        }
-      }
+    ConstraintFactors::Reads reads(e);
+    wholeObjects = reads.wholeArrays;
+    for (std::map<const Array *, std::set<unsigned> >::iterator
+           it = reads.bytes.begin(), ie = reads.bytes.end(); it != ie; ++it) {
+      ::DenseSet<unsigned> &dis = elements[it->first];
+      for (std::set<unsigned>::iterator it2 = it->second.begin(),
+             ie2 = it->second.end(); it2 != ie2; ++it2)
+        dis.add(*it2);
     }
   }
   IndependentElementSet(const IndependentElementSet &ies) : 
@@ -256,99 +242,74 @@ inline llvm::raw_ostream &operator<<(llvm::raw_ostream &os,
   return os;
 }
 
+// The constraints of the factors of \a query.constraints which \a e reads
+// from, in their order in the query.
+static std::vector<unsigned> getRequiredConstraints(const Query &query,
+                                                    ref<Expr> e) {
+  const ConstraintFactors &factors = query.constraints.getFactors();
+  std::set<unsigned> required;
+  factors.getFactors(ConstraintFactors::Reads(e), required);
+
+  std::vector<unsigned> result;
+  for (std::set<unsigned>::iterator it = required.begin(),
+         ie = required.end(); it != ie; ++it) {
+    std::vector<unsigned> members = factors.getMembers(*it);
+    result.insert(result.end(), members.begin(), members.end());
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
 // Breaks down a constraint into all of it's individual pieces, returning a
-// list of IndependentElementSets or the independent factors.
+// list of IndependentElementSets or the independent factors. The factor of
+// the query expression comes first, the others follow in the order of their
+// first constraint.
 //
 // Caller takes ownership of returned std::list.
 static std::list<IndependentElementSet>*
 getAllIndependentConstraintsSets(const Query &query) {
   std::list<IndependentElementSet> *factors = new std::list<IndependentElementSet>();
+  const ConstraintFactors &partition = query.constraints.getFactors();
+  ConstraintManager::const_iterator constraints = query.constraints.begin();
+
+  std::set<unsigned> seen;
   ConstantExpr *CE = dyn_cast<ConstantExpr>(query.expr);
   if (CE) {
     assert(CE && CE->isFalse() && "the expr should always be false and "
                                   "therefore not included in factors");
   } else {
     ref<Expr> neg = Expr::createIsZero(query.expr);
-    factors->push_back(IndependentElementSet(neg));
+    IndependentElementSet current(neg);
+    std::vector<unsigned> required = getRequiredConstraints(query, neg);
+    for (std::vector<unsigned>::iterator it = required.begin(),
+           ie = required.end(); it != ie; ++it) {
+      current.add(IndependentElementSet(constraints[*it]));
+      seen.insert(partition.getFactor(*it));
+    }
+    factors->push_back(current);
   }
 
-  for (ConstraintManager::const_iterator it = query.constraints.begin(),
-                                         ie = query.constraints.end();
-       it != ie; ++it) {
-    // iterate through all the previously separated constraints.  Until we
-    // actually return, factors is treated as a queue of expressions to be
-    // evaluated.  If the queue property isn't maintained, then the exprs
-    // could be returned in an order different from how they came it, negatively
-    // affecting later stages.
-    factors->push_back(IndependentElementSet(*it));
+  for (unsigned i = 0; i < partition.size(); ++i) {
+    unsigned factor = partition.getFactor(i);
+    if (!seen.insert(factor).second)
+      continue;
+    std::vector<unsigned> members = partition.getMembers(factor);
+    IndependentElementSet current(constraints[members[0]]);
+    for (unsigned j = 1; j < members.size(); ++j)
+      current.add(IndependentElementSet(constraints[members[j]]));
+    factors->push_back(current);
   }
 
-  bool doneLoop = false;
-  do {
-    doneLoop = true;
-    std::list<IndependentElementSet> *done =
-        new std::list<IndependentElementSet>;
-    while (factors->size() > 0) {
-      IndependentElementSet current = factors->front();
-      factors->pop_front();
-      // This list represents the set of factors that are separate from current.
-      // Those that are not inserted into this list (queue) intersect with
-      // current.
-      std::list<IndependentElementSet> *keep =
-          new std::list<IndependentElementSet>;
-      while (factors->size() > 0) {
-        IndependentElementSet compare = factors->front();
-        factors->pop_front();
-        if (current.intersects(compare)) {
-          if (current.add(compare)) {
-            // Means that we have added (z=y)added to (x=y)
-            // Now need to see if there are any (z=?)'s
-            doneLoop = false;
-          }
-        } else {
-          keep->push_back(compare);
-        }
-      }
-      done->push_back(current);
-      delete factors;
-      factors = keep;
-    }
-    delete factors;
-    factors = done;
-  } while (!doneLoop);
-
   return factors;
 }
 
-static 
-IndependentElementSet getIndependentConstraints(const Query& query,
-                                                std::vector< ref<Expr> > &result) {
-  IndependentElementSet eltsClosure(query.expr);
-  std::vector< std::pair<ref<Expr>, IndependentElementSet> > worklist;
-
-  for (ConstraintManager::const_iterator it = query.constraints.begin(), 
-         ie = query.constraints.end(); it != ie; ++it)
-    worklist.push_back(std::make_pair(*it, IndependentElementSet(*it)));
-
-  // XXX This should be more efficient (in terms of low level copy stuff).
-  bool done = false;
-  do {
-    done = true;
-    std::vector< std::pair<ref<Expr>, IndependentElementSet> > newWorklist;
-    for (std::vector< std::pair<ref<Expr>, IndependentElementSet> >::iterator
-           it = worklist.begin(), ie = worklist.end(); it != ie; ++it) {
-      if (it->second.intersects(eltsClosure)) {
-        if (eltsClosure.add(it->second))
-          done = false;
-        result.push_back(it->first);
-        // Means that we have added (z=y)added to (x=y)
-        // Now need to see if there are any (z=?)'s
-      } else {
-        newWorklist.push_back(*it);
-      }
-    }
-    worklist.swap(newWorklist);
-  } while (!done);
+static void getIndependentConstraints(const Query& query,
+                                      std::vector< ref<Expr> > &result) {
+  std::vector<unsigned> required = getRequiredConstraints(query, query.expr);
+  ConstraintManager::const_iterator constraints = query.constraints.begin();
+  for (std::vector<unsigned>::iterator it = required.begin(),
+         ie = required.end(); it != ie; ++it)
+    result.push_back(constraints[*it]);
 
   KLEE_DEBUG(
     std::set< ref<Expr> > reqset(result.begin(), result.end());
@@ -362,11 +323,7 @@ IndependentElementSet getIndependentConstraints(const Query& query,
       errs() << " " << (reqset.count(*it) ? "(required)" : "(independent)") << "\n";
       errs() << "\telts: " << IndependentElementSet(*it) << "\n";
     }
-    errs() << "elts closure: " << eltsClosure << "\n";
  );
-
-
-  return eltsClosure;
 }
 
 
@@ -414,8 +371,7 @@ public:
 bool IndependentSolver::computeValidity(const Query& query,
                                         Solver::Validity &result) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure =
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeValidity(Query(tmp, query.expr), 
                                        result);
@@ -423,8 +379,7 @@ bool IndependentSolver::computeValidity(const Query& query,
 
 bool IndependentSolver::computeTruth(const Query& query, bool &isValid) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure = 
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeTruth(Query(tmp, query.expr), 
                                     isValid);
@@ -432,8 +387,7 @@ bool IndependentSolver::computeTruth(const Query& query, bool &isValid) {
 
 bool IndependentSolver::computeValue(const Query& query, ref<Expr> &result) {
   std::vector< ref<Expr> > required;
-  IndependentElementSet eltsClosure = 
-    getIndependentConstraints(query, required);
+  getIndependentConstraints(query, required);
   ConstraintManager tmp(required);
   return solver->impl->computeValue(Query(tmp, query.expr), result);
 }
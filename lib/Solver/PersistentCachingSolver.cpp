@@ -0,0 +1,400 @@
+//===-- PersistentCachingSolver.cpp ---------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/SolverImpl.h"
+#include "klee/SolverStats.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace klee;
+using namespace llvm;
+
+namespace {
+  const uint32_t CacheMagic = 0x4843514b; // "KQCH"
+  const uint32_t CacheVersion = 2;
+
+  enum QueryKind { TruthQuery, ValidityQuery, ValueQuery };
+
+  /// A 128 bit hash which, unlike Expr::hash() and llvm::hash_combine,
+  /// is the same in every process and does not ignore operand order.
+  struct StableHash {
+    uint64_t lo, hi;
+
+    StableHash() : lo(0x84222325cbf29ce4ULL), hi(0x9e3779b97f4a7c15ULL) {}
+
+    static uint64_t mix(uint64_t x) {
+      x ^= x >> 33;
+      x *= 0xff51afd7ed558ccdULL;
+      x ^= x >> 33;
+      x *= 0xc4ceb9fe1a85ec53ULL;
+      x ^= x >> 33;
+      return x;
+    }
+
+    void add(uint64_t v) {
+      lo = mix(lo ^ v) + 0x100000001b3ULL;
+      hi = mix(hi + v * 0x9e3779b97f4a7c15ULL) ^ (hi >> 29);
+    }
+    void add(const StableHash &h) {
+      add(h.lo);
+      add(h.hi);
+    }
+    void add(const std::string &s) {
+      add(s.size());
+      for (unsigned i = 0; i < s.size(); ++i)
+        add((uint8_t) s[i]);
+    }
+
+    bool operator<(const StableHash &b) const {
+      return lo < b.lo || (lo == b.lo && hi < b.hi);
+    }
+    bool operator==(const StableHash &b) const {
+      return lo == b.lo && hi == b.hi;
+    }
+  };
+
+  /// One cached result, as laid out on disk after the file header.
+  struct CacheRecord {
+    uint64_t lo, hi;
+    uint64_t value;
+    uint32_t width; // of a value query result, 0 otherwise
+    uint32_t reserved;
+  };
+
+  /// Hashes the structure of expressions, visiting shared subexpressions
+  /// and update nodes once per query.
+  ///
+  /// Arrays are told apart by the order in which they are first met, not
+  /// by name: distinct arrays may share a name, and the same query built
+  /// in another run may name its arrays differently.
+  class QueryHasher {
+    /// Whether to tell arrays apart at all, rather than hash every array
+    /// of the same type and contents alike.
+    bool numberArrays;
+    std::unordered_map<const Expr *, StableHash> exprs;
+    std::unordered_map<const UpdateNode *, StableHash> nodes;
+    std::unordered_map<const Array *, StableHash> arrays;
+
+    const StableHash &hashArray(const Array *array);
+    StableHash hashUpdates(const UpdateList &updates);
+
+  public:
+    explicit QueryHasher(bool _numberArrays = true)
+      : numberArrays(_numberArrays) {}
+
+    const StableHash &hashExpr(const ref<Expr> &e);
+    StableHash hashQuery(const Query &query, QueryKind kind);
+  };
+}
+
+const StableHash &QueryHasher::hashArray(const Array *array) {
+  std::unordered_map<const Array *, StableHash>::iterator it =
+    arrays.find(array);
+  if (it != arrays.end())
+    return it->second;
+
+  StableHash h;
+  if (numberArrays)
+    h.add(arrays.size());
+  h.add(array->size);
+  h.add(array->domain);
+  h.add(array->range);
+  h.add(array->constantValues.size());
+  for (unsigned i = 0; i < array->constantValues.size(); ++i)
+    h.add(hashExpr(array->constantValues[i]));
+  return arrays[array] = h;
+}
+
+StableHash QueryHasher::hashUpdates(const UpdateList &updates) {
+  // Hash the nodes not seen yet oldest first, each on top of the rest of
+  // the list, so that lists sharing a tail share the work.
+  std::vector<const UpdateNode *> fresh;
+  const UpdateNode *un = updates.head;
+  for (; un && !nodes.count(un); un = un->next)
+    fresh.push_back(un);
+
+  StableHash tail = un ? nodes[un] : StableHash();
+  for (std::vector<const UpdateNode *>::reverse_iterator
+         it = fresh.rbegin(), ie = fresh.rend(); it != ie; ++it) {
+    StableHash h;
+    h.add(tail);
+    h.add(hashExpr((*it)->index));
+    h.add(hashExpr((*it)->value));
+    tail = nodes[*it] = h;
+  }
+
+  StableHash h;
+  h.add(hashArray(updates.root));
+  h.add(tail);
+  return h;
+}
+
+const StableHash &QueryHasher::hashExpr(const ref<Expr> &e) {
+  std::unordered_map<const Expr *, StableHash>::iterator it =
+    exprs.find(e.get());
+  if (it != exprs.end())
+    return it->second;
+
+  StableHash h;
+  h.add(e->getKind());
+  h.add(e->getWidth());
+  switch (e->getKind()) {
+  case Expr::Constant: {
+    const APInt &v = cast<ConstantExpr>(e)->getAPValue();
+    for (unsigned i = 0; i < v.getNumWords(); ++i)
+      h.add(v.getRawData()[i]);
+    break;
+  }
+  case Expr::Read: {
+    const ReadExpr *re = cast<ReadExpr>(e);
+    h.add(hashUpdates(re->updates));
+    h.add(hashExpr(re->index));
+    break;
+  }
+  case Expr::Extract:
+    h.add(cast<ExtractExpr>(e)->offset);
+    h.add(hashExpr(e->getKid(0)));
+    break;
+  default:
+    for (unsigned i = 0; i < e->getNumKids(); ++i)
+      h.add(hashExpr(e->getKid(i)));
+  }
+  return exprs[e.get()] = h;
+}
+
+StableHash QueryHasher::hashQuery(const Query &query, QueryKind kind) {
+  // The constraints are a conjunction, so their order should not matter.
+  // Arrays are numbered as they are met, so visit the constraints in an
+  // order that does not depend on the order they were added in: sorted by
+  // their hash with all arrays alike.
+  std::vector<ref<Expr> > constraints(query.constraints.begin(),
+                                      query.constraints.end());
+  QueryHasher shapes(false);
+  std::vector<std::pair<StableHash, unsigned> > order;
+  for (unsigned i = 0; i < constraints.size(); ++i)
+    order.push_back(std::make_pair(shapes.hashExpr(constraints[i]), i));
+  std::sort(order.begin(), order.end());
+
+  StableHash h;
+  h.add(kind);
+  h.add(constraints.size());
+  for (std::vector<std::pair<StableHash, unsigned> >::iterator
+         it = order.begin(), ie = order.end(); it != ie; ++it)
+    h.add(hashExpr(constraints[it->second]));
+  h.add(hashExpr(query.expr));
+  return h;
+}
+
+/***/
+
+/// Caches truth, validity and value results in a file, so that tools
+/// asking the same questions run after run only pay for them once.
+///
+/// Queries are keyed by a 128 bit hash of their structure, so queries
+/// that only differ in the names of their arrays share a result. The file
+/// is read when the solver is created and written back, merged with what
+/// other processes added meanwhile, when it is destroyed.
+///
+/// Nothing is written before that, so the solver must actually be
+/// deleted. The tools get it through the global kutil::solver_toolbox,
+/// whose destructor deletes the chain at exit: a tool that leaves through
+/// _exit(), abort() or a crash loses the results of its run.
+class PersistentCachingSolver : public SolverImpl {
+  typedef std::map<StableHash, CacheRecord> cache_map;
+
+  Solver *solver;
+  std::string path;
+  cache_map cache;
+  bool dirty;
+
+  bool load(cache_map &into);
+  void save();
+
+  bool lookup(const Query &query, QueryKind kind, CacheRecord &record);
+  void insert(const Query &query, QueryKind kind, uint64_t value,
+              uint32_t width = 0);
+
+public:
+  PersistentCachingSolver(Solver *s, const std::string &_path);
+  ~PersistentCachingSolver();
+
+  bool computeValidity(const Query &, Solver::Validity &result);
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValue(const Query &, ref<Expr> &result);
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    return solver->impl->computeInitialValues(query, objects, values,
+                                              hasSolution);
+  }
+  SolverRunStatus getOperationStatusCode() {
+    return solver->impl->getOperationStatusCode();
+  }
+  char *getConstraintLog(const Query &query) {
+    return solver->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(double timeout) {
+    solver->impl->setCoreSolverTimeout(timeout);
+  }
+};
+
+PersistentCachingSolver::PersistentCachingSolver(Solver *s,
+                                                 const std::string &_path)
+  : solver(s), path(_path), dirty(false) {
+  load(cache);
+}
+
+PersistentCachingSolver::~PersistentCachingSolver() {
+  if (dirty)
+    save();
+  delete solver;
+}
+
+bool PersistentCachingSolver::load(cache_map &into) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f) {
+    // No cache yet is fine; it is created on the first save.
+    if (errno != ENOENT)
+      klee_warning("query cache %s: %s", path.c_str(), strerror(errno));
+    return false;
+  }
+
+  uint32_t header[2];
+  bool ok = fread(header, sizeof(header), 1, f) == 1 &&
+            header[0] == CacheMagic && header[1] == CacheVersion;
+  if (!ok) {
+    klee_warning("query cache %s: not a query cache of this version, "
+                 "ignoring it", path.c_str());
+  } else {
+    // A record cut short by a crash is ignored.
+    CacheRecord record;
+    while (fread(&record, sizeof(record), 1, f) == 1) {
+      StableHash key;
+      key.lo = record.lo;
+      key.hi = record.hi;
+      into.insert(std::make_pair(key, record));
+    }
+  }
+  fclose(f);
+  return ok;
+}
+
+void PersistentCachingSolver::save() {
+  // Another process may have saved since we loaded; keep its results too.
+  load(cache);
+
+  char pid[32];
+  snprintf(pid, sizeof(pid), ".%d.tmp", (int) getpid());
+  std::string tmpPath = path + pid;
+  FILE *f = fopen(tmpPath.c_str(), "wb");
+  if (!f) {
+    klee_warning("query cache %s: %s", tmpPath.c_str(), strerror(errno));
+    return;
+  }
+
+  uint32_t header[2] = { CacheMagic, CacheVersion };
+  bool ok = fwrite(header, sizeof(header), 1, f) == 1;
+  for (cache_map::iterator it = cache.begin(), ie = cache.end();
+       ok && it != ie; ++it)
+    ok = fwrite(&it->second, sizeof(it->second), 1, f) == 1;
+  ok = fclose(f) == 0 && ok;
+
+  // Replace the cache at once, so readers never see a partial file.
+  if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+    klee_warning("query cache %s: %s", path.c_str(), strerror(errno));
+    unlink(tmpPath.c_str());
+    return;
+  }
+  dirty = false;
+}
+
+bool PersistentCachingSolver::lookup(const Query &query, QueryKind kind,
+                                     CacheRecord &record) {
+  QueryHasher hasher;
+  cache_map::iterator it = cache.find(hasher.hashQuery(query, kind));
+  if (it == cache.end()) {
+    ++stats::persistentCacheMisses;
+    return false;
+  }
+  ++stats::persistentCacheHits;
+  record = it->second;
+  return true;
+}
+
+void PersistentCachingSolver::insert(const Query &query, QueryKind kind,
+                                     uint64_t value, uint32_t width) {
+  QueryHasher hasher;
+  StableHash key = hasher.hashQuery(query, kind);
+  CacheRecord record = { key.lo, key.hi, value, width, 0 };
+  cache[key] = record;
+  dirty = true;
+}
+
+bool PersistentCachingSolver::computeValidity(const Query &query,
+                                              Solver::Validity &result) {
+  CacheRecord record;
+  if (lookup(query, ValidityQuery, record)) {
+    result = (Solver::Validity) (int64_t) record.value;
+    return true;
+  }
+  if (!solver->impl->computeValidity(query, result))
+    return false;
+  insert(query, ValidityQuery, (int64_t) result);
+  return true;
+}
+
+bool PersistentCachingSolver::computeTruth(const Query &query,
+                                           bool &isValid) {
+  CacheRecord record;
+  if (lookup(query, TruthQuery, record)) {
+    isValid = record.value;
+    return true;
+  }
+  if (!solver->impl->computeTruth(query, isValid))
+    return false;
+  insert(query, TruthQuery, isValid);
+  return true;
+}
+
+bool PersistentCachingSolver::computeValue(const Query &query,
+                                           ref<Expr> &result) {
+  CacheRecord record;
+  if (lookup(query, ValueQuery, record)) {
+    result = ConstantExpr::create(record.value, record.width);
+    return true;
+  }
+  if (!solver->impl->computeValue(query, result))
+    return false;
+  // Wider values are rare enough not to bother with.
+  ConstantExpr *ce = dyn_cast<ConstantExpr>(result);
+  if (ce && ce->getWidth() <= 64)
+    insert(query, ValueQuery, ce->getZExtValue(), ce->getWidth());
+  return true;
+}
+
+///
+
+Solver *klee::createPersistentCachingSolver(Solver *s,
+                                            const std::string &path) {
+  return new Solver(new PersistentCachingSolver(s, path));
+}
@@ -0,0 +1,510 @@
+//===-- PortfolioSolver.cpp -----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Solver.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/ExprBuilder.h"
+#include "klee/SolverImpl.h"
+#include "klee/SolverStats.h"
+#include "klee/Statistic.h"
+#include "klee/TimerStatIncrementer.h"
+#include "klee/Internal/Support/ErrorHandling.h"
+#include "klee/Internal/System/Time.h"
+#include "klee/util/ArrayCache.h"
+#include "klee/util/Assignment.h"
+#include "klee/util/ExprPPrinter.h"
+#include "klee/util/ExprUtil.h"
+#include "expr/Parser.h"
+
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace klee;
+using namespace llvm;
+
+namespace {
+  /// Sent to a member ahead of the kQuery text of a query. The text only
+  /// holds the constraints following the first \a kept constraints of
+  /// the member's previous query, which make up the rest.
+  struct MemberRequest {
+    double timeout;
+    uint32_t kept;
+    uint32_t length;
+  };
+
+  /// Sent back by a member, followed by the values of the objects if it
+  /// found a solution.
+  struct MemberReply {
+    int32_t status;
+    uint8_t success;
+    uint8_t hasSolution;
+    uint32_t size;
+  };
+
+  /// A member process, and the end of its socket the portfolio talks on.
+  struct Member {
+    pid_t pid;
+    int fd;
+    /// Whether it is solving a query whose answer has not been read yet.
+    /// The portfolio may have stopped waiting for that query.
+    bool busy;
+    /// The query it is solving, or solved last, and since when.
+    unsigned query;
+    double started;
+    /// The constraints it holds: those of its last query, or none if it
+    /// failed to answer it.
+    std::vector<ref<Expr> > constraints;
+
+    Member() : pid(-1), fd(-1), busy(false), query(0), started(0) {}
+  };
+}
+
+/// Races core solvers: every query is given to all of them at once, and
+/// the first to succeed answers it.
+///
+/// Each member runs in a process of its own, forked when the portfolio is
+/// created, because the reference counts of expressions, the statistics
+/// and some backends are not thread safe. Queries reach the members as
+/// kQuery text over a socket, so members keep what they learn between
+/// queries, such as the constraints of incremental Z3, and a query costs
+/// no fork of the (possibly huge) process asking it.
+///
+/// Consecutive queries mostly extend the same path, so a member keeps the
+/// constraints of its last query, and only those following the prefix it
+/// shares with the next one are printed and parsed again. Finding that
+/// prefix compares expression pointers, one per shared constraint.
+///
+/// A member that loses a race finishes its query anyway, and sits out the
+/// races that start meanwhile. One that takes more than the timeout past
+/// the portfolio's is restarted.
+class PortfolioSolver : public SolverImpl {
+  std::vector<Solver *> solvers;
+  std::vector<Statistic *> wins;
+  std::vector<Member> members;
+  /// The process that started the members. A process forked from it
+  /// cannot share them and starts its own.
+  pid_t owner;
+  unsigned numQueries;
+  double timeout;
+  SolverRunStatus runStatusCode;
+
+  void startMember(unsigned index);
+  void stopMember(unsigned index);
+  bool receive(unsigned index, MemberReply &reply,
+               std::vector<unsigned char> &bytes);
+
+  bool race(const Query &query, const std::vector<const Array *> &objects,
+            std::vector<std::vector<unsigned char> > &values,
+            bool &hasSolution);
+
+public:
+  PortfolioSolver(const std::vector<Solver *> &_solvers,
+                  const std::vector<Statistic *> &_wins);
+  ~PortfolioSolver();
+
+  bool computeTruth(const Query &, bool &isValid);
+  bool computeValue(const Query &, ref<Expr> &result);
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution);
+  SolverRunStatus getOperationStatusCode() { return runStatusCode; }
+  char *getConstraintLog(const Query &query) {
+    return solvers[0]->impl->getConstraintLog(query);
+  }
+  void setCoreSolverTimeout(double _timeout) { timeout = _timeout; }
+};
+
+static bool readAll(int fd, void *buffer, size_t size) {
+  char *pos = static_cast<char *>(buffer);
+  while (size) {
+    ssize_t n = read(fd, pos, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    pos += n;
+    size -= n;
+  }
+  return true;
+}
+
+/// Unlike write(), does not raise SIGPIPE if the other end is gone.
+static bool sendAll(int fd, const void *buffer, size_t size) {
+  const char *pos = static_cast<const char *>(buffer);
+  while (size) {
+    ssize_t n = send(fd, pos, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    pos += n;
+    size -= n;
+  }
+  return true;
+}
+
+/// The body of a member's process: answer the queries arriving on \a fd
+/// until the portfolio goes away.
+static void serveQueries(Solver *solver, int fd) {
+  ExprBuilder *builder = createDefaultExprBuilder();
+  // Backends remember arrays by address, so a symbolic array has to stay
+  // the same object from one query to the next.
+  ArrayCache arrays;
+  double timeout = 0;
+  std::vector<ref<Expr> > constraints;
+  MemberRequest request;
+  while (readAll(fd, &request, sizeof(request))) {
+    std::string text(request.length, '\0');
+    if (!readAll(fd, &text[0], text.size()))
+      break;
+    if (request.timeout != timeout) {
+      timeout = request.timeout;
+      solver->impl->setCoreSolverTimeout(timeout);
+    }
+
+    MemberReply reply = { SolverImpl::SOLVER_RUN_STATUS_FAILURE, 0, 0, 0 };
+    std::vector<unsigned char> bytes;
+    std::unique_ptr<MemoryBuffer> buffer(MemoryBuffer::getMemBuffer(text));
+    expr::Parser *parser =
+      expr::Parser::Create("portfolio", buffer.get(), builder, true, &arrays);
+    std::vector<expr::Decl *> decls;
+    expr::QueryCommand *qc = 0;
+    while (expr::Decl *d = parser->ParseTopLevelDecl()) {
+      decls.push_back(d);
+      if (!qc)
+        qc = dyn_cast<expr::QueryCommand>(d);
+    }
+    if (qc && !parser->GetNumErrors() && request.kept <= constraints.size()) {
+      constraints.resize(request.kept);
+      constraints.insert(constraints.end(), qc->Constraints.begin(),
+                         qc->Constraints.end());
+      ConstraintManager cm(constraints);
+      std::vector<std::vector<unsigned char> > values;
+      bool hasSolution = false;
+      reply.success = solver->impl->computeInitialValues(
+          Query(cm, qc->Query), qc->Objects, values, hasSolution);
+      reply.status = solver->impl->getOperationStatusCode();
+      reply.hasSolution = hasSolution;
+      if (reply.success && hasSolution)
+        for (unsigned i = 0; i < values.size(); ++i)
+          bytes.insert(bytes.end(), values[i].begin(), values[i].end());
+      reply.size = bytes.size();
+    }
+    // The portfolio forgets what a member holds when it fails.
+    if (!reply.success)
+      constraints.clear();
+    for (std::vector<expr::Decl *>::iterator it = decls.begin(),
+           ie = decls.end(); it != ie; ++it)
+      delete *it;
+    delete parser;
+
+    if (!sendAll(fd, &reply, sizeof(reply)) ||
+        !sendAll(fd, bytes.data(), bytes.size()))
+      break;
+  }
+  _exit(0);
+}
+
+PortfolioSolver::PortfolioSolver(const std::vector<Solver *> &_solvers,
+                                 const std::vector<Statistic *> &_wins)
+  : solvers(_solvers), wins(_wins), members(_solvers.size()),
+    owner(getpid()), numQueries(0), timeout(0.0),
+    runStatusCode(SOLVER_RUN_STATUS_FAILURE) {
+  assert(!solvers.empty() && solvers.size() == wins.size() &&
+         "one statistic per member needed");
+  // Before the caller starts any threads, ideally.
+  for (unsigned i = 0; i < solvers.size(); ++i)
+    startMember(i);
+}
+
+PortfolioSolver::~PortfolioSolver() {
+  for (unsigned i = 0; i < members.size(); ++i) {
+    if (owner == getpid())
+      stopMember(i);
+    else if (members[i].fd >= 0)
+      close(members[i].fd);
+  }
+  for (std::vector<Solver *>::iterator it = solvers.begin(),
+         ie = solvers.end(); it != ie; ++it)
+    delete *it;
+}
+
+void PortfolioSolver::startMember(unsigned index) {
+  Member &m = members[index];
+  m = Member();
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+    klee_warning("socketpair failed (for portfolio solver) - %s",
+                 sys::StrError(errno).c_str());
+    return;
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if (pid == 0) {
+    // Only the portfolio may notice when the other members go away.
+    for (unsigned i = 0; i < members.size(); ++i)
+      if (members[i].fd >= 0)
+        close(members[i].fd);
+    close(fds[0]);
+    serveQueries(solvers[index], fds[1]);
+  }
+  close(fds[1]);
+  if (pid < 0) {
+    klee_warning("fork failed (for portfolio solver) - %s",
+                 sys::StrError(errno).c_str());
+    close(fds[0]);
+    return;
+  }
+  m.pid = pid;
+  m.fd = fds[0];
+}
+
+void PortfolioSolver::stopMember(unsigned index) {
+  Member &m = members[index];
+  if (m.fd >= 0)
+    close(m.fd);
+  if (m.pid > 0) {
+    kill(m.pid, SIGKILL);
+    int status;
+    while (waitpid(m.pid, &status, 0) < 0 && errno == EINTR)
+      ;
+  }
+  m = Member();
+}
+
+/// Read the answer of a busy member, stopping it if it cannot be read.
+bool PortfolioSolver::receive(unsigned index, MemberReply &reply,
+                              std::vector<unsigned char> &bytes) {
+  Member &m = members[index];
+  m.busy = false;
+  if (readAll(m.fd, &reply, sizeof(reply))) {
+    // It dropped its constraints too.
+    if (!reply.success)
+      m.constraints.clear();
+    bytes.resize(reply.size);
+    if (readAll(m.fd, bytes.data(), bytes.size()))
+      return true;
+  }
+  klee_warning("portfolio member %u exited", index);
+  stopMember(index);
+  return false;
+}
+
+bool PortfolioSolver::race(const Query &query,
+                           const std::vector<const Array *> &objects,
+                           std::vector<std::vector<unsigned char> > &values,
+                           bool &hasSolution) {
+  TimerStatIncrementer t(stats::queryTime);
+  ++stats::queries;
+  runStatusCode = SOLVER_RUN_STATUS_FAILURE;
+
+  if (owner != getpid()) {
+    // The process that started the members still talks to them.
+    owner = getpid();
+    for (unsigned i = 0; i < members.size(); ++i) {
+      if (members[i].fd >= 0)
+        close(members[i].fd);
+      startMember(i);
+    }
+  }
+
+  double start = util::getWallTime();
+  for (unsigned i = 0; i < members.size(); ++i)
+    if (members[i].busy && timeout &&
+        start - members[i].started > 2 * timeout) {
+      stopMember(i);
+      startMember(i);
+    }
+
+  // The text of the query, by the number of constraints the member it is
+  // sent to keeps. Members are mostly in step, so usually one is printed.
+  std::map<unsigned, std::string> texts;
+  unsigned id = ++numQueries;
+
+  // Members answering earlier queries join the race once they are done.
+  std::vector<bool> asked(members.size(), false);
+  int winner = -1;
+  std::vector<unsigned char> bytes;
+  double deadline = timeout ? start + timeout : 0;
+  for (;;) {
+    std::vector<struct pollfd> fds;
+    std::vector<unsigned> polled;
+    for (unsigned i = 0; i < members.size(); ++i) {
+      Member &m = members[i];
+      if (m.fd < 0 || (asked[i] && !m.busy))
+        continue;
+      if (!m.busy) {
+        asked[i] = true;
+        ConstraintManager::constraint_iterator begin =
+            query.constraints.begin();
+        unsigned kept = 0;
+        while (kept < m.constraints.size() &&
+               kept < query.constraints.size() &&
+               m.constraints[kept].get() == begin[kept].get())
+          ++kept;
+
+        std::string &text = texts[kept];
+        if (text.empty()) {
+          llvm::raw_string_ostream os(text);
+          ConstraintManager added(
+              std::vector<ref<Expr> >(begin + kept, query.constraints.end()));
+          ExprPPrinter::printQuery(os, added, query.expr, 0, 0,
+                                   objects.data(),
+                                   objects.data() + objects.size());
+          os.flush();
+        }
+        MemberRequest request = { timeout, kept, (uint32_t) text.size() };
+        if (!sendAll(m.fd, &request, sizeof(request)) ||
+            !sendAll(m.fd, text.data(), text.size())) {
+          klee_warning("portfolio member %u exited", i);
+          stopMember(i);
+          continue;
+        }
+        m.constraints.resize(kept);
+        m.constraints.insert(m.constraints.end(), begin + kept,
+                             query.constraints.end());
+        m.busy = true;
+        m.query = id;
+        m.started = util::getWallTime();
+      }
+      struct pollfd pfd = { m.fd, POLLIN, 0 };
+      fds.push_back(pfd);
+      polled.push_back(i);
+    }
+    if (fds.empty())
+      break;
+
+    int wait = -1;
+    if (timeout) {
+      double remaining = deadline - util::getWallTime();
+      if (remaining <= 0) {
+        runStatusCode = SOLVER_RUN_STATUS_TIMEOUT;
+        break;
+      }
+      wait = (int) std::ceil(remaining * 1000);
+    }
+    int ready = poll(fds.data(), fds.size(), wait);
+    if (ready < 0 && errno != EINTR) {
+      klee_warning("poll failed (for portfolio solver) - %s",
+                   sys::StrError(errno).c_str());
+      break;
+    }
+
+    for (unsigned j = 0; ready > 0 && j < fds.size(); ++j) {
+      if (!fds[j].revents)
+        continue;
+      unsigned i = polled[j];
+      bool current = members[i].query == id;
+      MemberReply reply;
+      if (!receive(i, reply, bytes) || !current)
+        continue;
+      if (reply.success) {
+        winner = i;
+        runStatusCode = (SolverRunStatus) reply.status;
+        hasSolution = reply.hasSolution;
+        break;
+      }
+      // Prefer reporting that a member ran out of time.
+      if (runStatusCode != SOLVER_RUN_STATUS_TIMEOUT)
+        runStatusCode = (SolverRunStatus) reply.status;
+    }
+    if (winner >= 0)
+      break;
+  }
+
+  if (winner < 0) {
+    bool alive = false;
+    for (unsigned i = 0; i < members.size(); ++i)
+      alive |= members[i].fd >= 0;
+    if (!alive)
+      runStatusCode = SOLVER_RUN_STATUS_FORK_FAILED;
+    return false;
+  }
+
+  if (hasSolution) {
+    const unsigned char *pos = bytes.data();
+    values.clear();
+    values.reserve(objects.size());
+    for (std::vector<const Array *>::const_iterator it = objects.begin(),
+           ie = objects.end(); it != ie; ++it) {
+      values.push_back(std::vector<unsigned char>(pos, pos + (*it)->size));
+      pos += (*it)->size;
+    }
+    ++stats::queriesInvalid;
+  } else {
+    ++stats::queriesValid;
+  }
+  ++*wins[winner];
+  return true;
+}
+
+bool PortfolioSolver::computeTruth(const Query &query, bool &isValid) {
+  std::vector<const Array *> objects;
+  std::vector<std::vector<unsigned char> > values;
+  bool hasSolution;
+
+  if (!race(query, objects, values, hasSolution))
+    return false;
+  isValid = !hasSolution;
+  return true;
+}
+
+bool PortfolioSolver::computeValue(const Query &query, ref<Expr> &result) {
+  std::vector<const Array *> objects;
+  std::vector<std::vector<unsigned char> > values;
+  bool hasSolution;
+
+  // Find the object used in the expression, and compute an assignment
+  // for them.
+  findSymbolicObjects(query.expr, objects);
+  if (!computeInitialValues(query.withFalse(), objects, values, hasSolution))
+    return false;
+  assert(hasSolution && "state has invalid constraint set");
+
+  // Evaluate the expression with the computed assignment.
+  Assignment a(objects, values);
+  result = a.evaluate(query.expr);
+
+  return true;
+}
+
+bool PortfolioSolver::computeInitialValues(
+    const Query &query, const std::vector<const Array *> &objects,
+    std::vector<std::vector<unsigned char> > &values, bool &hasSolution) {
+  ++stats::queryCounterexamples;
+  return race(query, objects, values, hasSolution);
+}
+
+///
+
+Solver *klee::createPortfolioSolver(const std::vector<Solver *> &solvers,
+                                    const std::vector<Statistic *> &wins) {
+  return new Solver(new PortfolioSolver(solvers, wins));
+}
@@ -12,6 +12,11 @@
 using namespace klee;
 
 Statistic stats::cexCacheTime("CexCacheTime", "CCtime");
+Statistic stats::persistentCacheHits("PersistentCacheHits", "PChits");
+Statistic stats::persistentCacheMisses("PersistentCacheMisses", "PCmisses");
+Statistic stats::portfolioWinsMetaSMT("PortfolioWinsMetaSMT", "PWmetasmt");
+Statistic stats::portfolioWinsSTP("PortfolioWinsSTP", "PWstp");
+Statistic stats::portfolioWinsZ3("PortfolioWinsZ3", "PWz3");
 Statistic stats::queries("Queries", "Q");
 Statistic stats::queriesInvalid("QueriesInvalid", "Qiv");
 Statistic stats::queriesValid("QueriesValid", "Qv");
@@ -22,6 +27,7 @@ Statistic stats::queryCexCacheMisses("QueryCexCacheMisses", "QCexMisses");
 Statistic stats::queryConstructTime("QueryConstructTime", "QBtime") ;
 Statistic stats::queryConstructs("QueriesConstructs", "QB");
 Statistic stats::queryCounterexamples("QueriesCEX", "Qcex");
+Statistic stats::queryReusedConstraints("QueryReusedConstraints", "QRC");
 Statistic stats::queryTime("QueryTime", "Qtime");
 
 #ifdef KLEE_ARRAY_DEBUG
@@ -187,6 +187,7 @@ public:
   }
 
   void clearConstructCache() { constructed.clear(); }
+  size_t getConstructCacheSize() const { return constructed.size(); }
 };
 }
 
@@ -38,6 +38,22 @@ llvm::cl::opt<bool> Z3ValidateModels(
 llvm::cl::opt<unsigned>
     Z3VerbosityLevel("debug-z3-verbosity", llvm::cl::init(0),
                      llvm::cl::desc("Z3 verbosity level (default=0)"));
+
+llvm::cl::opt<bool> Z3Incremental(
+    "z3-incremental", llvm::cl::init(false),
+    llvm::cl::desc("Keep Z3 solvers across queries and only assert the "
+                   "constraints that differ from the previous query, using "
+                   "push/pop (default=off)"));
+
+llvm::cl::opt<unsigned> Z3IncrementalSolvers(
+    "z3-incremental-solvers", llvm::cl::init(4),
+    llvm::cl::desc("Number of Z3 solvers, each holding one path prefix, "
+                   "kept with -z3-incremental (default=4)"));
+
+llvm::cl::opt<unsigned> Z3IncrementalCacheSize(
+    "z3-incremental-cache-size", llvm::cl::init(1 << 16),
+    llvm::cl::desc("Number of built Z3 expressions kept across queries with "
+                   "-z3-incremental (default=65536)"));
 }
 
 #include "llvm/Support/ErrorHandling.h"
@@ -46,7 +62,17 @@ namespace klee {
 
 class Z3SolverImpl : public SolverImpl {
 private:
+  /// A solver kept across queries, with one scope per asserted constraint
+  /// so that it can back up to the prefix shared with the next query.
+  struct IncrementalSolver {
+    ::Z3_solver solver;
+    std::vector<ref<Expr> > constraints;
+    uint64_t lastUse;
+  };
+
   Z3Builder *builder;
+  std::vector<IncrementalSolver> incrementalSolvers;
+  uint64_t queryCount;
   double timeout;
   SolverRunStatus runStatusCode;
   llvm::raw_fd_ostream* dumpedQueriesFile;
@@ -59,6 +85,9 @@ private:
                          std::vector<std::vector<unsigned char> > *values,
                          bool &hasSolution);
 bool validateZ3Model(::Z3_solver &theSolver, ::Z3_model &theModel);
+  void assertConstantArrays(::Z3_solver theSolver,
+                            const ConstantArrayFinder &constant_arrays);
+  ::Z3_solver getIncrementalSolver(const ConstraintManager &constraints);
 
 public:
   Z3SolverImpl();
@@ -96,7 +125,7 @@ Z3SolverImpl::Z3SolverImpl()
           /*z3LogInteractionFileArg=*/Z3LogInteractionFile.size() > 0
               ? Z3LogInteractionFile.c_str()
               : NULL)),
-      timeout(0.0), runStatusCode(SOLVER_RUN_STATUS_FAILURE),
+      queryCount(0), timeout(0.0), runStatusCode(SOLVER_RUN_STATUS_FAILURE),
       dumpedQueriesFile(0) {
   assert(builder && "unable to create Z3Builder");
   solverParameters = Z3_mk_params(builder->ctx);
@@ -125,6 +154,10 @@ Z3SolverImpl::Z3SolverImpl()
 }
 
 Z3SolverImpl::~Z3SolverImpl() {
+  for (std::vector<IncrementalSolver>::iterator
+         it = incrementalSolvers.begin(), ie = incrementalSolvers.end();
+       it != ie; ++it)
+    Z3_solver_dec_ref(builder->ctx, it->solver);
   Z3_params_dec_ref(builder->ctx, solverParameters);
   delete builder;
 
@@ -247,23 +280,30 @@ bool Z3SolverImpl::internalRunSolver(
     std::vector<std::vector<unsigned char> > *values, bool &hasSolution) {
 
   TimerStatIncrementer t(stats::queryTime);
-  // NOTE: Z3 will switch to using a slower solver internally if push/pop are
-  // used so for now it is likely that creating a new solver each time is the
-  // right way to go until Z3 changes its behaviour.
-  //
-  // TODO: Investigate using a custom tactic as described in
-  // https://github.com/klee/klee/issues/653
-  Z3_solver theSolver = Z3_mk_solver(builder->ctx);
-  Z3_solver_inc_ref(builder->ctx, theSolver);
-  Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+  ::Z3_solver theSolver;
+  ConstantArrayFinder constant_arrays_in_query;
+  if (Z3Incremental) {
+    // The constraints stay asserted, the rest of the query is popped
+    // once it has been answered.
+    theSolver = getIncrementalSolver(query.constraints);
+    Z3_solver_push(builder->ctx, theSolver);
+  } else {
+    // NOTE: Z3 will switch to using a slower solver internally if push/pop
+    // are used so by default a new solver is created for each query.
+    //
+    // TODO: Investigate using a custom tactic as described in
+    // https://github.com/klee/klee/issues/653
+    theSolver = Z3_mk_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, theSolver);
+    Z3_solver_set_params(builder->ctx, theSolver, solverParameters);
+    for (auto const &constraint : query.constraints) {
+      Z3_solver_assert(builder->ctx, theSolver, builder->construct(constraint));
+      constant_arrays_in_query.visit(constraint);
+    }
+  }
 
   runStatusCode = SOLVER_RUN_STATUS_FAILURE;
 
-  ConstantArrayFinder constant_arrays_in_query;
-  for (auto const &constraint : query.constraints) {
-    Z3_solver_assert(builder->ctx, theSolver, builder->construct(constraint));
-    constant_arrays_in_query.visit(constraint);
-  }
   ++stats::queries;
   if (objects)
     ++stats::queryCounterexamples;
@@ -271,15 +311,7 @@ bool Z3SolverImpl::internalRunSolver(
   Z3ASTHandle z3QueryExpr =
       Z3ASTHandle(builder->construct(query.expr), builder->ctx);
   constant_arrays_in_query.visit(query.expr);
-
-  for (auto const &constant_array : constant_arrays_in_query.results) {
-    assert(builder->constant_array_assertions.count(constant_array) == 1 &&
-           "Constant array found in query, but not handled by Z3Builder");
-    for (auto const &arrayIndexValueExpr :
-         builder->constant_array_assertions[constant_array]) {
-      Z3_solver_assert(builder->ctx, theSolver, arrayIndexValueExpr);
-    }
-  }
+  assertConstantArrays(theSolver, constant_arrays_in_query);
 
   // KLEE Queries are validity queries i.e.
   // ∀ X Constraints(X) → query(X)
@@ -303,13 +335,20 @@ bool Z3SolverImpl::internalRunSolver(
   runStatusCode = handleSolverResponse(theSolver, satisfiable, objects, values,
                                        hasSolution);
 
-  Z3_solver_dec_ref(builder->ctx, theSolver);
   // Clear the builder's cache to prevent memory usage exploding.
   // By using ``autoClearConstructCache=false`` and clearning now
   // we allow Z3_ast expressions to be shared from an entire
   // ``Query`` rather than only sharing within a single call to
-  // ``builder->construct()``.
-  builder->clearConstructCache();
+  // ``builder->construct()``. Incremental solving shares them across
+  // queries as well, up to a bound.
+  if (Z3Incremental) {
+    Z3_solver_pop(builder->ctx, theSolver, 1);
+    if (builder->getConstructCacheSize() > Z3IncrementalCacheSize)
+      builder->clearConstructCache();
+  } else {
+    Z3_solver_dec_ref(builder->ctx, theSolver);
+    builder->clearConstructCache();
+  }
 
   if (runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_SOLVABLE ||
       runStatusCode == SolverImpl::SOLVER_RUN_STATUS_SUCCESS_UNSOLVABLE) {
@@ -323,6 +362,81 @@ bool Z3SolverImpl::internalRunSolver(
   return false; // failed
 }
 
+void Z3SolverImpl::assertConstantArrays(
+    ::Z3_solver theSolver, const ConstantArrayFinder &constant_arrays) {
+  for (auto const &constant_array : constant_arrays.results) {
+    assert(builder->constant_array_assertions.count(constant_array) == 1 &&
+           "Constant array found in query, but not handled by Z3Builder");
+    for (auto const &arrayIndexValueExpr :
+         builder->constant_array_assertions[constant_array]) {
+      Z3_solver_assert(builder->ctx, theSolver, arrayIndexValueExpr);
+    }
+  }
+}
+
+/// Returns the kept solver sharing the longest prefix with \a constraints,
+/// with exactly \a constraints asserted. A new solver is made while there
+/// is room and none shares anything; otherwise the least recently used one
+/// starts over.
+::Z3_solver
+Z3SolverImpl::getIncrementalSolver(const ConstraintManager &constraints) {
+  IncrementalSolver *best = 0;
+  unsigned bestPrefix = 0;
+  for (std::vector<IncrementalSolver>::iterator
+         it = incrementalSolvers.begin(), ie = incrementalSolvers.end();
+       it != ie; ++it) {
+    unsigned prefix = 0;
+    ConstraintManager::const_iterator ci = constraints.begin();
+    for (unsigned n = std::min(it->constraints.size(), constraints.size());
+         prefix < n && it->constraints[prefix] == *ci; ++prefix, ++ci)
+      ;
+    if (!best || prefix > bestPrefix ||
+        (prefix == bestPrefix && it->lastUse > best->lastUse)) {
+      best = &*it;
+      bestPrefix = prefix;
+    }
+  }
+
+  if (bestPrefix == 0 && (incrementalSolvers.empty() ||
+                          incrementalSolvers.size() < Z3IncrementalSolvers)) {
+    IncrementalSolver s;
+    s.solver = Z3_mk_solver(builder->ctx);
+    Z3_solver_inc_ref(builder->ctx, s.solver);
+    incrementalSolvers.push_back(s);
+    best = &incrementalSolvers.back();
+  } else if (bestPrefix == 0) {
+    for (std::vector<IncrementalSolver>::iterator
+           it = incrementalSolvers.begin(), ie = incrementalSolvers.end();
+         it != ie; ++it)
+      if (it->lastUse < best->lastUse)
+        best = &*it;
+  }
+
+  // The timeout may have changed since the solver was made.
+  Z3_solver_set_params(builder->ctx, best->solver, solverParameters);
+  best->lastUse = ++queryCount;
+
+  if (best->constraints.size() > bestPrefix) {
+    Z3_solver_pop(builder->ctx, best->solver,
+                  best->constraints.size() - bestPrefix);
+    best->constraints.resize(bestPrefix);
+  }
+  stats::queryReusedConstraints += bestPrefix;
+
+  ConstraintManager::const_iterator ci = constraints.begin();
+  std::advance(ci, bestPrefix);
+  for (ConstraintManager::const_iterator ce = constraints.end(); ci != ce;
+       ++ci) {
+    Z3_solver_push(builder->ctx, best->solver);
+    Z3_solver_assert(builder->ctx, best->solver, builder->construct(*ci));
+    ConstantArrayFinder constant_arrays;
+    constant_arrays.visit(*ci);
+    assertConstantArrays(best->solver, constant_arrays);
+    best->constraints.push_back(*ci);
+  }
+  return best->solver;
+}
+
 SolverImpl::SolverRunStatus Z3SolverImpl::handleSolverResponse(
     ::Z3_solver theSolver, ::Z3_lbool satisfiable,
     const std::vector<const Array *> *objects,
@@ -0,0 +1,65 @@
+//===-- AsyncWriter.cpp ---------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+#include "klee/Internal/Support/AsyncWriter.h"
+
+#include <cassert>
+
+using namespace klee;
+
+AsyncWriter::AsyncWriter(unsigned _numThreads, size_t _maxPending)
+    : numThreads(_numThreads), maxPending(_maxPending), stopping(false) {
+  assert(numThreads > 0 && maxPending > 0);
+}
+
+AsyncWriter::~AsyncWriter() { flush(); }
+
+void AsyncWriter::submit(const std::function<void()> &job) {
+  std::unique_lock<std::mutex> guard(lock);
+  if (threads.empty())
+    for (unsigned i = 0; i < numThreads; ++i)
+      threads.push_back(std::thread(&AsyncWriter::work, this));
+  while (jobs.size() >= maxPending)
+    spaceAvailable.wait(guard);
+  jobs.push_back(job);
+  jobAvailable.notify_one();
+}
+
+void AsyncWriter::work() {
+  std::unique_lock<std::mutex> guard(lock);
+  for (;;) {
+    while (jobs.empty() && !stopping)
+      jobAvailable.wait(guard);
+    // Only stop once the queue is drained.
+    if (jobs.empty())
+      return;
+    std::function<void()> job;
+    job.swap(jobs.front());
+    jobs.pop_front();
+    spaceAvailable.notify_one();
+    guard.unlock();
+    job();
+    guard.lock();
+  }
+}
+
+void AsyncWriter::flush() {
+  std::vector<std::thread> running;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+    running.swap(threads);
+  }
+  jobAvailable.notify_all();
+  for (std::vector<std::thread>::iterator it = running.begin(),
+                                          ie = running.end();
+       it != ie; ++it)
+    it->join();
+  std::lock_guard<std::mutex> guard(lock);
+  stopping = false;
+}
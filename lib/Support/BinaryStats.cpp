@@ -0,0 +1,210 @@
+//===-- BinaryStats.cpp ---------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/Support/BinaryStats.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace klee;
+
+void StatsRecord::addInteger(const char *name, uint64_t value) {
+  Column c = { name, false };
+  columns.push_back(c);
+  values.push_back(value);
+}
+
+void StatsRecord::addReal(const char *name, double value) {
+  Column c = { name, true };
+  columns.push_back(c);
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  values.push_back(bits);
+}
+
+double StatsRecord::getReal(unsigned i) const {
+  double value;
+  memcpy(&value, &values[i], sizeof(value));
+  return value;
+}
+
+void StatsRecord::print(llvm::raw_ostream &os) const {
+  os << "(";
+  for (unsigned i = 0; i < columns.size(); ++i) {
+    if (i)
+      os << ",";
+    if (columns[i].isReal)
+      os << getReal(i);
+    else
+      os << values[i];
+  }
+  os << ")\n";
+}
+
+void StatsRecord::printHeader(llvm::raw_ostream &os) const {
+  os << "(";
+  for (unsigned i = 0; i < columns.size(); ++i)
+    os << "'" << columns[i].name << "',";
+  os << ")\n";
+}
+
+/***/
+
+static void writeU32(llvm::raw_ostream &os, uint32_t value) {
+  os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void binary_stats::writeHeader(llvm::raw_ostream &os,
+                               const StatsRecord &record) {
+  writeU32(os, Magic);
+  writeU32(os, Version);
+  writeU32(os, record.size());
+  for (unsigned i = 0; i < record.size(); ++i) {
+    const StatsRecord::Column &c = record.getColumn(i);
+    size_t length = strlen(c.name);
+    assert(length < 256 && "stats column name too long");
+    os << (char) c.isReal << (char) length;
+    os.write(c.name, length);
+  }
+}
+
+void binary_stats::writeRecord(llvm::raw_ostream &os,
+                               const StatsRecord &record) {
+  for (unsigned i = 0; i < record.size(); ++i) {
+    uint64_t value = record.getInteger(i);
+    os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+}
+
+/***/
+
+BinaryStatsReader::BinaryStatsReader()
+  : fd(-1), data(0), mappedSize(0), headerSize(0), numRecords(0) {}
+
+BinaryStatsReader::~BinaryStatsReader() {
+  unmap();
+  if (fd >= 0)
+    close(fd);
+}
+
+void BinaryStatsReader::unmap() {
+  if (data)
+    munmap(const_cast<char *>(data), mappedSize);
+  data = 0;
+  mappedSize = 0;
+  numRecords = 0;
+}
+
+bool BinaryStatsReader::open(const std::string &path, std::string &error) {
+  unmap();
+  if (fd >= 0)
+    close(fd);
+  columns.clear();
+  headerSize = 0;
+
+  fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = path + ": " + strerror(errno);
+    return false;
+  }
+  if (!refresh(error))
+    return false;
+
+  // Parse the schema.
+  size_t pos = 0;
+  uint32_t header[3];
+  if (mappedSize < sizeof(header)) {
+    error = path + ": truncated header";
+    return false;
+  }
+  memcpy(header, data, sizeof(header));
+  pos += sizeof(header);
+  if (header[0] != binary_stats::Magic) {
+    error = path + ": not a binary stats file (or of another byte order)";
+    return false;
+  }
+  if (header[1] != binary_stats::Version) {
+    error = path + ": unsupported binary stats version";
+    return false;
+  }
+
+  for (uint32_t i = 0; i < header[2]; ++i) {
+    if (pos + 2 > mappedSize ||
+        pos + 2 + (uint8_t) data[pos + 1] > mappedSize) {
+      error = path + ": truncated header";
+      return false;
+    }
+    Column c;
+    c.isReal = data[pos];
+    c.name.assign(data + pos + 2, (uint8_t) data[pos + 1]);
+    pos += 2 + c.name.size();
+    columns.push_back(c);
+  }
+  headerSize = pos;
+
+  return refresh(error);
+}
+
+bool BinaryStatsReader::refresh(std::string &error) {
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    error = strerror(errno);
+    return false;
+  }
+
+  unmap();
+  if (st.st_size == 0)
+    return true;
+  void *p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    error = strerror(errno);
+    return false;
+  }
+  data = static_cast<const char *>(p);
+  mappedSize = st.st_size;
+
+  size_t recordSize = columns.size() * 8;
+  if (headerSize && recordSize && mappedSize >= headerSize)
+    numRecords = (mappedSize - headerSize) / recordSize;
+  return true;
+}
+
+int BinaryStatsReader::getColumnIndex(const std::string &name) const {
+  for (unsigned i = 0; i < columns.size(); ++i)
+    if (columns[i].name == name)
+      return i;
+  return -1;
+}
+
+uint64_t BinaryStatsReader::getInteger(size_t record, unsigned column) const {
+  assert(record < numRecords && column < columns.size() && "out of range");
+  uint64_t value;
+  memcpy(&value, getSlot(record, column), sizeof(value));
+  return value;
+}
+
+double BinaryStatsReader::getReal(size_t record, unsigned column) const {
+  assert(record < numRecords && column < columns.size() && "out of range");
+  double value;
+  memcpy(&value, getSlot(record, column), sizeof(value));
+  return value;
+}
+
+double BinaryStatsReader::getValue(size_t record, unsigned column) const {
+  return columns[column].isReal ? getReal(record, column)
+                                : (double) getInteger(record, column);
+}
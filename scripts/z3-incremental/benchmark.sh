@@ -0,0 +1,45 @@
+#!/bin/bash
+#
+# Time kleaver with and without -z3-incremental and check that both give
+# the same answers.
+#
+# Usage: benchmark.sh <kleaver> [file.kquery...]
+#
+# Without files, the synthetic workload of generate-workload.py and the
+# .kquery files under test/Solver and test/Expr are used. Only the
+# Query N: VALID/INVALID lines are compared, as the unconstrained bytes of
+# a counterexample may differ between the modes.
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+SRC_DIR="$SCRIPT_DIR/../.."
+
+kleaver=${1:?usage: $0 <kleaver> [file.kquery...]}
+shift
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+if [ $# -eq 0 ]; then
+  python "$SCRIPT_DIR/generate-workload.py" > "$work/synthetic.kquery"
+  set -- "$work/synthetic.kquery" \
+         "$SRC_DIR"/test/Solver/*.kquery "$SRC_DIR"/test/Expr/*.kquery
+fi
+
+# The other solvers in the chain would hide most queries from Z3.
+common="-solver-backend=z3 -use-cex-cache=false -use-cache=false -use-independent-solver=false"
+
+TIMEFORMAT=%R
+printf "%-48s %10s %12s  %s\n" file default incremental answers
+for f in "$@"; do
+  t0=$( { time "$kleaver" $common "$f" > "$work/default.log" 2>&1; } 2>&1 ) || t0=error
+  t1=$( { time "$kleaver" $common -z3-incremental "$f" > "$work/incremental.log" 2>&1; } 2>&1 ) || t1=error
+  if diff <(grep "^Query" "$work/default.log") \
+          <(grep "^Query" "$work/incremental.log") > /dev/null; then
+    same=same
+  else
+    same=DIFFERENT
+  fi
+  printf "%-48s %10s %12s  %s\n" "$(basename "$f")" "$t0" "$t1" "$same"
+done
@@ -0,0 +1,52 @@
+#!/usr/bin/env python
+"""Generate the synthetic kQuery workload used to measure -z3-incremental.
+
+A number of paths over a shared 64-byte symbolic packet take a branch at
+every step. The condition of step i on path k multiplies a 16-bit field
+of the packet by a constant, xors it with another field and compares the
+result with a bound. The queries of the paths are interleaved, the way a
+searcher alternating between states would issue them: step i of a path
+asks whether its next condition follows from the i conditions before it.
+
+A last query per path asks whether all its conditions together are
+unsatisfiable. It answers INVALID, so every condition could be taken.
+"""
+
+from __future__ import print_function
+
+import argparse
+
+PACKET_SIZE = 64
+MULTIPLIER = 2654435761 & 0xffff
+
+
+def condition(step, path):
+    j = (step * 7 + path) % (PACKET_SIZE - 2)
+    value = '(Xor w16 (Mul w16 (ReadLSB w16 %d packet) %d) ' \
+            '(ReadLSB w16 %d packet))' % (j, MULTIPLIER, (j * 3 + 5) % 62)
+    return '(Ult %s %d)' % (value, 0xC000 + step + path)
+
+
+def query(constraints, expr):
+    return '(query [%s]\n       %s)' % ('\n        '.join(constraints), expr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--paths', type=int, default=2)
+    parser.add_argument('--steps', type=int, default=150)
+    args = parser.parse_args()
+
+    print('array packet[%d] : w32 -> w8 = symbolic' % PACKET_SIZE)
+    print()
+    for step in range(args.steps):
+        for path in range(args.paths):
+            prefix = [condition(i, path) for i in range(step)]
+            print(query(prefix, condition(step, path)))
+    for path in range(args.paths):
+        print(query([condition(i, path) for i in range(args.steps)], 'false'))
+    return 0
+
+
+if __name__ == '__main__':
+    exit(main())
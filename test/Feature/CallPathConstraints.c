@@ -0,0 +1,33 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.full.klee-out %t.omit.klee-out
+// RUN: %klee --output-dir=%t.full.klee-out --dump-call-traces %t.bc
+// RUN: FileCheck %s -check-prefix=CHECK -check-prefix=CHECK-FULL --input-file=%t.full.klee-out/test000001.call_path
+// RUN: %klee --output-dir=%t.omit.klee-out --dump-call-traces --omit-call-path-constraints %t.bc
+// RUN: FileCheck %s -check-prefix=CHECK -check-prefix=CHECK-OMIT --input-file=%t.omit.klee-out/test000001.call_path
+
+// Both formats have the same kQuery and calls sections, the constraints
+// are only repeated at the end of the full one.
+
+#include "klee/klee.h"
+
+int traced(int x) {
+  klee_trace_ret();
+  klee_trace_param_i32(x, "x");
+  return x + 1;
+}
+
+int main() {
+  int x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+  klee_assume(x > 10);
+  return traced(x) > 0;
+}
+
+// CHECK: ;;-- kQuery --
+// CHECK-NEXT: array x[4] : w32 -> w8 = symbolic
+// CHECK-NEXT: (query [(Slt
+// CHECK: ;;-- Calls --
+// CHECK-NEXT: {{[0-9]+}}:traced(x:(ReadLSB w32 0 x)) -> (Add w32 1
+// CHECK-NEXT: ;;-- Constraints --
+// CHECK-FULL-NEXT: (Slt
+// CHECK-OMIT-NOT: {{.}}
@@ -0,0 +1,37 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.limit.klee-out %t.error.klee-out
+// RUN: %klee --output-dir=%t.limit.klee-out --output-threads=2 --output-queue-size=1 --dump-call-traces --stop-after-n-tests=5 --dump-states-on-halt=false %t.bc
+// RUN: ls %t.limit.klee-out | grep -c "^test.*\.ktest$" | grep "^5$"
+// RUN: ls %t.limit.klee-out | grep "\.ktest$" | sed "s/\.ktest$//" > %t.limit.tests
+// RUN: ls %t.limit.klee-out | grep -e "\.call_path$" -e "\.err$" | sed "s/\..*$//" | sort | diff %t.limit.tests -
+// RUN: not %klee --output-dir=%t.error.klee-out --output-threads=2 --output-queue-size=1 --dump-call-traces --exit-on-error %t.bc
+// RUN: ls %t.error.klee-out | grep -c "\.assert\.err$" | grep "^1$"
+// RUN: ls %t.error.klee-out | grep "\.ktest$" | sed "s/\.ktest$//" > %t.error.tests
+// RUN: ls %t.error.klee-out | grep -e "\.call_path$" -e "\.err$" | sed "s/\..*$//" | sort | diff %t.error.tests -
+
+// With background output threads, every test case reported before the
+// run stops, whether through a limit or an error, is written in full: a
+// .ktest file, and a call path for the tests that did not fail.
+
+#include "klee/klee.h"
+
+#include <assert.h>
+
+unsigned traced(unsigned path) {
+  klee_trace_ret();
+  klee_trace_param_u32(path, "path");
+  return path;
+}
+
+int main() {
+  unsigned x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  unsigned path = 0, i;
+  for (i = 0; i < 4; ++i)
+    if (x & (1 << i))
+      path |= 1 << i;
+
+  assert(traced(path) != 9);
+  return 0;
+}
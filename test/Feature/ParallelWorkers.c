@@ -0,0 +1,41 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.serial.klee-out %t.parallel.klee-out
+// RUN: %klee --output-dir=%t.serial.klee-out %t.bc > %t.serial.log
+// RUN: %klee --output-dir=%t.parallel.klee-out --parallel-workers=2 --parallel-chunks=4 %t.bc > %t.parallel.log
+// RUN: FileCheck %s -check-prefix=CHECK-SPLIT --input-file=%t.parallel.klee-out/messages.txt
+// RUN: ls %t.serial.klee-out | grep -c "^test.*\.ktest$" | grep "^16$"
+// RUN: ls %t.parallel.klee-out | grep -c "^test.*\.ktest$" | grep "^16$"
+// RUN: test -f %t.parallel.klee-out/test000001.ktest
+// RUN: test -f %t.parallel.klee-out/test000016.ktest
+// RUN: ls %t.parallel.klee-out/chunk0000 | not grep "\.ktest$"
+// RUN: grep "generated tests = 16" %t.parallel.klee-out/info
+// RUN: sort %t.serial.log > %t.serial.sorted
+// RUN: sort %t.parallel.log | diff %t.serial.sorted -
+
+// Splitting the exploration among two workers gives the same paths as a
+// serial run, and the chunks' tests are merged into the output directory
+// with consecutive numbers.
+
+// CHECK-SPLIT: splitting {{[0-9]+}} states into 4 chunks for 2 workers
+
+#include "klee/klee.h"
+
+#include <stdio.h>
+
+int main() {
+  unsigned x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  unsigned path = 0, i;
+  for (i = 0; i < 4; ++i)
+    if (x & (1 << i))
+      path |= 1 << i;
+
+  // Keep every state busy long enough for the split to happen.
+  volatile unsigned spin = 0;
+  for (i = 0; i < 10000; ++i)
+    spin += i;
+
+  printf("path %u\n", path);
+  return 0;
+}
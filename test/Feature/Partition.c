@@ -0,0 +1,39 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.all.klee-out %t.p0.klee-out %t.p1.klee-out %t.p2.klee-out %t.merged.klee-out %t.timeout.klee-out %t.batching.klee-out
+// RUN: %klee --output-dir=%t.all.klee-out %t.bc > %t.all.log
+// RUN: %klee --output-dir=%t.p0.klee-out --partition=0/3 %t.bc > %t.parts.log
+// RUN: %klee --output-dir=%t.p1.klee-out --partition=1/3 %t.bc >> %t.parts.log
+// RUN: %klee --output-dir=%t.p2.klee-out --partition=2/3 %t.bc >> %t.parts.log
+// RUN: %klee --output-dir=%t.merged.klee-out --merge-partitions=%t.p0.klee-out,%t.p1.klee-out,%t.p2.klee-out
+// RUN: sort %t.all.log > %t.all.sorted
+// RUN: sort %t.parts.log | diff %t.all.sorted -
+// RUN: ls %t.all.klee-out | grep -c "^test.*\.ktest$" | grep "^16$"
+// RUN: ls %t.merged.klee-out | grep -c "^test.*\.ktest$" | grep "^16$"
+// RUN: test -f %t.merged.klee-out/test000016.ktest
+// RUN: grep "generated tests = 16" %t.merged.klee-out/info
+// RUN: not %klee --output-dir=%t.timeout.klee-out --partition=0/3 --max-solver-time=10 %t.bc 2>&1 | FileCheck %s -check-prefix=CHECK-TIMEOUT
+// RUN: not %klee --output-dir=%t.batching.klee-out --partition=0/3 --use-batching-search %t.bc 2>&1 | FileCheck %s -check-prefix=CHECK-BATCHING
+
+// Running every partition and merging their outputs gives the paths of an
+// unpartitioned run, each once. Options that make the exploration depend
+// on timing are rejected, since partitions could then split differently.
+
+// CHECK-TIMEOUT: --partition cannot be used with --max-solver-time
+// CHECK-BATCHING: --partition cannot be used with --use-batching-search
+
+#include "klee/klee.h"
+
+#include <stdio.h>
+
+int main() {
+  unsigned x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  unsigned path = 0, i;
+  for (i = 0; i < 4; ++i)
+    if (x & (1 << i))
+      path |= 1 << i;
+
+  printf("path %u\n", path);
+  return 0;
+}
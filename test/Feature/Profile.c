@@ -0,0 +1,35 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -c -o %t.bc
+// RUN: rm -rf %t.klee-out %t.parallel.klee-out
+// RUN: %klee --output-dir=%t.klee-out --profile --profile-interval=100 %t.bc
+// RUN: FileCheck %s --input-file=%t.klee-out/run.folded
+// RUN: not grep -v -E "^klee(;[^ ;]+)* [0-9]+$" %t.klee-out/run.folded
+// RUN: %klee --output-dir=%t.parallel.klee-out --profile --profile-interval=100 --parallel-workers=2 --parallel-chunks=2 %t.bc
+// RUN: FileCheck %s --input-file=%t.parallel.klee-out/run.folded
+// RUN: FileCheck %s --input-file=%t.parallel.klee-out/chunk0000/run.folded
+// RUN: FileCheck %s --input-file=%t.parallel.klee-out/chunk0001/run.folded
+// RUN: not grep -v -E "^klee(;[^ ;]+)* [0-9]+$" %t.parallel.klee-out/chunk0000/run.folded
+
+// Every sample is written as a folded stack below "klee", with its count.
+// Processes forked for --parallel-workers sample again from the fork on
+// and write their own profile into their chunk directory.
+
+// CHECK: {{^}}klee;interpret {{[0-9]+$}}
+
+#include "klee/klee.h"
+
+int main() {
+  unsigned x;
+  klee_make_symbolic(&x, sizeof(x), "x");
+
+  unsigned path = 0, i;
+  for (i = 0; i < 4; ++i)
+    if (x & (1 << i))
+      path |= 1 << i;
+
+  // Spend long enough interpreting for the sampler to see it.
+  volatile unsigned spin = 0;
+  for (i = 0; i < 50000; ++i)
+    spin += i;
+
+  return path;
+}
@@ -0,0 +1,86 @@
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -DONE_OBJECT -c -o %t1.bc
+// RUN: rm -rf %t1.klee-out
+// RUN: %klee --output-dir=%t1.klee-out %t1.bc > %t1.log 2> %t1.stderr.log
+// RUN: FileCheck %s -check-prefix=CHECK-ONE --input-file=%t1.log
+// RUN: not grep "memory error" %t1.stderr.log
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -DMANY_OBJECTS -c -o %t2.bc
+// RUN: rm -rf %t2.klee-out
+// RUN: %klee --output-dir=%t2.klee-out %t2.bc > %t2.log 2> %t2.stderr.log
+// RUN: sort %t2.log | FileCheck %s -check-prefix=CHECK-MANY
+// RUN: not grep "memory error" %t2.stderr.log
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -DSOME_OBJECTS -c -o %t3.bc
+// RUN: rm -rf %t3.klee-out
+// RUN: %klee --output-dir=%t3.klee-out %t3.bc > %t3.log 2> %t3.stderr.log
+// RUN: sort %t3.log | FileCheck %s -check-prefix=CHECK-SOME
+// RUN: not grep "memory error" %t3.stderr.log
+// RUN: %llvmgcc %s -emit-llvm -g -O0 -DNO_OBJECT -c -o %t4.bc
+// RUN: rm -rf %t4.klee-out
+// RUN: %klee --output-dir=%t4.klee-out %t4.bc > %t4.log 2> %t4.stderr.log
+// RUN: not grep "hit" %t4.log
+// RUN: FileCheck %s -check-prefix=CHECK-NONE --input-file=%t4.stderr.log
+
+// Symbolic pointers resolving to none, one and several of a handful of
+// objects. The objects are interleaved with fillers, so the candidates
+// between the feasible ones have to be ruled out.
+
+#include "klee/klee.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_OBJECTS 3
+#define NUM_FILLERS 16
+
+int main() {
+  char *objects[NUM_OBJECTS];
+  char *fillers[NUM_OBJECTS * NUM_FILLERS];
+  unsigned i, j;
+  for (i = 0; i < NUM_OBJECTS; ++i) {
+    objects[i] = malloc(10);
+    memset(objects[i], i, 10);
+    for (j = 0; j < NUM_FILLERS; ++j)
+      fillers[i * NUM_FILLERS + j] = malloc(10);
+  }
+
+  unsigned s = klee_range(0, NUM_OBJECTS, "s");
+  char c;
+#if defined(ONE_OBJECT)
+  // The bounds of the pointer take in several objects, the constraints
+  // only the first one.
+  unsigned k;
+  klee_make_symbolic(&k, sizeof(k), "k");
+  k &= 0xffff;
+  klee_assume(k < 10);
+  c = objects[0][k];
+#elif defined(MANY_OBJECTS)
+  // The pointer is read from memory, so its structure does not bound it
+  // and every object is a candidate.
+  c = objects[s][9];
+#elif defined(SOME_OBJECTS)
+  // The first and last objects, but not the one between them.
+  klee_assume(s != 1);
+  c = objects[s][9];
+#elif defined(NO_OBJECT)
+  // CHECK-NONE: SymbolicPointerResolution.c:[[@LINE+1]]: memory error: out of bound pointer
+  c = *(objects[s] - 1);
+#endif
+
+  // CHECK-ONE: hit 0
+  // CHECK-ONE-NOT: hit
+
+  // CHECK-MANY: hit 0
+  // CHECK-MANY-NEXT: hit 1
+  // CHECK-MANY-NEXT: hit 2
+
+  // CHECK-SOME: hit 0
+  // CHECK-SOME-NEXT: hit 2
+  // CHECK-SOME-NOT: hit
+  if (c == 0)
+    printf("hit 0\n");
+  else if (c == 1)
+    printf("hit 1\n");
+  else
+    printf("hit 2\n");
+  return 0;
+}
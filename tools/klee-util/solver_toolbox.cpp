@@ -2,12 +2,101 @@
 #include "printer.h"
 #include "retrieve_symbols.h"
 
+#include "llvm/Support/CommandLine.h"
+
 #include <iostream>
 
+namespace {
+llvm::cl::opt<std::string> QueryCache(
+    "query-cache",
+    llvm::cl::desc("Cache solver query results in this file, shared by "
+                   "all the runs and tools using it (default=off)"),
+    llvm::cl::init(""));
+}
+
 namespace kutil {
 
 solver_toolbox_t solver_toolbox;
 
+solver_toolbox_t::~solver_toolbox_t() {
+  // Deleting the chain writes the query cache back.
+  delete solver;
+  delete exprBuilder;
+}
+
+void solver_toolbox_t::build() {
+  if (solver != nullptr) {
+    return;
+  }
+
+  solver = klee::createCoreSolver(klee::Z3_SOLVER);
+  assert(solver);
+
+  solver = createCexCachingSolver(solver);
+  // Below the in-memory cache, so that only its misses are hashed.
+  if (!QueryCache.empty()) {
+    solver = klee::createPersistentCachingSolver(solver, QueryCache);
+  }
+  solver = createCachingSolver(solver);
+  // Queries from different call paths name their symbols differently.
+  solver = klee::createCanonicalizingSolver(solver);
+  solver = createIndependentSolver(solver);
+
+  exprBuilder = klee::createDefaultExprBuilder();
+}
+
+bool solver_toolbox_t::rename_key_t::operator<(
+    const rename_key_t &other) const {
+  if (constraints.size() != other.constraints.size()) {
+    return constraints.size() < other.constraints.size();
+  }
+  if (symbols.size() != other.symbols.size()) {
+    return symbols.size() < other.symbols.size();
+  }
+  for (auto i = 0u; i < constraints.size(); i++) {
+    if (constraints[i].get() != other.constraints[i].get()) {
+      return constraints[i].get() < other.constraints[i].get();
+    }
+  }
+  for (auto i = 0u; i < symbols.size(); i++) {
+    if (symbols[i].get() != other.symbols[i].get()) {
+      return symbols[i].get() < other.symbols[i].get();
+    }
+  }
+  return false;
+}
+
+klee::ConstraintManager
+solver_toolbox_t::rename_constraints(const klee::ConstraintManager &constraints,
+                                     klee::ref<klee::Expr> expr) const {
+  RetrieveSymbols retriever;
+  retriever.visit(expr);
+
+  rename_key_t key;
+  key.constraints.assign(constraints.begin(), constraints.end());
+  key.symbols = retriever.get_retrieved();
+
+  auto found = renamed_constraints.find(key);
+  if (found != renamed_constraints.end()) {
+    return found->second;
+  }
+
+  // Keep the memory bounded; the entries pin their expressions.
+  if (renamed_constraints.size() >= 1 << 16) {
+    renamed_constraints.clear();
+  }
+
+  ReplaceSymbols replacer(key.symbols);
+
+  klee::ConstraintManager renamed;
+  for (auto c : constraints) {
+    renamed.addConstraint(replacer.visit(c));
+  }
+
+  renamed_constraints.insert({key, renamed});
+  return renamed;
+}
+
 klee::ref<klee::Expr>
 solver_toolbox_t::create_new_symbol(const std::string &symbol_name,
                                     klee::Expr::Width width) const {
@@ -42,18 +131,7 @@ bool solver_toolbox_t::is_expr_always_true(klee::ref<klee::Expr> expr) const {
 
 bool solver_toolbox_t::is_expr_always_true(klee::ConstraintManager constraints,
                                            klee::ref<klee::Expr> expr) const {
-  RetrieveSymbols retriever;
-  retriever.visit(expr);
-  auto symbols = retriever.get_retrieved();
-
-  ReplaceSymbols replacer(symbols);
-
-  klee::ConstraintManager renamed_constraints;
-  for (auto c : constraints) {
-    renamed_constraints.addConstraint(replacer.visit(c));
-  }
-
-  klee::Query sat_query(renamed_constraints, expr);
+  klee::Query sat_query(rename_constraints(constraints, expr), expr);
 
   bool result;
   bool success = solver->mustBeTrue(sat_query, result);
@@ -64,18 +142,7 @@ bool solver_toolbox_t::is_expr_always_true(klee::ConstraintManager constraints,
 
 bool solver_toolbox_t::is_expr_maybe_true(klee::ConstraintManager constraints,
                                           klee::ref<klee::Expr> expr) const {
-  RetrieveSymbols retriever;
-  retriever.visit(expr);
-  auto symbols = retriever.get_retrieved();
-
-  ReplaceSymbols replacer(symbols);
-
-  klee::ConstraintManager renamed_constraints;
-  for (auto c : constraints) {
-    renamed_constraints.addConstraint(replacer.visit(c));
-  }
-
-  klee::Query sat_query(renamed_constraints, expr);
+  klee::Query sat_query(rename_constraints(constraints, expr), expr);
 
   bool result;
   bool success = solver->mayBeTrue(sat_query, result);
@@ -86,18 +153,7 @@ bool solver_toolbox_t::is_expr_maybe_true(klee::ConstraintManager constraints,
 
 bool solver_toolbox_t::is_expr_maybe_false(klee::ConstraintManager constraints,
                                            klee::ref<klee::Expr> expr) const {
-  RetrieveSymbols retriever;
-  retriever.visit(expr);
-  auto symbols = retriever.get_retrieved();
-
-  ReplaceSymbols replacer(symbols);
-
-  klee::ConstraintManager renamed_constraints;
-  for (auto c : constraints) {
-    renamed_constraints.addConstraint(replacer.visit(c));
-  }
-
-  klee::Query sat_query(renamed_constraints, expr);
+  klee::Query sat_query(rename_constraints(constraints, expr), expr);
 
   bool result;
   bool success = solver->mayBeFalse(sat_query, result);
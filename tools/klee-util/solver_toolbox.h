@@ -4,6 +4,9 @@
 #include "klee/Solver.h"
 #include "klee/util/ArrayCache.h"
 
+#include <map>
+#include <vector>
+
 #include "../load-call-paths/load-call-paths.h"
 
 #include "replace_symbols.h"
@@ -15,22 +18,31 @@ struct solver_toolbox_t {
   klee::ExprBuilder *exprBuilder;
   klee::ArrayCache arr_cache;
 
-  solver_toolbox_t() : solver(nullptr) {}
+  /// A constraint set and the symbols renamed into it, compared by
+  /// identity. Holding the references keeps the identities unique.
+  struct rename_key_t {
+    std::vector<klee::ref<klee::Expr>> constraints;
+    std::vector<klee::ref<klee::ReadExpr>> symbols;
+
+    bool operator<(const rename_key_t &other) const;
+  };
 
-  void build() {
-    if (solver != nullptr) {
-      return;
-    }
+  /// The constraint sets renamed into the symbols of the queried
+  /// expressions, as call paths ask many questions in the same context.
+  mutable std::map<rename_key_t, klee::ConstraintManager> renamed_constraints;
 
-    solver = klee::createCoreSolver(klee::Z3_SOLVER);
-    assert(solver);
+  solver_toolbox_t() : solver(nullptr), exprBuilder(nullptr) {}
+  ~solver_toolbox_t();
 
-    solver = createCexCachingSolver(solver);
-    solver = createCachingSolver(solver);
-    solver = createIndependentSolver(solver);
+  /// Build the solver chain, on first use. With --query-cache, results
+  /// are also cached on disk and saved when the toolbox is destroyed at
+  /// exit, i.e. only if the tool returns from main() or calls exit().
+  void build();
 
-    exprBuilder = klee::createDefaultExprBuilder();
-  }
+  /// The constraints with the symbols of expr renamed into them.
+  klee::ConstraintManager
+  rename_constraints(const klee::ConstraintManager &constraints,
+                     klee::ref<klee::Expr> expr) const;
 
   klee::ref<klee::Expr> create_new_symbol(const std::string &symbol_name,
                                           klee::Expr::Width width) const;
@@ -9,11 +9,13 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "klee/CallPrefixTree.h"
 #include "klee/Config/Version.h"
 #include "klee/ExecutionState.h"
 #include "klee/Expr.h"
 #include "klee/Internal/ADT/KTest.h"
 #include "klee/Internal/ADT/TreeStream.h"
+#include "klee/Internal/Support/AsyncWriter.h"
 #include "klee/Internal/Support/Debug.h"
 #include "klee/Internal/Support/ErrorHandling.h"
 #include "klee/Internal/Support/FileHandling.h"
@@ -53,6 +55,7 @@
 #include <sys/stat.h>
 #include <sys/wait.h>
 
+#include <atomic>
 #include <cerrno>
 #include <fstream>
 #include <iomanip>
@@ -60,6 +63,8 @@
 #include <sstream>
 #include <list>
 #include <iostream>
+#include <memory>
+#include <mutex>
 
 using namespace llvm;
 using namespace klee;
@@ -166,6 +171,14 @@ DumpCallTraces("dump-call-traces",
                         "klee_trace_ret* intrinsic labels."),
                cl::init(false));
 
+cl::opt<bool>
+OmitCallPathConstraints("omit-call-path-constraints",
+                        cl::desc("In .call_path files, leave the section "
+                                 "after \";;-- Constraints --\" empty. It "
+                                 "repeats the constraints of the kQuery "
+                                 "section (default=off)."),
+                        cl::init(false));
+
 cl::opt<bool> CondoneUndeclaredHavocs(
     "condone-undeclared-havocs",
     cl::desc("Do not throw an error if a memory location changes "
@@ -215,38 +228,90 @@ StopAfterNTests("stop-after-n-tests",
                          "explored paths will also be dumped."),
                 cl::init(0));
 
+cl::opt<unsigned>
+OutputThreads("output-threads",
+              cl::desc("Write test cases and call paths from this many "
+                       "background threads (default=0 (off))"),
+              cl::init(0));
+
+cl::opt<unsigned>
+OutputQueueSize("output-queue-size",
+                cl::desc("Number of pending outputs after which the "
+                         "interpreter waits for --output-threads "
+                         "(default=64)"),
+                cl::init(64));
+
 cl::opt<bool>
 Watchdog("watchdog", cl::desc("Use a watchdog process to enforce --max-time."),
          cl::init(0));
+
+cl::opt<std::string>
+Partition("partition",
+          cl::desc("Only explore slice K of N of the execution tree (K/N, "
+                   "0 <= K < N). Use --merge-partitions to combine the "
+                   "output directories of all N runs. The runs have to "
+                   "explore alike up to the split, so options that depend "
+                   "on timing are rejected."));
+
+cl::list<std::string>
+MergePartitions("merge-partitions", cl::CommaSeparated,
+                cl::desc("Merge the given output directories of a "
+                         "--partition run into a new output directory and "
+                         "exit"),
+                cl::value_desc("dir1,dir2,..."));
 }
 
 extern cl::opt<double> MaxTime;
+extern cl::opt<unsigned> ParallelWorkers;
 
 class KleeHandler;
 
-struct CallPathTip {
-  CallInfo call;
+/// A textual copy of a CallTree. It does not refer to any expression of
+/// the process that built it, so the call-prefix trees of separately
+/// explored chunks can be written to disk and merged.
+class CallTreeImage {
+  std::string call;       // dumpCallInfoSExpr() of the tip call
+  std::string invocation; // equal iff the tip calls are sameInvocation()
   unsigned path_id;
+  unsigned line;
+  std::vector<CallTreeImage *> children;
+
+  std::vector<std::vector<const CallTreeImage *>> groupChildren() const;
+
+public:
+  CallTreeImage() : path_id(0), line(0) {}
+  CallTreeImage(const std::string &_call, const std::string &_invocation,
+                unsigned _path_id, unsigned _line)
+      : call(_call), invocation(_invocation), path_id(_path_id), line(_line) {}
+  ~CallTreeImage();
+
+  CallTreeImage *addChild(const CallInfo &ci, unsigned path_id);
+  /// Add the paths of another tree, shifting its call path ids by
+  /// \p pathIdBase.
+  void absorb(const CallTreeImage &other, unsigned pathIdBase);
+
+  void write(llvm::raw_ostream &file, unsigned depth = 0) const;
+  bool read(const std::string &path);
+
+  void dumpCallPrefixesSExpr(std::list<const CallTreeImage *> &prefix,
+                             KleeHandler *fileOpener) const;
 };
 
-class CallTree {
-  std::vector<CallTree *> children;
-  CallPathTip tip;
-  std::vector<std::vector<CallPathTip *>> groupChildren();
+/// The call prefixes of the run. With flushing on, the prefixes of a
+/// subtree are written as soon as no state can extend it.
+class CallTree : public CallPrefixTree {
+  KleeHandler *fileOpener;
+
+  std::vector<std::vector<const Node *>> groupChildren(const Node &n) const;
+  void buildImage(const Node &n, CallTreeImage &image) const;
+
+protected:
+  void flush(const Node &n);
 
 public:
-  CallTree() : children(), tip() {};
-  void addCallPath(std::vector<CallInfo>::const_iterator path_begin,
-                   std::vector<CallInfo>::const_iterator path_end,
-                   unsigned path_id);
-  void dumpCallPrefixes(
-      std::list<CallInfo> accumulated_prefix,
-      std::list<const std::vector<ref<Expr>> *> accumulated_context,
-      KleeHandler *fileOpener);
-  void dumpCallPrefixesSExpr(std::list<CallInfo> accumulated_prefix,
-                             KleeHandler *fileOpener);
-
-  int refCount;
+  explicit CallTree(KleeHandler *_fileOpener) : fileOpener(_fileOpener) {}
+
+  void buildImage(CallTreeImage &image) const { buildImage(*getRoot(), image); }
 };
 
 /***/
@@ -260,7 +325,8 @@ private:
   SmallString<128> m_outputDirectory;
 
   unsigned m_numTotalTests;     // Number of tests received from the interpreter
-  unsigned m_numGeneratedTests; // Number of tests successfully generated
+  // Number of tests successfully generated, updated by the output threads
+  std::atomic<unsigned> m_numGeneratedTests;
   unsigned m_pathsExplored;     // number of paths explored so far
   unsigned m_callPathIndex;     // number of call path strings dumped so far
   unsigned m_callPathPrefixIndex; // number of call path strings dumped so far
@@ -271,26 +337,63 @@ private:
 
   CallTree m_callTree;
 
+  // Writes outputs in the background, null when --output-threads is off.
+  AsyncWriter *m_writer;
+  // Warnings of output jobs, which the interpreter thread reports because
+  // klee_warning() is not thread-safe.
+  std::mutex m_outputWarningsLock;
+  std::vector<std::string> m_outputWarnings;
+
+  // Set in the process exploring one chunk of a split exploration.
+  int m_chunk;
+  // Set in a --partition run.
+  int m_partition;
+  // Paths finished before the partitions were split are left to partition 0.
+  bool m_discardOutputs;
+  // Directories merged into this one and the call path id offset of each.
+  std::vector<std::pair<std::string, unsigned>> m_mergedOutputs;
+
+  std::string getChunkDirectory(unsigned chunk);
+
 public:
   KleeHandler(int argc, char **argv);
   ~KleeHandler();
 
   llvm::raw_ostream &getInfoStream() const { return *m_infoFile; }
   /// Returns the number of test cases successfully generated so far
-  unsigned getNumTestCases() { return m_numGeneratedTests; }
+  unsigned getNumTestCases() { return m_numGeneratedTests.load(); }
   unsigned getNumPathsExplored() { return m_pathsExplored; }
-  void incPathsExplored() { m_pathsExplored++; }
+  void incPathsExplored() {
+    if (!m_discardOutputs)
+      m_pathsExplored++;
+  }
 
   void setInterpreter(Interpreter *i);
 
   void processTestCase(const ExecutionState &state, const char *errorMessage,
                        const char *errorSuffix);
   void processCallPath(const ExecutionState &state);
+  CallPrefixTree *getCallPrefixTree();
+  void flushOutputs();
+
+  void beginChunk(unsigned chunk, unsigned numChunks);
+  void mergeChunks(unsigned numChunks);
+  void setPartition(unsigned partition);
+  void beginPartition(unsigned partition, unsigned numPartitions);
+  /// Move (or copy) the numbered outputs of a chunk or partition directory
+  /// into this one, after those already there.
+  bool mergeOutputDirectory(const std::string &directory, bool move);
 
   std::string getOutputFilename(const std::string &filename);
   llvm::raw_fd_ostream *openOutputFile(const std::string &filename);
   std::string getTestFilename(const std::string &suffix, unsigned id);
   llvm::raw_fd_ostream *openTestFile(const std::string &suffix, unsigned id);
+  /// Write an output file, in the background if --output-threads is set.
+  void writeOutputFile(const std::string &filename, std::string &contents);
+  void runOutputJob(const std::function<void()> &job);
+  /// Called by output jobs instead of klee_warning().
+  void addOutputWarning(const std::string &warning);
+  void reportOutputWarnings();
 
   // load a .path file
   static void loadPathFile(std::string name, std::vector<bool> &buffer);
@@ -303,13 +406,17 @@ public:
 
   void dumpCallPathPrefixes();
   void dumpCallPath(const ExecutionState &state, llvm::raw_ostream *file);
+  void dumpCalls(const ExecutionState &state, llvm::raw_ostream &file);
 };
 
 KleeHandler::KleeHandler(int argc, char **argv)
     : m_interpreter(0), m_pathWriter(0), m_symPathWriter(0), m_infoFile(0),
       m_outputDirectory(), m_numTotalTests(0), m_numGeneratedTests(0),
       m_pathsExplored(0), m_callPathIndex(1), m_callPathPrefixIndex(0),
-      m_argc(argc), m_argv(argv) {
+      m_argc(argc), m_argv(argv), m_callTree(this), m_writer(0), m_chunk(-1),
+      m_partition(-1), m_discardOutputs(false) {
+  // Split or partitioned runs merge whole trees once all parts are done.
+  m_callTree.setFlushing(ParallelWorkers == 0 && Partition.empty());
 
   // create output directory (OutputDir or "klee-out-<i>")
   bool dir_given = OutputDir != "";
@@ -384,9 +491,24 @@ KleeHandler::KleeHandler(int argc, char **argv)
 
   // open info
   m_infoFile = openOutputFile("info");
+
+  if (OutputThreads)
+    m_writer = new AsyncWriter(OutputThreads,
+                               std::max(1u, OutputQueueSize.getValue()));
 }
 
 KleeHandler::~KleeHandler() {
+  delete m_writer;
+  reportOutputWarnings();
+  if (m_chunk >= 0 || m_partition >= 0) {
+    // Read back by mergeOutputDirectory().
+    llvm::raw_fd_ostream *summary = openOutputFile("merge.summary");
+    if (summary) {
+      *summary << m_numTotalTests << " " << m_numGeneratedTests.load() << " "
+               << m_pathsExplored << " " << m_callPathIndex - 1 << "\n";
+      delete summary;
+    }
+  }
   delete m_pathWriter;
   delete m_symPathWriter;
   fclose(klee_warning_file);
@@ -410,27 +532,217 @@ void KleeHandler::setInterpreter(Interpreter *i) {
   }
 }
 
+std::string KleeHandler::getChunkDirectory(unsigned chunk) {
+  std::stringstream dirname;
+  dirname << "chunk" << std::setfill('0') << std::setw(4) << chunk;
+  return getOutputFilename(dirname.str());
+}
+
+void KleeHandler::beginChunk(unsigned chunk, unsigned numChunks) {
+  std::string directory = getChunkDirectory(chunk);
+  if (mkdir(directory.c_str(), 0775) < 0)
+    klee_error("cannot create \"%s\": %s", directory.c_str(), strerror(errno));
+  m_outputDirectory = directory;
+  m_chunk = chunk;
+
+  // Numbering restarts in every chunk, mergeChunks() shifts it afterwards.
+  m_numTotalTests = 0;
+  m_numGeneratedTests = 0;
+  m_pathsExplored = 0;
+  m_callPathIndex = 1;
+  m_callPathPrefixIndex = 0;
+  m_callTree.forgetPaths();
+
+  fclose(klee_warning_file);
+  fclose(klee_message_file);
+  std::string file_path = getOutputFilename("warnings.txt");
+  if ((klee_warning_file = fopen(file_path.c_str(), "w")) == NULL)
+    klee_error("cannot open file \"%s\": %s", file_path.c_str(),
+               strerror(errno));
+  file_path = getOutputFilename("messages.txt");
+  if ((klee_message_file = fopen(file_path.c_str(), "w")) == NULL)
+    klee_error("cannot open file \"%s\": %s", file_path.c_str(),
+               strerror(errno));
+
+  delete m_infoFile;
+  m_infoFile = openOutputFile("info");
+  *m_infoFile << "KLEE: exploring chunk " << chunk << " of " << numChunks
+              << "\n";
+}
+
+// Split "<prefix><id>.<suffix>" into id and suffix.
+static bool parseNumberedFilename(const std::string &name,
+                                  const std::string &prefix, unsigned &id,
+                                  std::string &suffix) {
+  if (name.compare(0, prefix.size(), prefix))
+    return false;
+  size_t dot = name.find('.', prefix.size());
+  if (dot == std::string::npos || dot == prefix.size())
+    return false;
+  std::string digits = name.substr(prefix.size(), dot - prefix.size());
+  if (digits.find_first_not_of("0123456789") != std::string::npos)
+    return false;
+  id = atoi(digits.c_str());
+  suffix = name.substr(dot + 1);
+  return true;
+}
+
+static bool copyFile(const std::string &from, const std::string &to) {
+  std::ifstream in(from.c_str(), std::ios::in | std::ios::binary);
+  std::ofstream out(to.c_str(), std::ios::out | std::ios::binary);
+  if (!in.good() || !out.good())
+    return false;
+  if (in.peek() != std::ifstream::traits_type::eof())
+    out << in.rdbuf();
+  return !out.fail();
+}
+
+bool KleeHandler::mergeOutputDirectory(const std::string &directory,
+                                       bool move) {
+  unsigned tests, generated, paths, callPaths;
+  std::ifstream summary((directory + "/merge.summary").c_str());
+  if (!(summary >> tests >> generated >> paths >> callPaths))
+    return false;
+
+  // Ids continue after those already present here, so merging in a fixed
+  // order gives a deterministic numbering.
+  unsigned testBase = m_numTotalTests;
+  unsigned callPathBase = m_callPathIndex - 1;
+#if LLVM_VERSION_CODE < LLVM_VERSION(3, 5)
+  error_code ec;
+#else
+  std::error_code ec;
+#endif
+  for (llvm::sys::fs::directory_iterator i(directory, ec), e; i != e && !ec;
+       i.increment(ec)) {
+    std::string name = llvm::sys::path::filename((*i).path()).str();
+    std::string suffix, target;
+    unsigned id;
+    if (parseNumberedFilename(name, "test", id, suffix)) {
+      target = getOutputFilename(getTestFilename(suffix, testBase + id));
+    } else if (parseNumberedFilename(name, "call-path", id, suffix)) {
+      std::stringstream filename;
+      filename << "call-path" << std::setfill('0') << std::setw(6)
+               << callPathBase + id << '.' << suffix;
+      target = getOutputFilename(filename.str());
+    } else {
+      continue;
+    }
+    bool done = move ? rename((*i).path().c_str(), target.c_str()) == 0
+                     : copyFile((*i).path(), target);
+    if (!done)
+      klee_warning("cannot %s \"%s\": %s", move ? "move" : "copy",
+                   (*i).path().c_str(), strerror(errno));
+  }
+  if (ec)
+    klee_warning("unable to read directory: %s: %s", directory.c_str(),
+                 ec.message().c_str());
+
+  m_mergedOutputs.push_back(std::make_pair(directory, callPathBase));
+  m_numTotalTests += tests;
+  m_numGeneratedTests += generated;
+  m_pathsExplored += paths;
+  m_callPathIndex += callPaths;
+  return true;
+}
+
+void KleeHandler::mergeChunks(unsigned numChunks) {
+  for (unsigned chunk = 0; chunk < numChunks; ++chunk)
+    if (!mergeOutputDirectory(getChunkDirectory(chunk), true))
+      klee_warning("chunk %u did not finish, its outputs are not merged",
+                   chunk);
+}
+
+void KleeHandler::setPartition(unsigned partition) {
+  m_partition = partition;
+  m_discardOutputs = partition != 0;
+}
+
+void KleeHandler::beginPartition(unsigned partition, unsigned numPartitions) {
+  m_discardOutputs = false;
+  *m_infoFile << "KLEE: exploring partition " << partition << " of "
+              << numPartitions << "\n";
+}
+
 std::string KleeHandler::getOutputFilename(const std::string &filename) {
   SmallString<128> path = m_outputDirectory;
   sys::path::append(path, filename);
   return path.str();
 }
 
-llvm::raw_fd_ostream *KleeHandler::openOutputFile(const std::string &filename) {
+// Returns null and sets \a warning if the file cannot be opened.
+static llvm::raw_fd_ostream *openOutputPath(std::string path,
+                                            std::string &warning) {
   llvm::raw_fd_ostream *f;
   std::string Error;
-  std::string path = getOutputFilename(filename);
   f = klee_open_output_file(path, Error);
   if (!Error.empty()) {
-    klee_warning("error opening file \"%s\".  KLEE may have run out of file "
-                 "descriptors: try to increase the maximum number of open file "
-                 "descriptors by using ulimit (%s).",
-                 path.c_str(), Error.c_str());
+    warning = "error opening file \"" + path + "\".  KLEE may have run out "
+              "of file descriptors: try to increase the maximum number of "
+              "open file descriptors by using ulimit (" + Error + ").";
     return NULL;
   }
   return f;
 }
 
+llvm::raw_fd_ostream *KleeHandler::openOutputFile(const std::string &filename) {
+  std::string warning;
+  llvm::raw_fd_ostream *f =
+      openOutputPath(getOutputFilename(filename), warning);
+  if (!f)
+    klee_warning("%s", warning.c_str());
+  return f;
+}
+
+void KleeHandler::runOutputJob(const std::function<void()> &job) {
+  if (m_writer)
+    m_writer->submit(job);
+  else
+    job();
+  reportOutputWarnings();
+}
+
+void KleeHandler::addOutputWarning(const std::string &warning) {
+  std::lock_guard<std::mutex> guard(m_outputWarningsLock);
+  m_outputWarnings.push_back(warning);
+}
+
+void KleeHandler::reportOutputWarnings() {
+  std::vector<std::string> warnings;
+  {
+    std::lock_guard<std::mutex> guard(m_outputWarningsLock);
+    warnings.swap(m_outputWarnings);
+  }
+  for (std::vector<std::string>::iterator i = warnings.begin(),
+                                          e = warnings.end();
+       i != e; ++i)
+    klee_warning("%s", i->c_str());
+}
+
+void KleeHandler::writeOutputFile(const std::string &filename,
+                                  std::string &contents) {
+  // Taken over rather than copied, call paths can be large.
+  std::shared_ptr<std::string> data = std::make_shared<std::string>();
+  data->swap(contents);
+  std::string path = getOutputFilename(filename);
+  runOutputJob([this, path, data]() {
+    std::string warning;
+    llvm::raw_fd_ostream *f = openOutputPath(path, warning);
+    if (f) {
+      *f << *data;
+      delete f;
+    } else {
+      addOutputWarning(warning);
+    }
+  });
+}
+
+void KleeHandler::flushOutputs() {
+  if (m_writer)
+    m_writer->flush();
+  reportOutputWarnings();
+}
+
 std::string KleeHandler::getTestFilename(const std::string &suffix,
                                          unsigned id) {
   std::stringstream filename;
@@ -448,7 +760,7 @@ llvm::raw_fd_ostream *KleeHandler::openTestFile(const std::string &suffix,
 void KleeHandler::processTestCase(const ExecutionState &state,
                                   const char *errorMessage,
                                   const char *errorSuffix) {
-  if (!NoOutput) {
+  if (!NoOutput && !m_discardOutputs) {
     std::vector<std::pair<std::string, std::vector<unsigned char>>> out;
     std::vector<HavocedLocation> havocs;
     bool success = m_interpreter->getSymbolicSolution(state, out, havocs);
@@ -469,7 +781,8 @@ void KleeHandler::processTestCase(const ExecutionState &state,
       b.numObjects = out.size();
       b.objects = new KTestObject[b.numObjects];
       assert(b.objects);
-      std::string *names = new std::string[b.numObjects];
+      // Owns the object and havoc names until the test has been written.
+      std::string *names = new std::string[b.numObjects + havocs.size()];
       for (unsigned i = 0; i < b.numObjects; i++) {
         KTestObject *o = &b.objects[i];
         // Drop the '..._1' suffix
@@ -500,7 +813,8 @@ void KleeHandler::processTestCase(const ExecutionState &state,
       assert(b.havocs);
       for (unsigned i = 0; i < b.numHavocs; i++) {
         KTestHavocedLocation *o = &b.havocs[i];
-        o->name = const_cast<char *>(havocs[i].name.c_str());
+        names[b.numObjects + i] = havocs[i].name;
+        o->name = const_cast<char *>(names[b.numObjects + i].c_str());
         o->numBytes = havocs[i].value.size();
         o->bytes = new unsigned char[o->numBytes];
         assert(o->bytes);
@@ -521,51 +835,59 @@ void KleeHandler::processTestCase(const ExecutionState &state,
         // fflush(stdout);
       }
 
-      if (!kTest_toFile(
-               &b, getOutputFilename(getTestFilename("ktest", id)).c_str())) {
-        klee_warning("unable to write output test case, losing it");
-      } else {
-        ++m_numGeneratedTests;
-      }
+      std::string path = getOutputFilename(getTestFilename("ktest", id));
+      KTest *test = new KTest(b);
+      ++m_numGeneratedTests;
+      runOutputJob([this, test, names, path]() {
+        if (!kTest_toFile(test, path.c_str())) {
+          addOutputWarning("unable to write output test case, losing it");
+          --m_numGeneratedTests;
+        }
+        for (unsigned i = 0; i < test->numObjects; i++)
+          delete[] test->objects[i].bytes;
+        delete[] test->objects;
+        for (unsigned i = 0; i < test->numHavocs; i++) {
+          delete[] test->havocs[i].bytes;
+          delete[] test->havocs[i].mask;
+        }
+        delete[] test->havocs;
+        delete[] names;
+        delete test;
+      });
 
       if (DumpCallTraces && !errorMessage) {
-        llvm::raw_fd_ostream *trace_file =
-            openOutputFile(getTestFilename("call_path", id));
-        dumpCallPath(state, trace_file);
-        delete trace_file;
+        std::string trace;
+        llvm::raw_string_ostream trace_stream(trace);
+        dumpCallPath(state, &trace_stream);
+        trace_stream.flush();
+        writeOutputFile(getTestFilename("call_path", id), trace);
       }
-
-      for (unsigned i = 0; i < b.numObjects; i++)
-        delete[] b.objects[i].bytes;
-      delete[] b.objects;
-      delete[] names;
     }
 
     if (errorMessage) {
-      llvm::raw_ostream *f = openTestFile(errorSuffix, id);
-      *f << errorMessage;
-      delete f;
+      std::string message(errorMessage);
+      writeOutputFile(getTestFilename(errorSuffix, id), message);
     }
 
     if (m_pathWriter) {
       std::vector<unsigned char> concreteBranches;
       m_pathWriter->readStream(m_interpreter->getPathStreamID(state),
                                concreteBranches);
-      llvm::raw_fd_ostream *f = openTestFile("path", id);
+      std::string branches;
+      llvm::raw_string_ostream f(branches);
       for (std::vector<unsigned char>::iterator I = concreteBranches.begin(),
                                                 E = concreteBranches.end();
            I != E; ++I) {
-        *f << *I << "\n";
+        f << *I << "\n";
       }
-      delete f;
+      f.flush();
+      writeOutputFile(getTestFilename("path", id), branches);
     }
 
     if (errorMessage || WriteKQueries) {
       std::string constraints;
       m_interpreter->getConstraintLog(state, constraints, Interpreter::KQUERY);
-      llvm::raw_ostream *f = openTestFile("kquery", id);
-      *f << constraints;
-      delete f;
+      writeOutputFile(getTestFilename("kquery", id), constraints);
     }
 
     if (WriteCVCs) {
@@ -573,36 +895,35 @@ void KleeHandler::processTestCase(const ExecutionState &state,
       // SMT-LIBv2 not CVC which is a bit confusing
       std::string constraints;
       m_interpreter->getConstraintLog(state, constraints, Interpreter::STP);
-      llvm::raw_ostream *f = openTestFile("cvc", id);
-      *f << constraints;
-      delete f;
+      writeOutputFile(getTestFilename("cvc", id), constraints);
     }
 
     if (WriteSMT2s) {
       std::string constraints;
       m_interpreter->getConstraintLog(state, constraints, Interpreter::SMTLIB2);
-      llvm::raw_ostream *f = openTestFile("smt2", id);
-      *f << constraints;
-      delete f;
+      writeOutputFile(getTestFilename("smt2", id), constraints);
     }
 
     if (m_symPathWriter) {
       std::vector<unsigned char> symbolicBranches;
       m_symPathWriter->readStream(m_interpreter->getSymbolicPathStreamID(state),
                                   symbolicBranches);
-      llvm::raw_fd_ostream *f = openTestFile("sym.path", id);
+      std::string branches;
+      llvm::raw_string_ostream f(branches);
       for (std::vector<unsigned char>::iterator I = symbolicBranches.begin(),
                                                 E = symbolicBranches.end();
            I != E; ++I) {
-        *f << *I << "\n";
+        f << *I << "\n";
       }
-      delete f;
+      f.flush();
+      writeOutputFile(getTestFilename("sym.path", id), branches);
     }
 
     if (WriteCov) {
       std::map<const std::string *, std::set<unsigned>> cov;
       m_interpreter->getCoveredLines(state, cov);
-      llvm::raw_ostream *f = openTestFile("cov", id);
+      std::string lines;
+      llvm::raw_string_ostream f(lines);
       for (std::map<const std::string *, std::set<unsigned>>::iterator
                it = cov.begin(),
                ie = cov.end();
@@ -610,19 +931,22 @@ void KleeHandler::processTestCase(const ExecutionState &state,
         for (std::set<unsigned>::iterator it2 = it->second.begin(),
                                           ie = it->second.end();
              it2 != ie; ++it2)
-          *f << *it->first << ":" << *it2 << "\n";
+          f << *it->first << ":" << *it2 << "\n";
       }
-      delete f;
+      f.flush();
+      writeOutputFile(getTestFilename("cov", id), lines);
     }
 
-    if (m_numGeneratedTests == StopAfterNTests)
+    if (m_numGeneratedTests.load() == StopAfterNTests)
       m_interpreter->setHaltExecution(true);
 
     if (WriteTestInfo) {
       double elapsed_time = util::getWallTime() - start_time;
-      llvm::raw_ostream *f = openTestFile("info", id);
-      *f << "Time to generate test case: " << elapsed_time << "s\n";
-      delete f;
+      std::string info;
+      llvm::raw_string_ostream f(info);
+      f << "Time to generate test case: " << elapsed_time << "s\n";
+      f.flush();
+      writeOutputFile(getTestFilename("info", id), info);
     }
   }
 
@@ -914,9 +1238,12 @@ bool dumpCallInfoSExpr(const CallInfo &ci, llvm::raw_ostream &file) {
 }
 
 void KleeHandler::processCallPath(const ExecutionState &state) {
+  if (m_discardOutputs)
+    return;
+
   unsigned id = m_callPathIndex;
   if (DumpCallTracePrefixes)
-    m_callTree.addCallPath(state.callPath.begin(), state.callPath.end(), id);
+    m_callTree.finishPath(state.callPrefix.getNode(), id);
 
   if (!DumpCallTraces)
     return;
@@ -926,22 +1253,21 @@ void KleeHandler::processCallPath(const ExecutionState &state) {
   std::stringstream filename;
   filename << "call-path" << std::setfill('0') << std::setw(6) << id << '.'
            << "txt";
-  llvm::raw_ostream *file = openOutputFile(filename.str());
-  for (std::vector<CallInfo>::const_iterator iter = state.callPath.begin(),
-                                             end = state.callPath.end();
-       iter != end; ++iter) {
-    const CallInfo &ci = *iter;
-    bool dumped = dumpCallInfo(ci, *file);
-    if (!dumped)
-      break;
-  }
-  *file << ";;-- Constraints --\n";
+  std::string contents;
+  llvm::raw_string_ostream file(contents);
+  dumpCalls(state, file);
+  file << ";;-- Constraints --\n";
   for (ConstraintManager::constraint_iterator ci = state.constraints.begin(),
                                               cEnd = state.constraints.end();
        ci != cEnd; ++ci) {
-    *file << **ci << "\n";
+    file << **ci << "\n";
   }
-  delete file;
+  file.flush();
+  writeOutputFile(filename.str(), contents);
+}
+
+CallPrefixTree *KleeHandler::getCallPrefixTree() {
+  return DumpCallTracePrefixes ? &m_callTree : 0;
 }
 
 llvm::raw_fd_ostream *KleeHandler::openNextCallPathPrefixFile() {
@@ -953,9 +1279,43 @@ llvm::raw_fd_ostream *KleeHandler::openNextCallPathPrefixFile() {
 }
 
 void KleeHandler::dumpCallPathPrefixes() {
-  m_callTree.dumpCallPrefixesSExpr(std::list<CallInfo>(), this);
-  // m_callTree.dumpCallPrefixes(std::list<CallInfo>(), std::list<const
-  // std::vector<ref<Expr> >* >(), this);
+  if (m_chunk < 0 && m_partition < 0 && m_mergedOutputs.empty()) {
+    // Only the subtrees still open at the end are left to write.
+    m_callTree.flushAll();
+    return;
+  }
+
+  CallTreeImage image;
+  m_callTree.buildImage(image);
+
+  for (std::vector<std::pair<std::string, unsigned>>::const_iterator
+           it = m_mergedOutputs.begin(),
+           ie = m_mergedOutputs.end();
+       it != ie; ++it) {
+    CallTreeImage other;
+    std::string path = it->first + "/call-tree.image";
+    if (!llvm::sys::fs::exists(path))
+      continue; // not run with --dump-call-trace-prefixes
+    if (!other.read(path)) {
+      klee_warning("unable to read \"%s\", its call prefixes are lost",
+                   path.c_str());
+      continue;
+    }
+    image.absorb(other, it->second);
+  }
+
+  if (m_chunk >= 0 || m_partition >= 0) {
+    // The prefixes are dumped once all the trees are merged.
+    llvm::raw_fd_ostream *file = openOutputFile("call-tree.image");
+    if (file) {
+      image.write(*file);
+      delete file;
+    }
+    return;
+  }
+
+  std::list<const CallTreeImage *> prefix;
+  image.dumpCallPrefixesSExpr(prefix, this);
 }
 
 void KleeHandler::dumpCallPath(const ExecutionState &state,
@@ -963,8 +1323,8 @@ void KleeHandler::dumpCallPath(const ExecutionState &state,
   std::vector<klee::ref<klee::Expr>> evalExprs;
   std::vector<const klee::Array *> evalArrays;
 
-  for (auto ci : state.callPath) {
-    for (auto a : ci.args) {
+  for (const auto &ci : state.callPath) {
+    for (const auto &a : ci.args) {
       evalExprs.push_back(a.expr);
 
       if (a.isPtr) {
@@ -978,7 +1338,7 @@ void KleeHandler::dumpCallPath(const ExecutionState &state,
       }
     }
 
-    for (auto e : ci.extraPtrs) {
+    for (const auto &e : ci.extraPtrs) {
       if (e.second.pointee.doTraceValueIn) {
         evalExprs.push_back(e.second.pointee.inVal);
       }
@@ -996,24 +1356,21 @@ void KleeHandler::dumpCallPath(const ExecutionState &state,
   std::string kleaverStr;
   llvm::raw_string_ostream kleaverROS(kleaverStr);
   ExprPPrinter::printQuery(kleaverROS, state.constraints, exprBuilder->False(),
-                           &evalExprs[0], &evalExprs[0] + evalExprs.size(),
-                           &evalArrays[0], &evalArrays[0] + evalArrays.size(),
-                           true);
+                           evalExprs.data(), evalExprs.data() + evalExprs.size(),
+                           evalArrays.data(),
+                           evalArrays.data() + evalArrays.size(), true);
   kleaverROS.flush();
+  delete exprBuilder;
 
   *file << ";;-- kQuery --\n";
   *file << kleaverROS.str();
 
   *file << ";;-- Calls --\n";
-  for (std::vector<CallInfo>::const_iterator iter = state.callPath.begin(),
-                                             end = state.callPath.end();
-       iter != end; ++iter) {
-    const CallInfo &ci = *iter;
-    bool dumped = dumpCallInfo(ci, *file);
-    if (!dumped)
-      break;
-  }
+  dumpCalls(state, *file);
+  // The loaders stop at the marker, so it stays even with nothing after it.
   *file << ";;-- Constraints --\n";
+  if (OmitCallPathConstraints)
+    return;
   for (ConstraintManager::constraint_iterator ci = state.constraints.begin(),
                                               cEnd = state.constraints.end();
        ci != cEnd; ++ci) {
@@ -1021,6 +1378,19 @@ void KleeHandler::dumpCallPath(const ExecutionState &state,
   }
 }
 
+void KleeHandler::dumpCalls(const ExecutionState &state,
+                            llvm::raw_ostream &file) {
+  for (ExecutionState::call_path_ty::const_iterator
+           iter = state.callPath.begin(),
+           end = state.callPath.end();
+       iter != end; ++iter) {
+    const CallInfo &ci = *iter;
+    bool dumped = dumpCallInfo(ci, file);
+    if (!dumped)
+      break;
+  }
+}
+
 // load a .path file
 void KleeHandler::loadPathFile(std::string name, std::vector<bool> &buffer) {
   std::ifstream f(name.c_str(), std::ios::in | std::ios::binary);
@@ -1097,51 +1467,37 @@ std::string KleeHandler::getRunTimeLibraryPath(const char *argv0) {
   return libDir.str();
 }
 
-void CallTree::addCallPath(std::vector<CallInfo>::const_iterator path_begin,
-                           std::vector<CallInfo>::const_iterator path_end,
-                           unsigned path_id) {
-  // TODO: do we process constraints (what if they are different from the old
-  // ones?)
-  // TODO: record assumptions for each item in the call-path, because, when
-  // comparing two paths in the tree they may differ only by the assumptions.
-  if (path_begin == path_end)
-    return;
-  std::vector<CallInfo>::const_iterator next = path_begin;
-  ++next;
-  std::vector<CallTree *>::iterator i = children.begin(), ie = children.end();
-  for (; i != ie; ++i) {
-    if ((*i)->tip.call.eq(*path_begin)) {
-      (*i)->addCallPath(next, path_end, path_id);
-      return;
-    }
-  }
-  children.push_back(new CallTree());
-  CallTree *n = children.back();
-  n->tip.call = *path_begin;
-  n->tip.path_id = path_id;
-  n->addCallPath(next, path_end, path_id);
-}
-
-std::vector<std::vector<CallPathTip *>> CallTree::groupChildren() {
-  std::vector<std::vector<CallPathTip *>> ret;
-  for (unsigned ci = 0; ci < children.size(); ++ci) {
-    CallPathTip *current = &children[ci]->tip;
+std::vector<std::vector<const CallTree::Node *>>
+CallTree::groupChildren(const Node &n) const {
+  std::vector<std::vector<const Node *>> ret;
+  for (std::vector<Node *>::const_iterator ci = n.getChildren().begin(),
+                                           ce = n.getChildren().end();
+       ci != ce; ++ci) {
+    const Node *current = *ci;
+    if (!current->getPathId())
+      continue; // no path through it finished
     bool groupNotFound = true;
     for (unsigned gi = 0; gi < ret.size(); ++gi) {
-      if (current->call.sameInvocation(&ret[gi][0]->call)) {
+      if (current->getCall().sameInvocation(&ret[gi][0]->getCall())) {
         ret[gi].push_back(current);
         groupNotFound = false;
         break;
       }
     }
-    if (groupNotFound) {
-      ret.push_back(std::vector<CallPathTip *>());
-      ret.back().push_back(current);
-    }
+    if (groupNotFound)
+      ret.push_back(std::vector<const Node *>(1, current));
   }
   return ret;
 }
 
+void CallTree::buildImage(const Node &n, CallTreeImage &image) const {
+  for (std::vector<Node *>::const_iterator ci = n.getChildren().begin(),
+                                           ce = n.getChildren().end();
+       ci != ce; ++ci)
+    if ((*ci)->getPathId())
+      buildImage(**ci, *image.addChild((*ci)->getCall(), (*ci)->getPathId()));
+}
+
 void dumpCallGroup(const std::vector<CallInfo *> group,
                    llvm::raw_ostream &file) {
   std::vector<CallInfo *>::const_iterator gi = group.begin(), ge = group.end();
@@ -1253,105 +1609,165 @@ void dumpCallGroup(const std::vector<CallInfo *> group,
   file << "\n";
 }
 
-void CallTree::dumpCallPrefixes(
-    std::list<CallInfo> accumulated_prefix,
-    std::list<const std::vector<ref<Expr>> *> accumulated_context,
-    KleeHandler *fileOpener) {
-  std::vector<std::vector<CallPathTip *>> tipCalls = groupChildren();
-  std::vector<std::vector<CallPathTip *>>::iterator ti = tipCalls.begin(),
-                                                    te = tipCalls.end();
+// One file per group of children with the same invocation, holding the
+// calls leading to n and those of the group.
+void CallTree::flush(const Node &n) {
+  std::vector<const Node *> history;
+  for (const Node *m = &n; m->getParent(); m = m->getParent())
+    history.push_back(m);
+
+  std::vector<std::vector<const Node *>> tipCalls = groupChildren(n);
+  std::vector<std::vector<const Node *>>::iterator ti = tipCalls.begin(),
+                                                   te = tipCalls.end();
   for (; ti != te; ++ti) {
     llvm::raw_ostream *file = fileOpener->openNextCallPathPrefixFile();
-    std::list<CallInfo>::iterator ai = accumulated_prefix.begin(),
-                                  ae = accumulated_prefix.end();
-    for (; ai != ae; ++ai) {
-      bool dumped = dumpCallInfo(*ai, *file);
+    *file << "((history (\n";
+    for (std::vector<const Node *>::reverse_iterator ai = history.rbegin(),
+                                                     ae = history.rend();
+         ai != ae; ++ai) {
+      bool dumped = dumpCallInfoSExpr((*ai)->getCall(), *file);
       assert(dumped);
     }
-    *file << "--- Constraints ---\n";
-    for (std::list<const std::vector<ref<Expr>> *>::const_iterator
-             cgi = accumulated_context.begin(),
-             cge = accumulated_context.end();
-         cgi != cge; ++cgi) {
-      for (std::vector<ref<Expr>>::const_iterator ci = (**cgi).begin(),
-                                                  ce = (**cgi).end();
-           ci != ce; ++ci) {
-        *file << **ci << "\n";
-      }
-      *file << "---\n";
-    }
-    *file << "--- Alternatives ---\n";
+    *file << "))\n";
     // FIXME: currently there can not be more than one alternative.
-    *file << "(or \n";
-    for (std::vector<CallPathTip *>::const_iterator chi = ti->begin(),
-                                                    che = ti->end();
+    *file << "(tip_calls (\n";
+    for (std::vector<const Node *>::const_iterator chi = ti->begin(),
+                                                   che = ti->end();
          chi != che; ++chi) {
-      *file << "(and \n";
-      bool dumped = dumpCallInfo((**chi).call, *file);
+      *file << "; id: " << (*chi)->getPathId() << "("
+            << (*chi)->getCall().callPlace.getLine() << ")\n";
+      bool dumped = dumpCallInfoSExpr((*chi)->getCall(), *file);
       assert(dumped);
-      for (std::vector<ref<Expr>>::const_iterator
-               ei = (**chi).call.callContext.begin(),
-               ee = (**chi).call.callContext.end();
-           ei != ee; ++ei) {
-        *file << **ei << "\n";
-      }
-      for (std::vector<ref<Expr>>::const_iterator
-               ei = (**chi).call.returnContext.begin(),
-               ee = (**chi).call.returnContext.end();
-           ei != ee; ++ei) {
-        *file << **ei << "\n";
-      }
-      *file << "true)\n";
     }
-    *file << "false)\n";
+    *file << ")))\n";
     delete file;
   }
-  std::vector<CallTree *>::iterator ci = children.begin(), ce = children.end();
-  for (; ci != ce; ++ci) {
-    accumulated_prefix.push_back((*ci)->tip.call);
-    accumulated_context.push_back(&(*ci)->tip.call.callContext);
-    accumulated_context.push_back(&(*ci)->tip.call.returnContext);
-    (*ci)
-        ->dumpCallPrefixes(accumulated_prefix, accumulated_context, fileOpener);
-    accumulated_context.pop_back();
-    accumulated_context.pop_back();
-    accumulated_prefix.pop_back();
-  }
-}
-
-void CallTree::dumpCallPrefixesSExpr(std::list<CallInfo> accumulated_prefix,
-                                     KleeHandler *fileOpener) {
-  std::vector<std::vector<CallPathTip *>> tipCalls = groupChildren();
-  std::vector<std::vector<CallPathTip *>>::iterator ti = tipCalls.begin(),
-                                                    te = tipCalls.end();
+}
+
+CallTreeImage::~CallTreeImage() {
+  for (std::vector<CallTreeImage *>::iterator i = children.begin(),
+                                              ie = children.end();
+       i != ie; ++i)
+    delete *i;
+}
+
+CallTreeImage *CallTreeImage::addChild(const CallInfo &ci, unsigned path_id) {
+  std::string str;
+  llvm::raw_string_ostream text(str);
+  bool dumped = dumpCallInfoSExpr(ci, text);
+  assert(dumped);
+  (void)dumped;
+  children.push_back(new CallTreeImage(text.str(), ci.getInvocationKey(),
+                                       path_id, ci.callPlace.getLine()));
+  return children.back();
+}
+
+void CallTreeImage::absorb(const CallTreeImage &other, unsigned pathIdBase) {
+  std::vector<CallTreeImage *>::const_iterator oi = other.children.begin(),
+                                               oe = other.children.end();
+  for (; oi != oe; ++oi) {
+    CallTreeImage *match = 0;
+    for (unsigned ci = 0; ci < children.size() && !match; ++ci)
+      if (children[ci]->call == (*oi)->call)
+        match = children[ci];
+    if (!match) {
+      match = new CallTreeImage((*oi)->call, (*oi)->invocation,
+                                (*oi)->path_id + pathIdBase, (*oi)->line);
+      children.push_back(match);
+    }
+    match->absorb(**oi, pathIdBase);
+  }
+}
+
+// Pre-order, one node per record: a header line
+// "<depth> <path id> <line> <call length> <invocation length>" followed by
+// the two strings and a newline.
+void CallTreeImage::write(llvm::raw_ostream &file, unsigned depth) const {
+  if (depth)
+    file << depth << " " << path_id << " " << line << " " << call.size() << " "
+         << invocation.size() << "\n"
+         << call << invocation << "\n";
+  std::vector<CallTreeImage *>::const_iterator ci = children.begin(),
+                                               ce = children.end();
+  for (; ci != ce; ++ci)
+    (*ci)->write(file, depth + 1);
+}
+
+bool CallTreeImage::read(const std::string &path) {
+  std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+  if (!file.good())
+    return false;
+  std::vector<CallTreeImage *> parents(1, this);
+  unsigned depth;
+  while (file >> depth) {
+    CallTreeImage *n = new CallTreeImage();
+    size_t callSize, invocationSize;
+    file >> n->path_id >> n->line >> callSize >> invocationSize;
+    file.get();
+    n->call.resize(callSize);
+    n->invocation.resize(invocationSize);
+    file.read(&n->call[0], callSize);
+    file.read(&n->invocation[0], invocationSize);
+    if (!file || depth == 0 || depth > parents.size()) {
+      delete n;
+      return false;
+    }
+    parents.resize(depth);
+    parents.back()->children.push_back(n);
+    parents.push_back(n);
+  }
+  return file.eof();
+}
+
+std::vector<std::vector<const CallTreeImage *>>
+CallTreeImage::groupChildren() const {
+  std::vector<std::vector<const CallTreeImage *>> ret;
+  for (unsigned ci = 0; ci < children.size(); ++ci) {
+    const CallTreeImage *current = children[ci];
+    bool groupNotFound = true;
+    for (unsigned gi = 0; gi < ret.size(); ++gi) {
+      if (current->invocation == ret[gi][0]->invocation) {
+        ret[gi].push_back(current);
+        groupNotFound = false;
+        break;
+      }
+    }
+    if (groupNotFound)
+      ret.push_back(std::vector<const CallTreeImage *>(1, current));
+  }
+  return ret;
+}
+
+// Produces the same files as CallTree::flush().
+void CallTreeImage::dumpCallPrefixesSExpr(
+    std::list<const CallTreeImage *> &prefix, KleeHandler *fileOpener) const {
+  std::vector<std::vector<const CallTreeImage *>> tipCalls = groupChildren();
+  std::vector<std::vector<const CallTreeImage *>>::iterator
+      ti = tipCalls.begin(),
+      te = tipCalls.end();
   for (; ti != te; ++ti) {
     llvm::raw_ostream *file = fileOpener->openNextCallPathPrefixFile();
-    std::list<CallInfo>::iterator ai = accumulated_prefix.begin(),
-                                  ae = accumulated_prefix.end();
     *file << "((history (\n";
-    for (; ai != ae; ++ai) {
-      bool dumped = dumpCallInfoSExpr(*ai, *file);
-      assert(dumped);
-    }
+    for (std::list<const CallTreeImage *>::const_iterator ai = prefix.begin(),
+                                                         ae = prefix.end();
+         ai != ae; ++ai)
+      *file << (*ai)->call;
     *file << "))\n";
-    // FIXME: currently there can not be more than one alternative.
     *file << "(tip_calls (\n";
-    for (std::vector<CallPathTip *>::const_iterator chi = ti->begin(),
-                                                    che = ti->end();
-         chi != che; ++chi) {
-      *file << "; id: " << (**chi).path_id << "("
-            << (**chi).call.callPlace.getLine() << ")\n";
-      bool dumped = dumpCallInfoSExpr((**chi).call, *file);
-      assert(dumped);
-    }
+    for (std::vector<const CallTreeImage *>::const_iterator chi = ti->begin(),
+                                                           che = ti->end();
+         chi != che; ++chi)
+      *file << "; id: " << (*chi)->path_id << "(" << (*chi)->line << ")\n"
+            << (*chi)->call;
     *file << ")))\n";
     delete file;
   }
-  std::vector<CallTree *>::iterator ci = children.begin(), ce = children.end();
+  std::vector<CallTreeImage *>::const_iterator ci = children.begin(),
+                                               ce = children.end();
   for (; ci != ce; ++ci) {
-    accumulated_prefix.push_back((*ci)->tip.call);
-    (*ci)->dumpCallPrefixesSExpr(accumulated_prefix, fileOpener);
-    accumulated_prefix.pop_back();
+    prefix.push_back(*ci);
+    (*ci)->dumpCallPrefixesSExpr(prefix, fileOpener);
+    prefix.pop_back();
   }
 }
 
@@ -1888,6 +2304,43 @@ int main(int argc, char **argv, char **envp) {
   parseArguments(argc, argv);
   sys::PrintStackTraceOnErrorSignal();
 
+  if (ParallelWorkers && (WritePaths || WriteSymPaths))
+    klee_error("--write-paths and --write-sym-paths are not supported with "
+               "--parallel-workers");
+
+  unsigned partition = 0, numPartitions = 0;
+  if (Partition != "") {
+    char slash, trailing;
+    if (sscanf(Partition.c_str(), "%u%c%u%c", &partition, &slash,
+               &numPartitions, &trailing) != 3 ||
+        slash != '/' || partition >= numPartitions)
+      klee_error("invalid --partition \"%s\", expected K/N with K < N",
+                 Partition.c_str());
+    if (WritePaths || WriteSymPaths)
+      klee_error("--write-paths and --write-sym-paths are not supported with "
+                 "--partition");
+    if (MaxTime)
+      klee_warning("--max-time may stop partitions at different points, "
+                   "merging them can then miss or repeat tests");
+  }
+
+  if (!MergePartitions.empty()) {
+    KleeHandler *handler = new KleeHandler(argc, argv);
+    for (unsigned i = 0; i < MergePartitions.size(); ++i)
+      if (!handler->mergeOutputDirectory(MergePartitions[i], false))
+        klee_error("\"%s\" is not the output directory of a --partition run",
+                   MergePartitions[i].c_str());
+    handler->dumpCallPathPrefixes();
+    handler->getInfoStream()
+        << "KLEE: merged " << MergePartitions.size() << " partitions\n"
+        << "KLEE: done: completed paths = " << handler->getNumPathsExplored()
+        << "\n"
+        << "KLEE: done: generated tests = " << handler->getNumTestCases()
+        << "\n";
+    delete handler;
+    return 0;
+  }
+
   if (Watchdog) {
     if (MaxTime == 0) {
       klee_error("--watchdog used without --max-time");
@@ -2067,7 +2520,11 @@ int main(int argc, char **argv, char **envp) {
   Interpreter::InterpreterOptions IOpts;
   IOpts.MakeConcreteSymbolic = MakeConcreteSymbolic;
   IOpts.CondoneUndeclaredHavocs = CondoneUndeclaredHavocs;
+  IOpts.Partition = partition;
+  IOpts.NumPartitions = numPartitions;
   KleeHandler *handler = new KleeHandler(pArgc, pArgv);
+  if (numPartitions)
+    handler->setPartition(partition);
   Interpreter *interpreter = theInterpreter =
       Interpreter::create(ctx, IOpts, handler);
   handler->setInterpreter(interpreter);
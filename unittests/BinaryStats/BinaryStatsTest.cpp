@@ -0,0 +1,108 @@
+//===-- BinaryStatsTest.cpp -------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/Internal/Support/BinaryStats.h"
+#include "klee/Internal/Support/FileHandling.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <string>
+
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+/// A file name in /tmp, removed again when the test is done with it,
+/// even if it fails.
+struct TemporaryFile {
+  std::string path;
+
+  explicit TemporaryFile(const char *name) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "/tmp/klee-%s-%d", name, (int) getpid());
+    path = buffer;
+  }
+  ~TemporaryFile() { unlink(path.c_str()); }
+};
+}
+
+static StatsRecord makeRecord(unsigned i) {
+  StatsRecord record;
+  record.addInteger("Instructions", 1000 * i);
+  record.addReal("WallTime", i / 4.);
+  record.addInteger("NumStates", i);
+  return record;
+}
+
+TEST(BinaryStatsTest, TextFormat) {
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  StatsRecord record = makeRecord(2);
+  record.printHeader(os);
+  record.print(os);
+  os.flush();
+  ASSERT_EQ(0u, text.find("('Instructions','WallTime','NumStates',)\n"
+                          "(2000,"));
+}
+
+TEST(BinaryStatsTest, RoundTrip) {
+  TemporaryFile file("binary-stats");
+  std::string path = file.path, error;
+  llvm::raw_fd_ostream *os = klee_open_output_file(path, error);
+  ASSERT_TRUE(os) << error;
+  binary_stats::writeHeader(*os, makeRecord(0));
+  for (unsigned i = 0; i < 3; ++i)
+    binary_stats::writeRecord(*os, makeRecord(i));
+  // A record cut short.
+  os->write("\0\0\0", 3);
+  os->flush();
+
+  BinaryStatsReader reader;
+  ASSERT_TRUE(reader.open(path, error)) << error;
+  ASSERT_EQ(3u, reader.getColumns().size());
+  ASSERT_EQ("WallTime", reader.getColumns()[1].name);
+  ASSERT_TRUE(reader.getColumns()[1].isReal);
+  ASSERT_FALSE(reader.getColumns()[2].isReal);
+  ASSERT_EQ(2, reader.getColumnIndex("NumStates"));
+  ASSERT_EQ(-1, reader.getColumnIndex("Missing"));
+
+  ASSERT_EQ(3u, reader.getNumRecords());
+  for (unsigned i = 0; i < 3; ++i) {
+    ASSERT_EQ(1000u * i, reader.getInteger(i, 0));
+    ASSERT_EQ(i / 4., reader.getReal(i, 1));
+    ASSERT_EQ(double(i), reader.getValue(i, 2));
+  }
+
+  // Records appended after opening show up on refresh. The 3 bytes above
+  // and the 21 written here complete the fourth record.
+  os->write("\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 21);
+  binary_stats::writeRecord(*os, makeRecord(7));
+  os->flush();
+  delete os;
+  ASSERT_TRUE(reader.refresh(error)) << error;
+  ASSERT_EQ(5u, reader.getNumRecords());
+  ASSERT_EQ(7000u, reader.getInteger(4, 0));
+}
+
+TEST(BinaryStatsTest, RejectsText) {
+  TemporaryFile file("binary-stats-text");
+  std::string path = file.path, error;
+  llvm::raw_fd_ostream *os = klee_open_output_file(path, error);
+  ASSERT_TRUE(os) << error;
+  makeRecord(0).printHeader(*os);
+  delete os;
+
+  BinaryStatsReader reader;
+  ASSERT_FALSE(reader.open(path, error));
+  ASSERT_FALSE(error.empty());
+}
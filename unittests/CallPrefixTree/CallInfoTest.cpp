@@ -0,0 +1,131 @@
+//===-- CallInfoTest.cpp ----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/ExecutionState.h"
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+ref<Expr> constant(unsigned value) {
+  return ConstantExpr::create(value, Expr::Int32);
+}
+
+CallArg makeArg(unsigned value) {
+  CallArg arg;
+  arg.expr = constant(value);
+  arg.isPtr = false;
+  arg.funPtr = 0;
+  return arg;
+}
+
+FieldDescr makeField(unsigned value) {
+  FieldDescr descr;
+  descr.width = Expr::Int32;
+  descr.type = "int";
+  descr.name = "x";
+  descr.addr = 0;
+  descr.doTraceValueIn = true;
+  descr.doTraceValueOut = false;
+  descr.inVal = constant(value);
+  return descr;
+}
+
+CallArg makePtrArg(const FieldDescr &pointee) {
+  CallArg arg = makeArg(0x1000);
+  arg.isPtr = true;
+  arg.pointee = pointee;
+  return arg;
+}
+
+CallInfo makeCall() {
+  CallInfo call;
+  call.f = 0;
+  call.returned = true;
+  call.ret.isPtr = false;
+  call.ret.funPtr = 0;
+  return call;
+}
+
+/// Calls that differ in every way sameInvocation() looks at, and in some
+/// it does not.
+std::vector<CallInfo> makeCalls() {
+  std::vector<CallInfo> calls;
+  CallInfo call = makeCall();
+  calls.push_back(call);
+
+  call.args.push_back(makeArg(1));
+  calls.push_back(call);
+  call.args[0] = makeArg(2);
+  calls.push_back(call);
+  call.args.push_back(makeArg(1));
+  calls.push_back(call);
+
+  // Output values do not matter.
+  call.ret.expr = constant(7);
+  calls.push_back(call);
+
+  FieldDescr field = makeField(1);
+  CallInfo ptr = makeCall();
+  ptr.args.push_back(makePtrArg(field));
+  calls.push_back(ptr);
+  ptr.args[0].pointee.outVal = constant(3);
+  calls.push_back(ptr);
+  ptr.args[0].pointee.inVal = constant(2);
+  calls.push_back(ptr);
+  ptr.args[0].pointee.fields[0] = makeField(1);
+  calls.push_back(ptr);
+  ptr.args[0].pointee.fields[4] = makeField(1);
+  calls.push_back(ptr);
+  ptr.args[0].pointee.fields[4].doTraceValueIn = false;
+  calls.push_back(ptr);
+  ptr.args[0].pointee.doTraceValueIn = false;
+  calls.push_back(ptr);
+
+  // Contexts compare as sets of the same size.
+  ref<Expr> x = EqExpr::create(constant(1), constant(2));
+  ref<Expr> y = UltExpr::create(constant(1), constant(2));
+  ref<Expr> z = UltExpr::create(constant(2), constant(1));
+  ref<Expr> contexts[][3] = {{x, x, y}, {x, y, y}, {y, x, x}, {x, y, z}};
+  for (unsigned i = 0; i < 4; ++i) {
+    CallInfo c = makeCall();
+    c.args.push_back(makeArg(1));
+    c.callContext.assign(contexts[i], contexts[i] + 3);
+    calls.push_back(c);
+  }
+  CallInfo c = makeCall();
+  c.args.push_back(makeArg(1));
+  c.callContext.push_back(x);
+  c.callContext.push_back(y);
+  calls.push_back(c);
+  c.returnContext.push_back(z);
+  calls.push_back(c);
+  return calls;
+}
+}
+
+TEST(CallInfoTest, InvocationKeyAgreesWithSameInvocation) {
+  std::vector<CallInfo> calls = makeCalls();
+  unsigned same = 0;
+  for (unsigned i = 0; i < calls.size(); ++i) {
+    for (unsigned j = 0; j < calls.size(); ++j) {
+      bool sameInvocation = calls[i].sameInvocation(&calls[j]);
+      EXPECT_EQ(sameInvocation,
+                calls[i].getInvocationKey() == calls[j].getInvocationKey())
+          << "calls " << i << " and " << j;
+      if (i != j && sameInvocation)
+        ++same;
+    }
+  }
+  // Some distinct calls are the same invocation.
+  EXPECT_LT(0u, same);
+}
@@ -0,0 +1,138 @@
+//===-- CallPrefixTreeTest.cpp ----------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "klee/CallPrefixTree.h"
+#include "klee/ExecutionState.h"
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+/// A call of an unnamed function with the single argument \a value.
+CallInfo makeCall(unsigned value) {
+  CallInfo call;
+  call.f = 0;
+  call.returned = true;
+  call.ret.isPtr = false;
+  call.ret.funPtr = 0;
+  CallArg arg;
+  arg.expr = ConstantExpr::create(value, Expr::Int32);
+  arg.isPtr = false;
+  arg.funPtr = 0;
+  call.args.push_back(arg);
+  return call;
+}
+
+/// Records the argument of the last call of each flushed node, 0 for the
+/// root.
+class RecordingTree : public CallPrefixTree {
+protected:
+  void flush(const Node &n) {
+    if (!n.getParent()) {
+      flushed.push_back(0);
+      return;
+    }
+    ref<Expr> arg = n.getCall().args[0].expr;
+    flushed.push_back(cast<ConstantExpr>(arg)->getZExtValue());
+  }
+
+public:
+  std::vector<unsigned> flushed;
+};
+}
+
+TEST(CallPrefixTreeTest, IdenticalCallsAreStoredOnce) {
+  RecordingTree tree;
+  CallPrefix s(&tree);
+  CallPrefix t(s);
+  s.append(makeCall(1));
+  s.append(makeCall(2));
+  t.append(makeCall(2));
+  t.append(makeCall(1));
+  ASSERT_EQ(2u, tree.getNumCalls());
+
+  // The same call from the same node leads to the same child.
+  CallPrefix u(&tree);
+  u.append(makeCall(1));
+  u.append(makeCall(2));
+  ASSERT_EQ(s.getNode(), u.getNode());
+}
+
+TEST(CallPrefixTreeTest, ContextsAreSets) {
+  RecordingTree tree;
+  ref<Expr> x = ConstantExpr::create(1, Expr::Bool);
+  ref<Expr> y = ConstantExpr::create(0, Expr::Bool);
+  CallInfo xxy = makeCall(1), xyy = makeCall(1), yx = makeCall(1);
+  xxy.callContext.push_back(x);
+  xxy.callContext.push_back(x);
+  xxy.callContext.push_back(y);
+  xyy.callContext.push_back(x);
+  xyy.callContext.push_back(y);
+  xyy.callContext.push_back(y);
+  yx.callContext.push_back(y);
+  yx.callContext.push_back(x);
+  ASSERT_TRUE(xxy.eq(xyy));
+  ASSERT_FALSE(xxy.eq(yx));
+
+  CallPrefix s(&tree), t(&tree), u(&tree);
+  s.append(xxy);
+  t.append(xyy);
+  u.append(yx);
+  ASSERT_EQ(s.getNode(), t.getNode());
+  ASSERT_NE(s.getNode(), u.getNode());
+  ASSERT_EQ(2u, tree.getNumCalls());
+}
+
+TEST(CallPrefixTreeTest, ClosedSubtreesAreFlushed) {
+  RecordingTree tree;
+  tree.setFlushing(true);
+  CallPrefix *s = new CallPrefix(&tree);
+  s->append(makeCall(1));
+  CallPrefix *t = new CallPrefix(*s);
+
+  s->append(makeCall(2));
+  tree.finishPath(s->getNode(), 1);
+  delete s;
+  // t, still at 1, could add to the children of 1.
+  ASSERT_TRUE(tree.flushed.empty());
+
+  t->append(makeCall(3));
+  // Nothing can add to 2 any more.
+  ASSERT_EQ(std::vector<unsigned>(1, 2), tree.flushed);
+  ASSERT_EQ(3u, tree.getNumCalls());
+
+  tree.finishPath(t->getNode(), 2);
+  delete t;
+  unsigned expected[] = {2, 1, 3};
+  ASSERT_EQ(std::vector<unsigned>(expected, expected + 3), tree.flushed);
+  // Only the call of the child of the root is kept, for the root's flush.
+  ASSERT_EQ(1u, tree.getNumCalls());
+
+  tree.flushAll();
+  ASSERT_EQ(4u, tree.flushed.size());
+  ASSERT_EQ(0u, tree.flushed.back());
+}
+
+TEST(CallPrefixTreeTest, KeptWithoutFlushing) {
+  RecordingTree tree;
+  CallPrefix *s = new CallPrefix(&tree);
+  s->append(makeCall(1));
+  tree.finishPath(s->getNode(), 1);
+  delete s;
+  ASSERT_TRUE(tree.flushed.empty());
+  ASSERT_EQ(1u, tree.getRoot()->getChildren().size());
+  ASSERT_EQ(1u, tree.getRoot()->getChildren()[0]->getPathId());
+
+  tree.forgetPaths();
+  ASSERT_TRUE(tree.getRoot()->getChildren().empty());
+  ASSERT_EQ(0u, tree.getNumCalls());
+}
@@ -0,0 +1,94 @@
+//===-- CellTest.cpp ------------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Expr.h"
+#include "klee/Internal/Module/Cell.h"
+#include "klee/util/ArrayCache.h"
+
+#include "llvm/ADT/APInt.h"
+
+using namespace klee;
+
+namespace {
+
+TEST(CellTest, Empty) {
+  Cell c;
+  EXPECT_FALSE(c.isInlineConstant());
+  EXPECT_TRUE(c.getValue().isNull());
+}
+
+TEST(CellTest, ConstantIsBuiltOnDemand) {
+  Cell c;
+  c.setConstant(0x1ff, Expr::Int8);
+  ASSERT_TRUE(c.isInlineConstant());
+  // Bits beyond the width are dropped.
+  EXPECT_EQ(0xffu, c.getConstantBits());
+  EXPECT_EQ(8u, c.getConstantWidth());
+
+  ref<Expr> e = c.getValue();
+  ConstantExpr *ce = dyn_cast<ConstantExpr>(e);
+  ASSERT_TRUE(ce);
+  EXPECT_EQ(8u, ce->getWidth());
+  EXPECT_EQ(0xffu, ce->getZExtValue());
+  // Built once, then kept.
+  EXPECT_EQ(e.get(), c.getValue().get());
+  EXPECT_TRUE(c.isInlineConstant());
+
+  // A new constant replaces the Expr built for the old one.
+  c.setConstant(UINT64_MAX, Expr::Int64);
+  EXPECT_EQ(UINT64_MAX, c.getConstantBits());
+  ce = dyn_cast<ConstantExpr>(c.getValue());
+  ASSERT_TRUE(ce);
+  EXPECT_EQ(64u, ce->getWidth());
+  EXPECT_EQ(UINT64_MAX, ce->getZExtValue());
+}
+
+TEST(CellTest, SetValue) {
+  Cell c;
+  ref<Expr> small = ConstantExpr::create(42, Expr::Int32);
+  c.setValue(small);
+  EXPECT_TRUE(c.isInlineConstant());
+  EXPECT_EQ(42u, c.getConstantBits());
+  EXPECT_EQ(32u, c.getConstantWidth());
+  EXPECT_EQ(small.get(), c.getValue().get());
+
+  // Wider constants and symbolic values are only kept as an Expr.
+  ref<Expr> wide = ConstantExpr::alloc(llvm::APInt(128, 7));
+  c.setValue(wide);
+  EXPECT_FALSE(c.isInlineConstant());
+  EXPECT_EQ(wide.get(), c.getValue().get());
+
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 4);
+  ref<Expr> read = ReadExpr::create(UpdateList(array, 0),
+                                    ConstantExpr::create(0, Expr::Int32));
+  c.setConstant(1, Expr::Bool);
+  c.setValue(read);
+  EXPECT_FALSE(c.isInlineConstant());
+  EXPECT_EQ(read.get(), c.getValue().get());
+
+  c.setValue(ref<Expr>());
+  EXPECT_FALSE(c.isInlineConstant());
+  EXPECT_TRUE(c.getValue().isNull());
+}
+
+TEST(CellTest, CopiesShareTheBuiltConstant) {
+  Cell c;
+  c.setConstant(5, Expr::Int16);
+  Cell before(c);
+  ref<Expr> e = c.getValue();
+  Cell after(c);
+  EXPECT_EQ(e.get(), after.getValue().get());
+  // A copy made earlier builds its own, equal one.
+  EXPECT_EQ(e, before.getValue());
+}
+
+}
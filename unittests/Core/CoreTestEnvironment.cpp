@@ -0,0 +1,28 @@
+//===-- CoreTestEnvironment.cpp -------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Context.h"
+
+using namespace klee;
+
+namespace {
+
+/// The target Context may only be initialized once per process, so it is
+/// set up here for all the tests that read or write memory.
+class CoreTestEnvironment : public ::testing::Environment {
+public:
+  void SetUp() override { Context::initialize(true, Expr::Int64); }
+};
+
+::testing::Environment *const environment =
+    ::testing::AddGlobalTestEnvironment(new CoreTestEnvironment);
+
+}
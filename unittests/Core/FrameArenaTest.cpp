@@ -0,0 +1,131 @@
+//===-- FrameArenaTest.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "CoreStats.h"
+
+#include "klee/Expr.h"
+#include "klee/Internal/Module/FrameArena.h"
+
+using namespace klee;
+
+namespace {
+
+uint64_t valueOf(const Cell &c) {
+  ref<Expr> e = c.getValue();
+  ConstantExpr *ce = dyn_cast_or_null<ConstantExpr>(e.get());
+  EXPECT_TRUE(ce);
+  return ce ? ce->getZExtValue() : 0;
+}
+
+TEST(FrameArenaTest, NewFramesAreEmpty) {
+  FrameArena arena;
+  FrameLocals locals = arena.allocate(3);
+  EXPECT_EQ(3u, locals.size());
+  EXPECT_FALSE(locals.isShared());
+  for (unsigned i = 0; i < locals.size(); ++i)
+    EXPECT_TRUE(locals[i].getValue().isNull());
+
+  // Writing to a frame of our own does not move it.
+  const Cell *before = &locals[0];
+  Cell *cells = locals.getWriteable(arena);
+  EXPECT_EQ(before, cells);
+  cells[1].setValue(ConstantExpr::alloc(5, Expr::Int32));
+  EXPECT_EQ(5u, valueOf(locals[1]));
+}
+
+TEST(FrameArenaTest, PoppedFrameIsReused) {
+  FrameArena arena;
+  FrameLocals bottom = arena.allocate(4);
+
+  FrameLocals top = arena.allocate(4);
+  top.getWriteable(arena)[0].setValue(ConstantExpr::alloc(1, Expr::Int32));
+  const Cell *address = &top[0];
+  uint64_t chunks = stats::frameArenaChunks;
+  top = FrameLocals();
+
+  // A call after a return lands where the returned frame was, and its
+  // cells start out empty again.
+  FrameLocals next = arena.allocate(4);
+  EXPECT_EQ(address, &next[0]);
+  EXPECT_TRUE(next[0].getValue().isNull());
+  EXPECT_EQ(chunks, stats::frameArenaChunks);
+}
+
+TEST(FrameArenaTest, FreedFrameBelowTopIsReused) {
+  FrameArena arena;
+  // The first chunk holds only this frame; the next ones are larger.
+  FrameLocals first = arena.allocate(4);
+  FrameLocals a = arena.allocate(4);
+  FrameLocals b = arena.allocate(4);
+  const Cell *address = &a[0];
+
+  // Released out of order, a goes to the free list and is handed out
+  // again for a frame that fits.
+  a = FrameLocals();
+  FrameLocals c = arena.allocate(3);
+  EXPECT_EQ(address, &c[0]);
+  EXPECT_EQ(3u, c.size());
+}
+
+TEST(FrameArenaTest, ForkSharesFramesUntilWritten) {
+  FrameArena parentArena;
+  FrameLocals parent = parentArena.allocate(2);
+  Cell *cells = parent.getWriteable(parentArena);
+  cells[0].setValue(ConstantExpr::alloc(10, Expr::Int32));
+  cells[1].setValue(ConstantExpr::alloc(11, Expr::Int32));
+
+  // Forking copies the stack, which only takes a reference on the frame.
+  FrameArena childArena;
+  uint64_t copies = stats::frameCopies;
+  FrameLocals child(parent);
+  EXPECT_TRUE(parent.isShared());
+  EXPECT_TRUE(child.isShared());
+  EXPECT_EQ(&parent[0], &child[0]);
+  EXPECT_EQ(copies, stats::frameCopies);
+
+  // The first write through the child clones the frame into its arena.
+  child.getWriteable(childArena)[0].setValue(
+      ConstantExpr::alloc(20, Expr::Int32));
+  EXPECT_EQ(copies + 1, stats::frameCopies);
+  EXPECT_NE(&parent[0], &child[0]);
+  EXPECT_FALSE(parent.isShared());
+  EXPECT_FALSE(child.isShared());
+  EXPECT_EQ(10u, valueOf(parent[0]));
+  EXPECT_EQ(20u, valueOf(child[0]));
+  EXPECT_EQ(11u, valueOf(child[1]));
+
+  // Further writes go straight to the clone.
+  child.getWriteable(childArena)[1].setValue(
+      ConstantExpr::alloc(21, Expr::Int32));
+  EXPECT_EQ(copies + 1, stats::frameCopies);
+  EXPECT_EQ(11u, valueOf(parent[1]));
+}
+
+TEST(FrameArenaTest, SharedFramesOutliveTheirArena) {
+  FrameLocals survivor;
+  {
+    FrameArena arena;
+    FrameLocals locals = arena.allocate(1);
+    locals.getWriteable(arena)[0].setValue(
+        ConstantExpr::alloc(42, Expr::Int32));
+    survivor = locals;
+  }
+  // The state that made the frame is gone, but a fork still uses it.
+  EXPECT_FALSE(survivor.isShared());
+  EXPECT_EQ(42u, valueOf(survivor[0]));
+
+  FrameArena arena;
+  survivor.getWriteable(arena)[0].setValue(
+      ConstantExpr::alloc(43, Expr::Int32));
+  EXPECT_EQ(43u, valueOf(survivor[0]));
+}
+
+}
@@ -0,0 +1,102 @@
+//===-- MemoryTest.cpp ----------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "Memory.h"
+
+#include "klee/Expr.h"
+#include "klee/util/ArrayCache.h"
+
+using namespace klee;
+
+namespace {
+
+/// Object contents are kept in pages of 128 bytes.
+const unsigned PageSize = 128;
+
+uint64_t readConstant(const ObjectState &os, unsigned offset,
+                      Expr::Width width) {
+  ref<Expr> e = os.read(offset, width);
+  ConstantExpr *ce = dyn_cast<ConstantExpr>(e);
+  EXPECT_TRUE(ce);
+  return ce ? ce->getZExtValue() : 0;
+}
+
+TEST(MemoryTest, WritesAcrossPageBoundaries) {
+  ObjectState os(new MemoryObject(0x1000, 3 * PageSize, false, true, false,
+                                  0, 0));
+  os.initializeToZero();
+
+  os.write32(PageSize - 2, 0xdeadbeef);
+  os.write64(2 * PageSize - 4, 0x0123456789abcdefULL);
+  EXPECT_EQ(0xdeadbeefu, readConstant(os, PageSize - 2, Expr::Int32));
+  EXPECT_EQ(0x0123456789abcdefULL,
+            readConstant(os, 2 * PageSize - 4, Expr::Int64));
+  // Little endian: the low half lands in the first page.
+  EXPECT_EQ(0xefu, readConstant(os, PageSize - 2, Expr::Int8));
+  EXPECT_EQ(0xdeu, readConstant(os, PageSize + 1, Expr::Int8));
+  EXPECT_EQ(0u, readConstant(os, PageSize - 3, Expr::Int8));
+  EXPECT_EQ(0u, readConstant(os, PageSize + 2, Expr::Int8));
+  EXPECT_EQ(0u, readConstant(os, 3 * PageSize - 1, Expr::Int8));
+}
+
+TEST(MemoryTest, SymbolicWriteAcrossPageBoundary) {
+  ArrayCache arrays;
+  const Array *array = arrays.CreateArray("x", 2);
+  ref<Expr> x = ConcatExpr::create(
+      ReadExpr::create(UpdateList(array, 0),
+                       ConstantExpr::alloc(1, Expr::Int32)),
+      ReadExpr::create(UpdateList(array, 0),
+                       ConstantExpr::alloc(0, Expr::Int32)));
+
+  ObjectState os(new MemoryObject(0x1000, 2 * PageSize, false, true, false,
+                                  0, 0));
+  os.initializeToZero();
+  os.write(PageSize - 1, x);
+
+  EXPECT_EQ(x, os.read(PageSize - 1, Expr::Int16));
+  EXPECT_FALSE(isa<ConstantExpr>(os.read8(PageSize - 1)));
+  EXPECT_FALSE(isa<ConstantExpr>(os.read8(PageSize)));
+  EXPECT_EQ(0u, readConstant(os, PageSize - 2, Expr::Int8));
+  EXPECT_EQ(0u, readConstant(os, PageSize + 1, Expr::Int8));
+
+  // Overwriting with a constant makes the bytes concrete again.
+  os.write16(PageSize - 1, 0x1234);
+  EXPECT_EQ(0x1234u, readConstant(os, PageSize - 1, Expr::Int16));
+}
+
+TEST(MemoryTest, CopiesAreIndependent) {
+  ObjectState *a = new ObjectState(
+      new MemoryObject(0x1000, 3 * PageSize, false, true, false, 0, 0));
+  a->initializeToZero();
+  for (unsigned i = 0; i < 3 * PageSize; i += 4)
+    a->write32(i, i);
+
+  ObjectState *b = new ObjectState(*a);
+  b->write8(PageSize + 5, 0xff);
+  b->write32(2 * PageSize - 2, 0xcafef00d);
+
+  for (unsigned i = 0; i < 3 * PageSize; i += 4)
+    EXPECT_EQ(i, readConstant(*a, i, Expr::Int32));
+  EXPECT_EQ(0xffu, readConstant(*b, PageSize + 5, Expr::Int8));
+  EXPECT_EQ(0xcafef00du, readConstant(*b, 2 * PageSize - 2, Expr::Int32));
+  // Untouched parts of the copy still read the same as the original.
+  EXPECT_EQ(8u, readConstant(*b, 8, Expr::Int32));
+  EXPECT_EQ(2 * PageSize + 8, readConstant(*b, 2 * PageSize + 8, Expr::Int32));
+
+  // The original can be written without disturbing the copy.
+  a->write8(8, 0x77);
+  EXPECT_EQ(8u, readConstant(*b, 8, Expr::Int32));
+
+  delete b;
+  delete a;
+}
+
+}
@@ -0,0 +1,238 @@
+//===-- StateSpillerTest.cpp ----------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "AddressSpace.h"
+#include "Memory.h"
+#include "StateSpiller.h"
+
+#include "klee/ExecutionState.h"
+#include "klee/Expr.h"
+#include "klee/Internal/Module/Cell.h"
+#include "klee/Internal/Module/KModule.h"
+#include "klee/util/ArrayCache.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+/// A state running `i32 f(i32 a, i32 b) { %s = add a, b; ret %s }`, with
+/// a few constraints, registers, objects and a call on its path.
+class StateSpillerTest : public ::testing::Test {
+protected:
+  llvm::LLVMContext ctx;
+  std::unique_ptr<llvm::Module> module;
+  std::unique_ptr<KFunction> kf;
+  std::unique_ptr<ExecutionState> es;
+  ArrayCache arrays;
+  const Array *array;
+  const MemoryObject *concrete, *symbolic;
+  std::string base, directory;
+
+  void SetUp() override {
+    module.reset(new llvm::Module("spill", ctx));
+    llvm::Type *i32 = llvm::Type::getInt32Ty(ctx);
+    llvm::Type *params[] = { i32, i32 };
+    llvm::Function *f = llvm::Function::Create(
+        llvm::FunctionType::get(i32, params, false),
+        llvm::Function::ExternalLinkage, "f", module.get());
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(ctx, "entry", f));
+    llvm::Function::arg_iterator args = f->arg_begin();
+    llvm::Value *a = &*args++;
+    llvm::Value *b = &*args;
+    builder.CreateRet(builder.CreateAdd(a, b));
+
+    kf.reset(new KFunction(f, 0));
+    es.reset(new ExecutionState(kf.get()));
+
+    array = arrays.CreateArray("x", 4);
+    ref<Expr> x = ReadExpr::create(UpdateList(array, 0),
+                                   ConstantExpr::alloc(0, Expr::Int32));
+    es->constraints.addConstraint(
+        UltExpr::create(ConstantExpr::alloc(10, Expr::Int8), x));
+    es->constraints.addConstraint(
+        NeExpr::create(x, ConstantExpr::alloc(42, Expr::Int8)));
+
+    Cell *locals = es->stack[0].locals.getWriteable(es->frameArena);
+    locals[0].setValue(ConstantExpr::alloc(7, Expr::Int32));
+    locals[1].setValue(ZExtExpr::create(x, Expr::Int32));
+    locals[2].setValue(AddExpr::create(locals[0].getValue(),
+                                       locals[1].getValue()));
+
+    MemoryObject *mo = new MemoryObject(0x1000, 16, false, true, false, 0, 0);
+    ObjectState *os = new ObjectState(mo);
+    os->initializeToZero();
+    os->write64(0, 0x0123456789abcdefULL);
+    os->write(8, ZExtExpr::create(x, Expr::Int16));
+    es->addressSpace.bindObject(mo, os);
+    concrete = mo;
+
+    mo = new MemoryObject(0x2000, 4, false, true, false, 0, 0);
+    os = new ObjectState(mo, array);
+    os->write8(2, 0x2a);
+    es->addressSpace.bindObject(mo, os);
+    symbolic = mo;
+
+    CallInfo call;
+    call.f = f;
+    call.returned = true;
+    call.ret.expr = locals[2].getValue();
+    es->callPath.push_back(call);
+
+    char pattern[] = "/tmp/klee-spill-test-XXXXXX";
+    ASSERT_TRUE(mkdtemp(pattern));
+    base = pattern;
+    directory = base + "/spill";
+  }
+
+  void TearDown() override {
+    es.reset();
+    kf.reset();
+    rmdir(directory.c_str());
+    rmdir(base.c_str());
+  }
+
+  /// The file written by the first spill of this process.
+  std::string firstSpillFile() const {
+    return directory + "/" + llvm::utostr(getpid()) + "-0.state";
+  }
+
+  std::vector<ref<Expr> > constraints() const {
+    return std::vector<ref<Expr> >(es->constraints.begin(),
+                                   es->constraints.end());
+  }
+
+  std::vector<ref<Expr> > locals() const {
+    std::vector<ref<Expr> > values;
+    for (unsigned reg = 0; reg < kf->numRegisters; ++reg)
+      values.push_back(es->stack[0].locals[reg].getValue());
+    return values;
+  }
+
+  std::vector<ref<Expr> > bytes(const MemoryObject *mo) const {
+    std::vector<ref<Expr> > values;
+    const ObjectState *os = es->addressSpace.findObject(mo);
+    if (os)
+      for (unsigned i = 0; i < mo->size; ++i)
+        values.push_back(os->read8(i));
+    return values;
+  }
+};
+
+TEST_F(StateSpillerTest, RoundTrip) {
+  std::vector<ref<Expr> > oldConstraints = constraints();
+  std::vector<ref<Expr> > oldLocals = locals();
+  std::vector<ref<Expr> > oldConcrete = bytes(concrete);
+  std::vector<ref<Expr> > oldSymbolic = bytes(symbolic);
+  ASSERT_EQ(2u, oldConstraints.size());
+  ASSERT_EQ(16u, oldConcrete.size());
+  ASSERT_EQ(4u, oldSymbolic.size());
+
+  StateSpiller spiller(directory);
+  ASSERT_TRUE(spiller.spill(*es));
+  EXPECT_TRUE(spiller.isSpilled(es.get()));
+  EXPECT_EQ(1u, spiller.getNumSpilled());
+  EXPECT_EQ(0, access(firstSpillFile().c_str(), F_OK));
+
+  // The spillable parts are gone from memory, the call path is not.
+  EXPECT_TRUE(es->constraints.empty());
+  for (unsigned reg = 0; reg < kf->numRegisters; ++reg)
+    EXPECT_TRUE(es->stack[0].locals[reg].getValue().isNull());
+  EXPECT_FALSE(es->addressSpace.findObject(concrete));
+  EXPECT_FALSE(es->addressSpace.findObject(symbolic));
+  EXPECT_EQ(1u, es->callPath.size());
+
+  ASSERT_TRUE(spiller.restore(*es));
+  EXPECT_FALSE(spiller.isSpilled(es.get()));
+  EXPECT_EQ(0u, spiller.getNumSpilled());
+  EXPECT_NE(0, access(firstSpillFile().c_str(), F_OK));
+
+  EXPECT_EQ(oldConstraints, constraints());
+  EXPECT_EQ(oldLocals, locals());
+  EXPECT_EQ(oldConcrete, bytes(concrete));
+  EXPECT_EQ(oldSymbolic, bytes(symbolic));
+  EXPECT_TRUE(es->addressSpace.isOwned(es->addressSpace.findObject(concrete)));
+
+  ASSERT_EQ(1u, es->callPath.size());
+  EXPECT_EQ(&*module->begin(), es->callPath.back().f);
+  EXPECT_EQ(oldLocals[2], es->callPath.back().ret.expr);
+
+  // The restored state can be spilled again.
+  ASSERT_TRUE(spiller.spill(*es));
+  ASSERT_TRUE(spiller.restore(*es));
+  EXPECT_EQ(oldConstraints, constraints());
+  EXPECT_EQ(oldSymbolic, bytes(symbolic));
+}
+
+TEST_F(StateSpillerTest, TruncatedFile) {
+  StateSpiller spiller(directory);
+  ASSERT_TRUE(spiller.spill(*es));
+
+  std::string path = firstSpillFile();
+  FILE *f = fopen(path.c_str(), "rb");
+  ASSERT_TRUE(f);
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fclose(f);
+  ASSERT_GT(size, 8);
+  ASSERT_EQ(0, truncate(path.c_str(), size / 2));
+
+  EXPECT_FALSE(spiller.restore(*es));
+  // The state is left as it was, still spilled.
+  EXPECT_TRUE(spiller.isSpilled(es.get()));
+  EXPECT_TRUE(es->constraints.empty());
+  EXPECT_FALSE(es->addressSpace.findObject(concrete));
+
+  spiller.discard(*es);
+  EXPECT_FALSE(spiller.isSpilled(es.get()));
+  EXPECT_NE(0, access(path.c_str(), F_OK));
+}
+
+TEST_F(StateSpillerTest, CorruptFile) {
+  StateSpiller spiller(directory);
+  ASSERT_TRUE(spiller.spill(*es));
+
+  // Overwrite the magic number.
+  std::string path = firstSpillFile();
+  FILE *f = fopen(path.c_str(), "r+b");
+  ASSERT_TRUE(f);
+  ASSERT_EQ(4u, fwrite("junk", 1, 4, f));
+  fclose(f);
+
+  EXPECT_FALSE(spiller.restore(*es));
+  EXPECT_TRUE(spiller.isSpilled(es.get()));
+  EXPECT_TRUE(es->constraints.empty());
+
+  spiller.discard(*es);
+  EXPECT_NE(0, access(path.c_str(), F_OK));
+}
+
+TEST_F(StateSpillerTest, MissingFile) {
+  StateSpiller spiller(directory);
+  ASSERT_TRUE(spiller.spill(*es));
+  ASSERT_EQ(0, unlink(firstSpillFile().c_str()));
+
+  EXPECT_FALSE(spiller.restore(*es));
+  EXPECT_TRUE(spiller.isSpilled(es.get()));
+  spiller.discard(*es);
+}
+
+}
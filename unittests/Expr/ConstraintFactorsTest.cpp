@@ -0,0 +1,123 @@
+//===-- ConstraintFactorsTest.cpp -----------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/util/ArrayCache.h"
+#include "klee/util/ConstraintFactors.h"
+
+using namespace klee;
+
+namespace {
+
+ref<Expr> readByte(const Array *array, unsigned index) {
+  return ReadExpr::create(UpdateList(array, 0),
+                          ConstantExpr::alloc(index, Expr::Int32));
+}
+
+ref<Expr> readAt(const Array *array, ref<Expr> index) {
+  return ReadExpr::create(UpdateList(array, 0), index);
+}
+
+/// A constraint relating two bytes.
+ref<Expr> relate(ref<Expr> a, ref<Expr> b) {
+  return UltExpr::create(a, b);
+}
+
+/// A constraint on one byte.
+ref<Expr> bound(ref<Expr> a) {
+  return UltExpr::create(a, ConstantExpr::alloc(10, Expr::Int8));
+}
+
+TEST(ConstraintFactorsTest, Bytes) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *b = ac.CreateArray("b", 4);
+
+  ConstraintFactors factors;
+  factors.add(bound(readByte(a, 0)));                   // 0
+  factors.add(bound(readByte(a, 1)));                   // 1
+  factors.add(bound(readByte(b, 0)));                   // 2
+  factors.add(relate(readByte(a, 1), readByte(b, 0)));  // 3
+  ASSERT_EQ(4u, factors.size());
+
+  EXPECT_NE(factors.getFactor(0), factors.getFactor(1));
+  EXPECT_EQ(factors.getFactor(1), factors.getFactor(2));
+  EXPECT_EQ(factors.getFactor(1), factors.getFactor(3));
+
+  std::vector<unsigned> members = factors.getMembers(factors.getFactor(3));
+  ASSERT_EQ(3u, members.size());
+  EXPECT_EQ(1u, members[0]);
+  EXPECT_EQ(2u, members[1]);
+  EXPECT_EQ(3u, members[2]);
+
+  std::set<unsigned> found;
+  factors.getFactors(ConstraintFactors::Reads(bound(readByte(a, 0))), found);
+  EXPECT_EQ(1u, found.size());
+  EXPECT_TRUE(found.count(factors.getFactor(0)));
+
+  found.clear();
+  factors.getFactors(ConstraintFactors::Reads(bound(readByte(a, 3))), found);
+  EXPECT_TRUE(found.empty());
+}
+
+TEST(ConstraintFactorsTest, WholeArrays) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *i = ac.CreateArray("i", 4);
+  ref<Expr> index = ZExtExpr::create(readByte(i, 0), Expr::Int32);
+
+  ConstraintFactors factors;
+  factors.add(bound(readByte(a, 0)));  // 0
+  factors.add(bound(readByte(a, 1)));  // 1
+  EXPECT_NE(factors.getFactor(0), factors.getFactor(1));
+
+  // A symbolic index may be any byte.
+  std::set<unsigned> found;
+  factors.getFactors(ConstraintFactors::Reads(bound(readAt(a, index))), found);
+  EXPECT_EQ(2u, found.size());
+
+  factors.add(bound(readAt(a, index)));  // 2
+  EXPECT_EQ(factors.getFactor(0), factors.getFactor(1));
+  EXPECT_EQ(factors.getFactor(0), factors.getFactor(2));
+
+  // Later byte reads join the array's factor.
+  factors.add(bound(readByte(a, 3)));  // 3
+  EXPECT_EQ(factors.getFactor(0), factors.getFactor(3));
+  factors.add(bound(readByte(i, 1)));  // 4
+  EXPECT_NE(factors.getFactor(0), factors.getFactor(4));
+}
+
+TEST(ConstraintFactorsTest, ConstraintManager) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+
+  ConstraintManager constraints;
+  constraints.addConstraint(bound(readByte(a, 0)));
+  EXPECT_EQ(1u, constraints.getFactors().size());
+
+  // Copies share the factors until they are extended.
+  ConstraintManager copy(constraints);
+  EXPECT_EQ(&constraints.getFactors(), &copy.getFactors());
+  copy.addConstraint(bound(readByte(a, 1)));
+  EXPECT_EQ(2u, copy.getFactors().size());
+  EXPECT_EQ(1u, constraints.getFactors().size());
+
+  // Rewriting a constraint starts over.
+  constraints.addConstraint(
+      EqExpr::create(ConstantExpr::alloc(3, Expr::Int8), readByte(a, 0)));
+  const ConstraintFactors &factors = constraints.getFactors();
+  EXPECT_EQ(constraints.size(), factors.size());
+  for (unsigned i = 0; i < factors.size(); ++i)
+    EXPECT_EQ(1u, factors.getMembers(factors.getFactor(i)).size());
+}
+
+}
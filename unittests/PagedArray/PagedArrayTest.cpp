@@ -0,0 +1,168 @@
+//===-- PagedArrayTest.cpp ------------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Internal/ADT/PagedArray.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+/// Counts how often it is copied.
+struct Counted {
+  static unsigned copies;
+  int value;
+
+  Counted(int _value = 0) : value(_value) {}
+  Counted(const Counted &b) : value(b.value) { ++copies; }
+  Counted &operator=(const Counted &b) {
+    value = b.value;
+    return *this;
+  }
+  bool operator==(const Counted &b) const { return value == b.value; }
+};
+
+unsigned Counted::copies = 0;
+
+typedef PagedArray<Counted, 4> CountedArray;
+
+TEST(PagedArrayTest, UnwrittenPagesReadAsDefault) {
+  CountedArray a(10, Counted(7));
+  EXPECT_EQ(10u, a.size());
+  for (unsigned i = 0; i < a.size(); ++i)
+    EXPECT_EQ(7, a.get(i).value);
+  // Unallocated pages all hand out the default value itself.
+  EXPECT_EQ(&a.get(0), &a.get(9));
+
+  a.set(5, Counted(1));
+  EXPECT_EQ(1, a.get(5).value);
+  EXPECT_EQ(7, a.get(4).value);
+  EXPECT_EQ(7, a.get(6).value);
+  EXPECT_EQ(&a.get(0), &a.get(9));
+  EXPECT_NE(&a.get(0), &a.get(4));
+}
+
+TEST(PagedArrayTest, CopiesSharePages) {
+  CountedArray a(12);
+  for (unsigned i = 0; i < a.size(); ++i)
+    a.set(i, Counted(i));
+
+  Counted::copies = 0;
+  CountedArray b(a);
+  // Only the default value is copied, none of the elements.
+  EXPECT_EQ(1u, Counted::copies);
+  for (unsigned i = 0; i < a.size(); ++i)
+    EXPECT_EQ(&a.get(i), &b.get(i));
+}
+
+TEST(PagedArrayTest, WriteDuplicatesOnlyItsPage) {
+  CountedArray a(12);
+  for (unsigned i = 0; i < a.size(); ++i)
+    a.set(i, Counted(i));
+  CountedArray b(a);
+
+  Counted::copies = 0;
+  b.set(5, Counted(100));
+  // Exactly one page of four elements was cloned.
+  EXPECT_EQ(4u, Counted::copies);
+
+  EXPECT_EQ(5, a.get(5).value);
+  EXPECT_EQ(100, b.get(5).value);
+  for (unsigned i = 0; i < a.size(); ++i) {
+    if (i / 4 == 1)
+      EXPECT_NE(&a.get(i), &b.get(i));
+    else
+      EXPECT_EQ(&a.get(i), &b.get(i));
+  }
+
+  // The clone is now private to b.
+  Counted::copies = 0;
+  b.set(6, Counted(101));
+  EXPECT_EQ(0u, Counted::copies);
+  EXPECT_EQ(6, a.get(6).value);
+}
+
+TEST(PagedArrayTest, WritesAcrossPageBoundaries) {
+  // The last page is short.
+  CountedArray a(10);
+  CountedArray b(a);
+  std::vector<Counted> src(10);
+  for (unsigned i = 0; i < src.size(); ++i)
+    src[i] = Counted(i * 3);
+  a.copyFrom(src.data());
+
+  std::vector<Counted> dst(10);
+  a.copyTo(dst.data());
+  for (unsigned i = 0; i < dst.size(); ++i) {
+    EXPECT_EQ(int(i * 3), a.get(i).value);
+    EXPECT_EQ(int(i * 3), dst[i].value);
+    EXPECT_EQ(0, b.get(i).value);
+  }
+  EXPECT_TRUE(a.equals(src.data()));
+  EXPECT_FALSE(b.equals(src.data()));
+
+  // Writing the same contents back leaves the pages shared.
+  CountedArray c(a);
+  c.copyFrom(src.data());
+  for (unsigned i = 0; i < c.size(); ++i)
+    EXPECT_EQ(&a.get(i), &c.get(i));
+
+  // Changing one element in the middle page unshares only that page.
+  src[7] = Counted(-1);
+  c.copyFrom(src.data());
+  for (unsigned i = 0; i < c.size(); ++i) {
+    if (i / 4 == 1)
+      EXPECT_NE(&a.get(i), &c.get(i));
+    else
+      EXPECT_EQ(&a.get(i), &c.get(i));
+  }
+  EXPECT_EQ(-1, c.get(7).value);
+  EXPECT_EQ(21, a.get(7).value);
+}
+
+TEST(PagedArrayTest, AssignmentAndClear) {
+  CountedArray a(8);
+  a.set(1, Counted(1));
+  CountedArray b(3);
+  b = a;
+  EXPECT_EQ(8u, b.size());
+  EXPECT_EQ(&a.get(1), &b.get(1));
+
+  b.clear();
+  EXPECT_EQ(0, b.get(1).value);
+  EXPECT_EQ(1, a.get(1).value);
+}
+
+TEST(PagedArrayTest, BitArray) {
+  PagedBitArray bits(100);
+  PagedBitArray copy(bits);
+  bits.set(31);
+  bits.set(32);
+  bits.set(99);
+  EXPECT_TRUE(bits.get(31));
+  EXPECT_TRUE(bits.get(32));
+  EXPECT_TRUE(bits.get(99));
+  EXPECT_FALSE(bits.get(30));
+  EXPECT_FALSE(bits.get(33));
+  EXPECT_FALSE(copy.get(31));
+  EXPECT_FALSE(copy.get(99));
+
+  bits.unset(32);
+  EXPECT_FALSE(bits.get(32));
+  EXPECT_TRUE(bits.get(31));
+
+  PagedBitArray ones(40, true);
+  EXPECT_TRUE(ones.get(0));
+  EXPECT_TRUE(ones.get(39));
+}
+
+}
@@ -0,0 +1,124 @@
+//===-- PersistentListTest.cpp --------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Internal/ADT/PersistentList.h"
+
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+/// Counts how often it is copied.
+struct Counted {
+  static unsigned copies;
+  int value;
+
+  Counted(int _value) : value(_value) {}
+  Counted(const Counted &b) : value(b.value) { ++copies; }
+};
+
+unsigned Counted::copies = 0;
+
+std::vector<int> values(const PersistentList<Counted> &list) {
+  std::vector<int> result;
+  for (PersistentList<Counted>::const_iterator it = list.begin(),
+         ie = list.end(); it != ie; ++it)
+    result.push_back(it->value);
+  return result;
+}
+
+TEST(PersistentListTest, PushBackAndIterate) {
+  PersistentList<Counted> list;
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(0u, values(list).size());
+
+  for (int i = 0; i < 4; ++i)
+    list.push_back(Counted(i));
+  EXPECT_EQ(4u, list.size());
+  EXPECT_EQ(3, list.back().value);
+
+  std::vector<int> expected;
+  for (int i = 0; i < 4; ++i)
+    expected.push_back(i);
+  EXPECT_EQ(expected, values(list));
+}
+
+TEST(PersistentListTest, CopiesShareNodes) {
+  PersistentList<Counted> list;
+  list.push_back(Counted(1));
+  list.push_back(Counted(2));
+
+  Counted::copies = 0;
+  PersistentList<Counted> copy(list);
+  PersistentList<Counted> assigned;
+  assigned = list;
+  EXPECT_EQ(0u, Counted::copies);
+
+  // Reading does not copy, not even through a non-const list.
+  EXPECT_EQ(&list.back(), &copy.back());
+  EXPECT_EQ(2, copy.back().value);
+  EXPECT_EQ(0u, Counted::copies);
+
+  // Diverging copies keep sharing their prefix.
+  copy.push_back(Counted(3));
+  list.push_back(Counted(4));
+  EXPECT_EQ(2u, Counted::copies);
+  EXPECT_EQ(3u, copy.size());
+  EXPECT_EQ(3, copy.back().value);
+  EXPECT_EQ(4, list.back().value);
+  EXPECT_EQ(2, values(assigned).back());
+}
+
+TEST(PersistentListTest, CopyOnWrite) {
+  PersistentList<Counted> list;
+  list.push_back(Counted(1));
+  list.push_back(Counted(2));
+  PersistentList<Counted> copy(list);
+
+  // Writing to a shared last element clones it, and only it.
+  Counted::copies = 0;
+  copy.getWriteableBack().value = 20;
+  EXPECT_EQ(1u, Counted::copies);
+  EXPECT_EQ(2, list.back().value);
+  EXPECT_EQ(20, copy.back().value);
+  EXPECT_NE(&list.back(), &copy.back());
+  EXPECT_EQ(1, values(copy).front());
+
+  // Once unshared, writes are in place.
+  copy.getWriteableBack().value = 21;
+  list.getWriteableBack().value = 3;
+  EXPECT_EQ(1u, Counted::copies);
+  EXPECT_EQ(3, list.back().value);
+  EXPECT_EQ(21, copy.back().value);
+}
+
+TEST(PersistentListTest, IterateFrom) {
+  PersistentList<Counted> list;
+  for (int i = 0; i < 5; ++i)
+    list.push_back(Counted(i));
+
+  std::vector<int> tail;
+  for (PersistentList<Counted>::const_iterator it = list.from(3),
+         ie = list.end(); it != ie; ++it)
+    tail.push_back(it->value);
+  ASSERT_EQ(2u, tail.size());
+  EXPECT_EQ(3, tail[0]);
+  EXPECT_EQ(4, tail[1]);
+
+  EXPECT_TRUE(list.from(0) == list.begin());
+  EXPECT_EQ(0, list.from(0)->value);
+  EXPECT_TRUE(list.from(5) == list.end());
+  EXPECT_TRUE(PersistentList<Counted>().from(0) ==
+              PersistentList<Counted>().end());
+}
+
+}
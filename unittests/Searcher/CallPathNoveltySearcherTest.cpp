@@ -0,0 +1,137 @@
+//===-- CallPathNoveltySearcherTest.cpp -----------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Searcher.h"
+
+#include "gtest/gtest.h"
+
+#include "klee/ExecutionState.h"
+
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include <memory>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+/// States whose call paths are made up of calls to a few functions, by
+/// index.
+class CallPathNoveltySearcherTest : public ::testing::Test {
+protected:
+  llvm::LLVMContext ctx;
+  llvm::Module module;
+  std::vector<llvm::Function *> functions;
+  std::vector<std::unique_ptr<ExecutionState> > states;
+  const std::vector<ExecutionState *> none;
+
+  CallPathNoveltySearcherTest() : module("novelty", ctx) {
+    llvm::FunctionType *type =
+        llvm::FunctionType::get(llvm::Type::getVoidTy(ctx), false);
+    for (unsigned i = 0; i < 4; ++i)
+      functions.push_back(llvm::Function::Create(
+          type, llvm::Function::ExternalLinkage, "f" + llvm::Twine(i),
+          &module));
+  }
+
+  void call(ExecutionState *es, unsigned f) {
+    CallInfo info;
+    info.f = functions[f];
+    info.returned = true;
+    es->callPath.push_back(info);
+  }
+
+  ExecutionState *makeState(const std::vector<unsigned> &calls) {
+    states.emplace_back(new ExecutionState(std::vector<ref<Expr> >()));
+    ExecutionState *es = states.back().get();
+    for (unsigned i = 0; i < calls.size(); ++i)
+      call(es, calls[i]);
+    return es;
+  }
+};
+
+TEST_F(CallPathNoveltySearcherTest, UnseenCallSequenceFirst) {
+  ExecutionState *a = makeState({0, 1});
+  ExecutionState *b = makeState({0, 1});
+  ExecutionState *c = makeState({0, 2});
+  ExecutionState *d = makeState({0, 1});
+
+  CallPathNoveltySearcher searcher;
+  searcher.update(0, {a, b, c, d}, none);
+
+  // Three states called f0 then f1, only c went on to f2.
+  EXPECT_EQ(c, &searcher.selectState());
+  searcher.update(0, none, {c});
+
+  // Among equals, the most recently added one.
+  EXPECT_EQ(d, &searcher.selectState());
+}
+
+TEST_F(CallPathNoveltySearcherTest, LongerPathWinsTies) {
+  ExecutionState *shorter = makeState({0});
+  ExecutionState *longer = makeState({1, 2});
+
+  CallPathNoveltySearcher searcher;
+  searcher.update(0, {longer, shorter}, none);
+  EXPECT_EQ(longer, &searcher.selectState());
+}
+
+TEST_F(CallPathNoveltySearcherTest, NewCallMovesTheState) {
+  ExecutionState *a = makeState({0});
+  ExecutionState *b = makeState({0});
+  ExecutionState *c = makeState({0});
+
+  CallPathNoveltySearcher searcher;
+  searcher.update(0, {a, b, c}, none);
+  EXPECT_EQ(c, &searcher.selectState());
+
+  // a is the first to get to f0, f1.
+  call(a, 1);
+  searcher.update(a, none, none);
+  EXPECT_EQ(a, &searcher.selectState());
+
+  // Once b follows, both are as common as each other but still less
+  // common than c's sequence, which three states have been on.
+  call(b, 1);
+  searcher.update(b, none, none);
+  ExecutionState *selected = &searcher.selectState();
+  EXPECT_TRUE(selected == a || selected == b);
+
+  // Calls extending a known prefix in a new direction come first again.
+  call(c, 2);
+  searcher.update(c, none, none);
+  EXPECT_EQ(c, &searcher.selectState());
+}
+
+TEST_F(CallPathNoveltySearcherTest, CallsAreFoldedAsTheyComplete) {
+  ExecutionState *x = makeState({0, 1, 2});
+  ExecutionState *r = makeState({3});
+  ExecutionState *y = makeState({0});
+
+  CallPathNoveltySearcher searcher;
+  searcher.update(0, {x, r, y}, none);
+
+  // y gets to the sequence x started with one call at a time, and ends
+  // up on the same node; only r is on a sequence of its own then.
+  call(y, 1);
+  searcher.update(y, none, none);
+  call(y, 2);
+  searcher.update(y, none, none);
+  EXPECT_EQ(r, &searcher.selectState());
+
+  searcher.update(0, none, {r});
+  ExecutionState *selected = &searcher.selectState();
+  EXPECT_TRUE(selected == x || selected == y);
+}
+
+}
@@ -0,0 +1,120 @@
+//===-- SearcherTest.cpp ----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Searcher.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+using namespace klee;
+
+// DFS, BFS and random search never look inside a state, so distinct
+// aligned addresses are enough to stand in for states.
+static std::vector<ExecutionState *> fakeStates(unsigned n) {
+  std::vector<ExecutionState *> states;
+  for (unsigned i = 1; i <= n; ++i)
+    states.push_back(reinterpret_cast<ExecutionState *>(uintptr_t(i) * 64));
+  return states;
+}
+
+static const std::vector<ExecutionState *> none;
+
+TEST(SearcherTest, DFSOrder) {
+  std::vector<ExecutionState *> s = fakeStates(4);
+  DFSSearcher searcher;
+  searcher.update(0, s, none);
+  ASSERT_EQ(s[3], &searcher.selectState());
+
+  searcher.removeState(s[1]);
+  searcher.removeState(s[3]);
+  ASSERT_EQ(s[2], &searcher.selectState());
+  searcher.removeState(s[2]);
+  ASSERT_EQ(s[0], &searcher.selectState());
+  searcher.removeState(s[0]);
+  ASSERT_TRUE(searcher.empty());
+}
+
+TEST(SearcherTest, BFSOrder) {
+  std::vector<ExecutionState *> s = fakeStates(4);
+  BFSSearcher searcher;
+  searcher.update(0, std::vector<ExecutionState *>(s.begin(), s.begin() + 3),
+                  none);
+  ASSERT_EQ(s[0], &searcher.selectState());
+
+  // A fork of s[0] sends it behind the states that were already queued.
+  searcher.addState(s[3], s[0]);
+  searcher.removeState(s[1]);
+  ASSERT_EQ(s[2], &searcher.selectState());
+  searcher.removeState(s[2]);
+  ASSERT_EQ(s[0], &searcher.selectState());
+  searcher.removeState(s[0]);
+  ASSERT_EQ(s[3], &searcher.selectState());
+}
+
+TEST(SearcherTest, RandomKeepsLiveStates) {
+  std::vector<ExecutionState *> s = fakeStates(64);
+  RandomSearcher searcher;
+  searcher.update(0, s, none);
+  for (unsigned i = 0; i < s.size(); i += 2)
+    searcher.removeState(s[i]);
+
+  std::set<ExecutionState *> live;
+  for (unsigned i = 1; i < s.size(); i += 2)
+    live.insert(s[i]);
+  for (unsigned i = 0; i < 1000; ++i)
+    ASSERT_TRUE(live.count(&searcher.selectState()));
+}
+
+/// Add \a n states, remove half of them in random order, then drain the
+/// searcher. \a expected picks the state the searcher should select from
+/// the live ones, in the order they were added.
+template <class S, class Pick>
+static void checkRandomRemoval(unsigned n, Pick expected) {
+  std::vector<ExecutionState *> s = fakeStates(n);
+  S searcher;
+  searcher.update(0, s, none);
+
+  std::vector<ExecutionState *> order(s);
+  std::shuffle(order.begin(), order.end(), std::mt19937(n));
+  std::set<ExecutionState *> removed(order.begin(), order.begin() + n / 2);
+  for (unsigned i = 0; i < n / 2; ++i)
+    searcher.removeState(order[i]);
+
+  std::vector<ExecutionState *> live;
+  for (unsigned i = 0; i < n; ++i)
+    if (!removed.count(s[i]))
+      live.push_back(s[i]);
+  while (!live.empty()) {
+    ASSERT_FALSE(searcher.empty());
+    ExecutionState *selected = &searcher.selectState();
+    std::vector<ExecutionState *>::iterator it =
+        std::find(live.begin(), live.end(), selected);
+    ASSERT_TRUE(it != live.end());
+    if (ExecutionState *e = expected(live))
+      ASSERT_EQ(e, selected);
+    searcher.removeState(selected);
+    live.erase(it);
+  }
+  ASSERT_TRUE(searcher.empty());
+}
+
+TEST(SearcherTest, RemovalInAnyOrder) {
+  typedef std::vector<ExecutionState *> States;
+  checkRandomRemoval<DFSSearcher>(
+      1000, [](const States &live) { return live.back(); });
+  checkRandomRemoval<BFSSearcher>(
+      1000, [](const States &live) { return live.front(); });
+  checkRandomRemoval<RandomSearcher>(
+      1000, [](const States &) { return (ExecutionState *)0; });
+}
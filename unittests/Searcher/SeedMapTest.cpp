@@ -0,0 +1,64 @@
+//===-- SeedMapTest.cpp -----------------------------------------*- C++ -*-===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SeedMap.h"
+
+#include "gtest/gtest.h"
+
+#include <stdint.h>
+#include <vector>
+
+using namespace klee;
+
+// The seed map never looks inside a state or a seed's test.
+static ExecutionState *fakeState(unsigned i) {
+  return reinterpret_cast<ExecutionState *>(uintptr_t(i) * 64);
+}
+
+TEST(SeedMapTest, RoundRobin) {
+  SeedMap seeds;
+  for (unsigned i = 1; i <= 3; ++i)
+    seeds.addSeed(fakeState(i), SeedInfo(0));
+  ASSERT_EQ(fakeState(1), seeds.selectState());
+  ASSERT_EQ(fakeState(2), seeds.selectState());
+
+  // Removing the next state moves on to the one after it.
+  seeds.erase(fakeState(3));
+  ASSERT_EQ(fakeState(1), seeds.selectState());
+  ASSERT_EQ(fakeState(2), seeds.selectState());
+
+  // New states come after those already there.
+  seeds.addSeed(fakeState(4), SeedInfo(0));
+  ASSERT_EQ(fakeState(1), seeds.selectState());
+  seeds.addSeed(fakeState(5), SeedInfo(0));
+  ASSERT_EQ(fakeState(2), seeds.selectState());
+  ASSERT_EQ(fakeState(4), seeds.selectState());
+  ASSERT_EQ(fakeState(5), seeds.selectState());
+}
+
+TEST(SeedMapTest, Counts) {
+  SeedMap seeds;
+  seeds.addSeed(fakeState(1), SeedInfo(0));
+  seeds.addSeed(fakeState(1), SeedInfo(0));
+  seeds.addSeed(fakeState(2), SeedInfo(0));
+  ASSERT_EQ(2u, seeds.getNumStates());
+  ASSERT_EQ(3u, seeds.getNumSeeds());
+  ASSERT_EQ(2u, seeds.find(fakeState(1))->size());
+
+  std::vector<SeedInfo> taken;
+  seeds.take(fakeState(1), taken);
+  ASSERT_EQ(2u, taken.size());
+  ASSERT_FALSE(seeds.count(fakeState(1)));
+  ASSERT_EQ(0, seeds.find(fakeState(1)));
+  ASSERT_EQ(1u, seeds.getNumSeeds());
+
+  seeds.erase(fakeState(2));
+  ASSERT_TRUE(seeds.empty());
+  ASSERT_EQ(0u, seeds.getNumSeeds());
+}
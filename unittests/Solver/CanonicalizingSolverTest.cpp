@@ -0,0 +1,145 @@
+//===-- CanonicalizingSolverTest.cpp --------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/Solver.h"
+#include "klee/SolverImpl.h"
+#include "klee/util/ArrayCache.h"
+
+#include <string>
+#include <vector>
+
+using namespace klee;
+
+namespace {
+
+/// Records the queries it is asked, and deems them all valid.
+class RecordingSolver : public SolverImpl {
+public:
+  std::vector<Query> &queries;
+
+  explicit RecordingSolver(std::vector<Query> &_queries)
+    : queries(_queries) {}
+
+  bool computeTruth(const Query &query, bool &isValid) {
+    queries.push_back(query);
+    isValid = true;
+    return true;
+  }
+  bool computeValue(const Query &query, ref<Expr> &result) {
+    queries.push_back(query);
+    result = ConstantExpr::create(0, query.expr->getWidth());
+    return true;
+  }
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    queries.push_back(query);
+    values.clear();
+    for (unsigned i = 0; i < objects.size(); ++i)
+      values.push_back(std::vector<unsigned char>(objects[i]->size, i));
+    hasSolution = true;
+    return true;
+  }
+  SolverRunStatus getOperationStatusCode() {
+    return SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+  }
+};
+
+ArrayCache ac;
+
+ref<Expr> readByte(const Array *array, unsigned index) {
+  return ReadExpr::create(UpdateList(array, 0),
+                          ConstantExpr::create(index, Expr::Int32));
+}
+
+ref<Expr> lessThan(ref<Expr> e, unsigned value) {
+  return UltExpr::create(e, ConstantExpr::create(value, e->getWidth()));
+}
+
+TEST(CanonicalizingSolverTest, RenamedQueriesHitTheCache) {
+  std::vector<Query> queries;
+  Solver *solver = createCanonicalizingSolver(
+      createCachingSolver(new Solver(new RecordingSolver(queries))));
+
+  const char *names[][2] = { { "packet_chunks", "map" },
+                             { "packet_chunks__1", "map__1" } };
+  for (unsigned i = 0; i < 2; ++i) {
+    const Array *a = ac.CreateArray(names[i][0], 4);
+    const Array *b = ac.CreateArray(names[i][1], 4);
+    ConstraintManager constraints;
+    constraints.addConstraint(lessThan(readByte(a, 0), 5));
+    bool isValid;
+    EXPECT_TRUE(solver->mustBeTrue(
+        Query(constraints, EqExpr::create(readByte(a, 1), readByte(b, 0))),
+        isValid));
+  }
+  EXPECT_EQ(1u, queries.size());
+
+  delete solver;
+}
+
+TEST(CanonicalizingSolverTest, DistinctArraysStayDistinct) {
+  std::vector<Query> queries;
+  Solver *solver = createCanonicalizingSolver(
+      createCachingSolver(new Solver(new RecordingSolver(queries))));
+
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *b = ac.CreateArray("b", 4);
+  ConstraintManager constraints;
+  bool isValid;
+  // a[0] < b[0] and a[0] < a[1] only differ in the array of the second
+  // read.
+  EXPECT_TRUE(solver->mustBeTrue(
+      Query(constraints, UltExpr::create(readByte(a, 0), readByte(b, 0))),
+      isValid));
+  EXPECT_TRUE(solver->mustBeTrue(
+      Query(constraints, UltExpr::create(readByte(a, 0), readByte(a, 1))),
+      isValid));
+  ASSERT_EQ(2u, queries.size());
+
+  const ReadExpr *first = dyn_cast<ReadExpr>(queries[0].expr->getKid(1));
+  ASSERT_TRUE(first != 0);
+  EXPECT_NE(a, first->updates.root);
+  EXPECT_NE(b, first->updates.root);
+  EXPECT_NE(cast<ReadExpr>(queries[0].expr->getKid(0))->updates.root,
+            first->updates.root);
+
+  delete solver;
+}
+
+TEST(CanonicalizingSolverTest, InitialValuesKeepTheirOrder) {
+  std::vector<Query> queries;
+  Solver *solver =
+      createCanonicalizingSolver(new Solver(new RecordingSolver(queries)));
+
+  const Array *a = ac.CreateArray("a", 2);
+  const Array *b = ac.CreateArray("b", 3);
+  ConstraintManager constraints;
+  constraints.addConstraint(lessThan(readByte(b, 0), 5));
+  std::vector<const Array *> objects;
+  objects.push_back(a);
+  objects.push_back(b);
+
+  std::vector<std::vector<unsigned char> > values;
+  ASSERT_TRUE(solver->getInitialValues(
+      Query(constraints, ConstantExpr::alloc(0, Expr::Bool)), objects,
+      values));
+  ASSERT_EQ(2u, values.size());
+  EXPECT_EQ(2u, values[0].size());
+  EXPECT_EQ(3u, values[1].size());
+
+  delete solver;
+}
+
+}
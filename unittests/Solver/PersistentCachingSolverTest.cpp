@@ -0,0 +1,160 @@
+//===-- PersistentCachingSolverTest.cpp -----------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/Solver.h"
+#include "klee/SolverImpl.h"
+#include "klee/util/ArrayCache.h"
+
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+/// Answers every query the same way and counts how often it was asked.
+class CountingSolver : public SolverImpl {
+  unsigned &calls;
+
+public:
+  explicit CountingSolver(unsigned &_calls) : calls(_calls) {}
+
+  bool computeTruth(const Query &, bool &isValid) {
+    ++calls;
+    isValid = true;
+    return true;
+  }
+  bool computeValue(const Query &, ref<Expr> &result) {
+    ++calls;
+    result = ConstantExpr::create(42, Expr::Int32);
+    return true;
+  }
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &,
+                            std::vector<std::vector<unsigned char> > &,
+                            bool &) {
+    return false;
+  }
+  SolverRunStatus getOperationStatusCode() {
+    return SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+  }
+};
+
+std::string getCachePath() {
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/klee-query-cache-%d", (int) getpid());
+  return path;
+}
+
+/// Ask the same queries as another run would, with arrays and expressions
+/// built anew, and return how many reached the underlying solver.
+unsigned askQueries(const std::string &path, bool reverseConstraints) {
+  ArrayCache ac;
+  const Array *a = ac.CreateArray("a", 4);
+  const Array *b = ac.CreateArray("b", 4);
+  ref<Expr> zero = ConstantExpr::create(0, Expr::Int32);
+  ref<Expr> ra = ReadExpr::create(UpdateList(a, 0), zero);
+  ref<Expr> rb = ReadExpr::create(UpdateList(b, 0), zero);
+  ref<Expr> ca = UltExpr::create(ra, ConstantExpr::create(5, Expr::Int8));
+  ref<Expr> cb = UltExpr::create(rb, ConstantExpr::create(7, Expr::Int8));
+
+  ConstraintManager constraints;
+  constraints.addConstraint(reverseConstraints ? cb : ca);
+  constraints.addConstraint(reverseConstraints ? ca : cb);
+
+  unsigned calls = 0;
+  Solver *solver = createPersistentCachingSolver(
+      new Solver(new CountingSolver(calls)), path);
+
+  bool isValid;
+  EXPECT_TRUE(solver->mustBeTrue(Query(constraints, EqExpr::create(ra, rb)),
+                                 isValid));
+  EXPECT_TRUE(isValid);
+  ref<ConstantExpr> value;
+  EXPECT_TRUE(solver->getValue(Query(constraints, AddExpr::create(ra, rb)),
+                               value));
+  EXPECT_EQ(42u, value->getZExtValue());
+  EXPECT_EQ(32u, value->getWidth());
+
+  delete solver;
+  return calls;
+}
+
+TEST(PersistentCachingSolverTest, ResultsOutliveTheSolver) {
+  std::string path = getCachePath();
+  unlink(path.c_str());
+
+  EXPECT_EQ(2u, askQueries(path, false));
+  EXPECT_EQ(0u, askQueries(path, false));
+  // The constraints are keyed as a set.
+  EXPECT_EQ(0u, askQueries(path, true));
+
+  unlink(path.c_str());
+}
+
+TEST(PersistentCachingSolverTest, ArraysAreNotKeyedByName) {
+  std::string path = getCachePath();
+  unlink(path.c_str());
+
+  // Distinct arrays of the same name, and the first of them renamed.
+  ArrayCache ac1, ac2, ac3;
+  const Array *a1 = ac1.CreateArray("a", 4);
+  const Array *a2 = ac2.CreateArray("a", 4);
+  const Array *b = ac3.CreateArray("b", 4);
+  ASSERT_NE(a1, a2);
+  ref<Expr> zero = ConstantExpr::create(0, Expr::Int32);
+  ref<Expr> one = ConstantExpr::create(1, Expr::Int32);
+
+  unsigned calls = 0;
+  Solver *solver = createPersistentCachingSolver(
+      new Solver(new CountingSolver(calls)), path);
+  ConstraintManager constraints;
+  bool isValid;
+  // a[0] < a[1], once over one array and once over two.
+  ref<Expr> oneArray =
+      UltExpr::create(ReadExpr::create(UpdateList(a1, 0), zero),
+                      ReadExpr::create(UpdateList(a1, 0), one));
+  ref<Expr> twoArrays =
+      UltExpr::create(ReadExpr::create(UpdateList(a1, 0), zero),
+                      ReadExpr::create(UpdateList(a2, 0), one));
+  EXPECT_TRUE(solver->mustBeTrue(Query(constraints, oneArray), isValid));
+  EXPECT_TRUE(solver->mustBeTrue(Query(constraints, twoArrays), isValid));
+  EXPECT_EQ(2u, calls);
+
+  // The same as the first query, up to the name of the array.
+  ref<Expr> renamed =
+      UltExpr::create(ReadExpr::create(UpdateList(b, 0), zero),
+                      ReadExpr::create(UpdateList(b, 0), one));
+  EXPECT_TRUE(solver->mustBeTrue(Query(constraints, renamed), isValid));
+  EXPECT_EQ(2u, calls);
+
+  delete solver;
+  unlink(path.c_str());
+}
+
+TEST(PersistentCachingSolverTest, IgnoresForeignFiles) {
+  std::string path = getCachePath();
+  FILE *f = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(f != 0);
+  fputs("not a query cache", f);
+  fclose(f);
+
+  EXPECT_EQ(2u, askQueries(path, false));
+  // The foreign file was replaced by a proper cache.
+  EXPECT_EQ(0u, askQueries(path, false));
+
+  unlink(path.c_str());
+}
+
+}
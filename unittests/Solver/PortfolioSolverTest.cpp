@@ -0,0 +1,220 @@
+//===-- PortfolioSolverTest.cpp -------------------------------------------===//
+//
+//                     The KLEE Symbolic Virtual Machine
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+
+#include "klee/Constraints.h"
+#include "klee/Expr.h"
+#include "klee/Solver.h"
+#include "klee/SolverImpl.h"
+#include "klee/Statistic.h"
+#include "klee/util/ArrayCache.h"
+
+#include <sys/time.h>
+#include <unistd.h>
+
+using namespace klee;
+
+namespace {
+
+Statistic fastWins("PortfolioTestFastWins", "PTfast");
+Statistic slowWins("PortfolioTestSlowWins", "PTslow");
+
+/// Takes its time, then either fails or fills every object with a byte,
+/// one more on every query it answers.
+class ScriptedSolver : public SolverImpl {
+  unsigned delay; // in milliseconds
+  bool succeed;
+  unsigned char fill;
+  SolverRunStatus status;
+
+public:
+  ScriptedSolver(unsigned _delay, bool _succeed, unsigned char _fill)
+    : delay(_delay), succeed(_succeed), fill(_fill),
+      status(SOLVER_RUN_STATUS_FAILURE) {}
+
+  bool computeTruth(const Query &, bool &) { return false; }
+  bool computeValue(const Query &, ref<Expr> &) { return false; }
+  bool computeInitialValues(const Query &,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    usleep(delay * 1000);
+    if (!succeed)
+      return false;
+    for (unsigned i = 0; i < objects.size(); ++i)
+      values.push_back(std::vector<unsigned char>(objects[i]->size, fill));
+    ++fill;
+    hasSolution = true;
+    status = SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+    return true;
+  }
+  SolverRunStatus getOperationStatusCode() { return status; }
+};
+
+/// Answers with the constants of the constraints it is given, in order,
+/// so that the constraints a member holds can be checked.
+class EchoSolver : public SolverImpl {
+public:
+  bool computeTruth(const Query &, bool &) { return false; }
+  bool computeValue(const Query &, ref<Expr> &) { return false; }
+  bool computeInitialValues(const Query &query,
+                            const std::vector<const Array *> &objects,
+                            std::vector<std::vector<unsigned char> > &values,
+                            bool &hasSolution) {
+    std::vector<unsigned char> constants(objects[0]->size, 0);
+    unsigned i = 0;
+    for (ConstraintManager::constraint_iterator it = query.constraints.begin(),
+           ie = query.constraints.end(); it != ie; ++it)
+      for (unsigned k = 0; k < (*it)->getNumKids(); ++k)
+        if (ConstantExpr *ce = dyn_cast<ConstantExpr>((*it)->getKid(k)))
+          constants.at(i++) = ce->getZExtValue();
+    values.push_back(constants);
+    hasSolution = true;
+    return true;
+  }
+  SolverRunStatus getOperationStatusCode() {
+    return SOLVER_RUN_STATUS_SUCCESS_SOLVABLE;
+  }
+};
+
+double now() {
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+Solver *createRace(unsigned fastDelay, bool fastSucceeds,
+                   unsigned slowDelay) {
+  std::vector<Solver *> solvers;
+  solvers.push_back(new Solver(new ScriptedSolver(slowDelay, true, 1)));
+  solvers.push_back(new Solver(new ScriptedSolver(fastDelay, fastSucceeds, 2)));
+  std::vector<Statistic *> wins;
+  wins.push_back(&slowWins);
+  wins.push_back(&fastWins);
+  return createPortfolioSolver(solvers, wins);
+}
+
+TEST(PortfolioSolverTest, FirstAnswerWins) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 4);
+  ref<Expr> read = ReadExpr::create(UpdateList(array, 0),
+                                    ConstantExpr::create(0, Expr::Int32));
+  ConstraintManager constraints;
+  Query query(constraints, EqExpr::create(read, read));
+
+  Solver *solver = createRace(0, true, 30000);
+  uint64_t fastBefore = fastWins, slowBefore = slowWins;
+  std::vector<const Array *> objects(1, array);
+  std::vector<std::vector<unsigned char> > values;
+  double start = now();
+  ASSERT_TRUE(solver->getInitialValues(query, objects, values));
+  // The slow member was not waited for.
+  EXPECT_LT(now() - start, 10.0);
+  ASSERT_EQ(1u, values.size());
+  EXPECT_EQ(std::vector<unsigned char>(4, 2), values[0]);
+  EXPECT_EQ(fastBefore + 1, (uint64_t) fastWins);
+  EXPECT_EQ(slowBefore, (uint64_t) slowWins);
+  delete solver;
+}
+
+TEST(PortfolioSolverTest, MembersKeepTheirState) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 3);
+  ref<Expr> read = ReadExpr::create(UpdateList(array, 0),
+                                    ConstantExpr::create(0, Expr::Int32));
+  ConstraintManager constraints;
+  Query query(constraints, EqExpr::create(read, read));
+
+  Solver *solver = createRace(0, true, 30000);
+  std::vector<const Array *> objects(1, array);
+  for (unsigned char fill = 2; fill < 5; ++fill) {
+    // The slow member is still busy with the first query.
+    std::vector<std::vector<unsigned char> > values;
+    double start = now();
+    ASSERT_TRUE(solver->getInitialValues(query, objects, values));
+    EXPECT_LT(now() - start, 10.0);
+    EXPECT_EQ(std::vector<unsigned char>(3, fill), values[0]);
+  }
+  delete solver;
+}
+
+TEST(PortfolioSolverTest, FailuresDoNotWin) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 2);
+  ref<Expr> read = ReadExpr::create(UpdateList(array, 0),
+                                    ConstantExpr::create(0, Expr::Int32));
+  ConstraintManager constraints;
+  Query query(constraints, EqExpr::create(read, read));
+
+  Solver *solver = createRace(0, false, 200);
+  uint64_t slowBefore = slowWins;
+  std::vector<const Array *> objects(1, array);
+  std::vector<std::vector<unsigned char> > values;
+  ASSERT_TRUE(solver->getInitialValues(query, objects, values));
+  EXPECT_EQ(std::vector<unsigned char>(2, 1), values[0]);
+  EXPECT_EQ(slowBefore + 1, (uint64_t) slowWins);
+  delete solver;
+}
+
+TEST(PortfolioSolverTest, MembersKeepSharedConstraints) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 4);
+  ref<Expr> read = ReadExpr::create(UpdateList(array, 0),
+                                    ConstantExpr::create(0, Expr::Int32));
+  ref<Expr> bounds[6];
+  for (unsigned i = 1; i < 6; ++i)
+    bounds[i] = UltExpr::create(read, ConstantExpr::create(10 * i, Expr::Int8));
+
+  std::vector<Solver *> solvers(1, new Solver(new EchoSolver()));
+  std::vector<Statistic *> wins(1, &fastWins);
+  Solver *solver = createPortfolioSolver(solvers, wins);
+  std::vector<const Array *> objects(1, array);
+
+  // Paths that grow, branch off, restart and start anew.
+  const unsigned paths[][4] = {
+    { 1, 2 }, { 1, 2, 3 }, { 1, 4 }, { 0 }, { 5 }, { 5 }, { 1, 2, 3, 4 },
+  };
+  for (unsigned p = 0; p < sizeof(paths) / sizeof(paths[0]); ++p) {
+    std::vector<ref<Expr> > path;
+    std::vector<unsigned char> expected(4, 0);
+    for (unsigned i = 0; i < 4 && paths[p][i]; ++i) {
+      path.push_back(bounds[paths[p][i]]);
+      expected[i] = 10 * paths[p][i];
+    }
+    ConstraintManager constraints(path);
+    Query query(constraints, EqExpr::create(read, read));
+    std::vector<std::vector<unsigned char> > values;
+    ASSERT_TRUE(solver->getInitialValues(query, objects, values));
+    EXPECT_EQ(expected, values[0]) << "query " << p;
+  }
+  delete solver;
+}
+
+TEST(PortfolioSolverTest, Timeout) {
+  ArrayCache ac;
+  const Array *array = ac.CreateArray("arr", 1);
+  ref<Expr> read = ReadExpr::create(UpdateList(array, 0),
+                                    ConstantExpr::create(0, Expr::Int32));
+  ConstraintManager constraints;
+  Query query(constraints, EqExpr::create(read, read));
+
+  Solver *solver = createRace(30000, true, 30000);
+  solver->setCoreSolverTimeout(0.2);
+  std::vector<const Array *> objects(1, array);
+  std::vector<std::vector<unsigned char> > values;
+  double start = now();
+  EXPECT_FALSE(solver->getInitialValues(query, objects, values));
+  EXPECT_LT(now() - start, 10.0);
+  EXPECT_EQ(SolverImpl::SOLVER_RUN_STATUS_TIMEOUT,
+            solver->impl->getOperationStatusCode());
+  delete solver;
+}
+
+}